@@ -289,11 +289,6 @@ typedef struct {
 #pragma region Core-Provided
     core_controller controls[4];
 
-    core_timer_delta g_frame_deltas[core_timer_max_deltas];
-    std::mutex g_frame_deltas_mutex;
-    core_timer_delta g_vi_deltas[core_timer_max_deltas];
-    std::mutex g_vi_deltas_mutex;
-
     uint8_t* rom;
     uint32_t* rdram;
     core_rdram_reg* rdram_register;
@@ -464,6 +459,18 @@ EXPORT std::wstring CALL core_vr_country_code_to_country_name(uint16_t country_c
  */
 EXPORT void CALL core_vr_on_speed_modifier_changed();
 
+/**
+ * \brief Gets statistics over the most recent frame deltas.
+ * \remarks Can be called from any thread.
+ */
+EXPORT core_timer_stats CALL core_vr_get_frame_stats();
+
+/**
+ * \brief Gets statistics over the most recent VI deltas.
+ * \remarks Can be called from any thread.
+ */
+EXPORT core_timer_stats CALL core_vr_get_vi_stats();
+
 /**
  * \brief Invalidates the visuals, allowing an updateScreen call to happen.
  */
@@ -673,16 +680,123 @@ EXPORT bool CALL core_vcr_has_seek_savestate_at_frame(size_t frame);
 /**
  * \brief Starts trace logging to the specified file.
  * \param path The output path.
- * \param binary Whether log output is in a binary format.
- * \param append Whether log output will be appended to the file.
+ * \param params The trace logging parameters.
  */
-EXPORT void CALL core_tl_start(std::filesystem::path path, bool binary, bool append);
+EXPORT void CALL core_tl_start(std::filesystem::path path, const core_tl_params& params);
 
 /**
  * \brief Stops trace logging.
  */
 EXPORT void CALL core_tl_stop();
 
+/**
+ * \brief Decodes a raw trace capture into a text or binary trace log.
+ * \param capture_path The raw capture's path.
+ * \param out_path The output path.
+ * \param format The output format. Must be core_tl_format_text or core_tl_format_binary.
+ * \param threads The amount of threads to decode with, or 0 to use one per hardware thread.
+ * \return The operation result.
+ */
+EXPORT core_result CALL core_tl_decode(const std::filesystem::path& capture_path, const std::filesystem::path& out_path, core_tl_format format, size_t threads);
+
+#pragma endregion
+
+#pragma region Performance Counters
+
+/**
+ * \brief Gets the performance counter totals accumulated since the core was initialized or the counters were last reset.
+ * \param snapshot The snapshot to write the totals into.
+ * \remarks Can be called from any thread.
+ */
+EXPORT void CALL core_perf_get_totals(core_perf_snapshot* snapshot);
+
+/**
+ * \brief Gets the performance counters accumulated during the most recently completed frame.
+ * \param snapshot The snapshot to write the counters into.
+ * \remarks Can be called from any thread.
+ */
+EXPORT void CALL core_perf_get_frame(core_perf_snapshot* snapshot);
+
+/**
+ * \brief Resets the performance counter totals.
+ */
+EXPORT void CALL core_perf_reset();
+
+/**
+ * \brief Gets the display name of a performance counter.
+ */
+EXPORT const wchar_t* CALL core_perf_get_counter_name(core_perf_counter counter);
+
+#pragma endregion
+
+#pragma region RAM Search
+
+/**
+ * \brief Starts a new RAM search, which takes a snapshot of RDRAM and makes every suitably aligned value of the specified type a candidate.
+ * \param type The value type.
+ */
+EXPORT void CALL core_rs_begin(core_rs_type type);
+
+/**
+ * \brief Narrows down the candidates of the current RAM search to those matching a comparison, and takes a new snapshot of RDRAM to compare against in the next step.
+ * \param cmp The comparison.
+ * \param value The constant to compare against, or the delta for core_rs_cmp_changed_by. Ignored by the other comparisons.
+ * \return The amount of remaining candidates.
+ */
+EXPORT size_t CALL core_rs_filter(core_rs_cmp cmp, double value);
+
+/**
+ * \brief Gets the amount of candidates of the current RAM search.
+ */
+EXPORT size_t CALL core_rs_get_count();
+
+/**
+ * \brief Gets the RDRAM addresses of the current RAM search's candidates in ascending order.
+ * \param addresses The vector to write the addresses into.
+ * \param max The maximum amount of addresses to get.
+ */
+EXPORT void CALL core_rs_get_candidates(std::vector<uint32_t>& addresses, size_t max);
+
+/**
+ * \brief Ends the current RAM search and frees its snapshot and candidates.
+ */
+EXPORT void CALL core_rs_end();
+
+#pragma endregion
+
+#pragma region Input Search
+
+/**
+ * \brief Starts an input search, which repeatedly loads the search's savestate, plays back a candidate input sequence and scores it by the objective.
+ * Candidates are mutated from the best ones found so far. They are evaluated as fast as possible, with rendering and audio disabled.
+ * \param params The search's parameters.
+ * \return The operation result
+ * \remarks The core must be launched and the VCR engine must be idle. The savestate is loaded again when the search ends.
+ */
+EXPORT core_result CALL core_bf_start(const core_bf_params& params);
+
+/**
+ * \brief Requests the current input search to stop. The search stops at the next input poll.
+ */
+EXPORT void CALL core_bf_stop();
+
+/**
+ * \brief Gets whether an input search is running.
+ */
+EXPORT bool CALL core_bf_is_running();
+
+/**
+ * \brief Gets the amount of candidates the current or last input search has evaluated.
+ */
+EXPORT size_t CALL core_bf_get_evaluated();
+
+/**
+ * \brief Gets the best candidates of the current or last input search, best first.
+ * The inputs can be passed to core_vcr_begin_warp_modify after being appended to the movie's inputs up to the savestate.
+ * \param results The vector to write the candidates into.
+ */
+EXPORT void CALL core_bf_get_results(std::vector<core_bf_result>& results);
+
 #pragma endregion
 
 #pragma region Savestates
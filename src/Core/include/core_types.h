@@ -91,12 +91,30 @@ typedef enum {
     ST_InvalidRegisters,
 #pragma endregion
 
+#pragma region Tracelog
+    // The trace capture is inaccessible or does not exist
+    TL_BadFile,
+    // The trace capture or the requested output format is invalid
+    TL_InvalidFormat,
+    // The decoded trace log couldn't be written to disk
+    TL_FileWriteError,
+#pragma endregion
+
 #pragma region Plugins
     // The plugin library couldn't be loaded
     Pl_LoadLibraryFailed,
     // The plugin doesn't export a GetDllInfo function
     Pl_NoGetDllInfo,
 #pragma endregion
+
+#pragma region Input Search
+    // Another input search is already running
+    BF_AlreadyRunning,
+    // The input search parameters are invalid
+    BF_InvalidParameters,
+    // Input searches can't be performed while a movie is active
+    BF_MovieActive,
+#pragma endregion
 } core_result;
 
 #pragma pack(push, 1)
@@ -143,11 +161,11 @@ typedef struct CoreCfg {
     int32_t fastforward_silent;
 
     /// <summary>
-    /// Maximum number of entries into the rom cache
+    /// Maximum size of the rom cache in megabytes
     /// <para/>
     /// 0 = disabled
     /// </summary>
-    int32_t rom_cache_size;
+    int32_t rom_cache_budget;
 
     /// <summary>
     /// Saves video buffer to savestates, slow!
@@ -252,13 +270,36 @@ typedef struct CoreCfg {
     /// </summary>
     int32_t render_throttling = 1;
 
+    /// <summary>
+    /// Whether the cached interpreter detects side-effect-free polling loops and fast-forwards the count register through them.
+    /// <para/>
+    /// Changes emulation timing, so movies recorded with a different value will likely desync.
+    /// </summary>
+    int32_t idle_loop_detection = 0;
+
+    /// <summary>
+    /// A map of internal rom names to per-rom idle loop detection overrides ("0" or "1").
+    /// </summary>
+    std::map<std::wstring, std::wstring> idle_loop_detection_roms;
+
 } core_cfg;
 #pragma pack(pop)
 
 #pragma region Emulator
 
 typedef std::common_type_t<std::chrono::duration<int64_t, std::ratio<1, 1000000000>>, std::chrono::duration<int64_t, std::ratio<1, 1000000000>>> core_timer_delta;
-constexpr uint8_t core_timer_max_deltas = 60;
+constexpr uint8_t core_timer_max_deltas = 128;
+
+typedef struct {
+    // The average rate per second.
+    double rate;
+    // The median and 99th percentile of the deltas in milliseconds.
+    double delta_p50_ms;
+    double delta_p99_ms;
+    // The median and 99th percentile of the deltas' deviations from the mean delta in milliseconds.
+    double jitter_p50_ms;
+    double jitter_p99_ms;
+} core_timer_stats;
 
 typedef struct {
     uint32_t rdram_config;
@@ -684,6 +725,230 @@ typedef struct
 
 #pragma endregion
 
+#pragma region Tracelog
+
+typedef enum {
+    // Human-readable disassembly with the relevant register values.
+    core_tl_format_text,
+    // Fixed-size little-endian entries containing the address, opcode and relevant register values.
+    core_tl_format_binary,
+    // The raw trace records, which are the cheapest to write and can be decoded into the other formats with core_tl_decode.
+    core_tl_format_raw,
+} core_tl_format;
+
+typedef enum {
+    // The emulation thread waits for the writer when the trace buffer is full, so no records are lost.
+    core_tl_overflow_block,
+    // Records which don't fit into the trace buffer are dropped.
+    core_tl_overflow_drop,
+} core_tl_overflow;
+
+typedef enum {
+    core_tl_class_alu = 1 << 0,
+    core_tl_class_branch = 1 << 1,
+    core_tl_class_load = 1 << 2,
+    core_tl_class_store = 1 << 3,
+    core_tl_class_cop0 = 1 << 4,
+    core_tl_class_fpu = 1 << 5,
+    core_tl_class_all = (1 << 6) - 1,
+} core_tl_class;
+
+typedef struct {
+    // The log output format.
+    core_tl_format format = core_tl_format_text;
+
+    // Whether log output is gzip-compressed. Raw captures are never compressed.
+    bool compress = false;
+
+    // What happens when the writer can't keep up with the emulation thread.
+    core_tl_overflow overflow = core_tl_overflow_block;
+
+    // The inclusive range of instruction addresses which are logged.
+    uint32_t pc_start = 0;
+    uint32_t pc_end = UINT32_MAX;
+
+    // The instruction classes which are logged, as a combination of core_tl_class flags.
+    uint32_t classes = core_tl_class_all;
+} core_tl_params;
+
+#pragma endregion
+
+#pragma region Performance Counters
+
+typedef enum {
+    // Instructions executed by each core type. Derived from the COP0 Count register, so they're accurate to the instruction granularity the core updates Count at.
+    core_perf_instructions_cached_interp,
+    core_perf_instructions_dynarec,
+    core_perf_instructions_pure_interp,
+
+    // Dynarec code cache activity.
+    core_perf_blocks_compiled,
+    core_perf_pages_invalidated,
+    core_perf_code_cache_flushes,
+
+    // Interrupts serviced, by type.
+    core_perf_interrupts_vi,
+    core_perf_interrupts_compare,
+    core_perf_interrupts_check,
+    core_perf_interrupts_si,
+    core_perf_interrupts_pi,
+    core_perf_interrupts_ai,
+    core_perf_interrupts_sp,
+    core_perf_interrupts_dp,
+    core_perf_interrupts_special,
+
+    // Plugin entry point calls.
+    core_perf_calls_video_update_screen,
+    core_perf_calls_video_process_rdp_list,
+    core_perf_calls_video_vi_status_changed,
+    core_perf_calls_video_vi_width_changed,
+    core_perf_calls_rsp_do_rsp_cycles,
+    core_perf_calls_audio_ai_len_changed,
+    core_perf_calls_audio_ai_dacrate_changed,
+    core_perf_calls_audio_ai_update,
+    core_perf_calls_input_get_keys,
+    core_perf_calls_input_controller_command,
+    core_perf_calls_input_read_controller,
+
+    // Time spent inside plugin entry points in nanoseconds. Laid out in the same order as the call counters.
+    core_perf_time_video_update_screen,
+    core_perf_time_video_process_rdp_list,
+    core_perf_time_video_vi_status_changed,
+    core_perf_time_video_vi_width_changed,
+    core_perf_time_rsp_do_rsp_cycles,
+    core_perf_time_audio_ai_len_changed,
+    core_perf_time_audio_ai_dacrate_changed,
+    core_perf_time_audio_ai_update,
+    core_perf_time_input_get_keys,
+    core_perf_time_input_controller_command,
+    core_perf_time_input_read_controller,
+
+    // Savestate operations. Times are in nanoseconds and byte counts are the uncompressed savestate sizes.
+    core_perf_st_saves,
+    core_perf_st_save_time,
+    core_perf_st_save_bytes,
+    core_perf_st_loads,
+    core_perf_st_load_time,
+    core_perf_st_load_bytes,
+
+    core_perf_counter_count,
+} core_perf_counter;
+
+typedef struct {
+    uint64_t values[core_perf_counter_count];
+} core_perf_snapshot;
+
+#pragma endregion
+
+#pragma region RAM Search
+
+typedef enum {
+    core_rs_type_u8,
+    core_rs_type_s8,
+    core_rs_type_u16,
+    core_rs_type_s16,
+    core_rs_type_u32,
+    core_rs_type_s32,
+    core_rs_type_float,
+} core_rs_type;
+
+typedef enum {
+    // Comparisons of the current value against a constant.
+    core_rs_cmp_equal,
+    core_rs_cmp_not_equal,
+    core_rs_cmp_greater,
+    core_rs_cmp_less,
+
+    // Comparisons of the current value against the value at the previous search step.
+    core_rs_cmp_changed,
+    core_rs_cmp_unchanged,
+    core_rs_cmp_increased,
+    core_rs_cmp_decreased,
+
+    // The current value equals the previous value plus a constant, which may be negative.
+    core_rs_cmp_changed_by,
+} core_rs_cmp;
+
+#pragma endregion
+
+#pragma region Input Search
+
+typedef enum {
+    // Higher objective values are better.
+    core_bf_goal_maximize,
+    // Lower objective values are better.
+    core_bf_goal_minimize,
+    // Objective values closer to the target are better.
+    core_bf_goal_target,
+} core_bf_goal;
+
+/**
+ * \brief A term of an RDRAM objective, which contributes a weighted RDRAM value to the objective value.
+ */
+typedef struct {
+    // The value's RDRAM address, which must be aligned to the value's size. The segment bits are ignored.
+    uint32_t address;
+    core_rs_type type;
+    double weight = 1.0;
+} core_bf_term;
+
+/**
+ * \brief Describes an input search.
+ */
+typedef struct {
+    // The savestate every candidate starts from.
+    std::vector<uint8_t> state;
+
+    // The amount of input frames of each candidate.
+    size_t frames;
+
+    // The controller whose inputs are searched. Other controllers are held at neutral.
+    int32_t controller;
+
+    // The buttons which may be pressed, as a core_buttons value. Buttons outside the mask keep the value of the initial inputs.
+    uint32_t button_mask;
+
+    // The inclusive ranges of the analog stick values. An axis whose range is 0..0 keeps the value of the initial inputs.
+    int8_t x_min;
+    int8_t x_max;
+    int8_t y_min;
+    int8_t y_max;
+
+    // The inputs of the first candidate, which the search starts out from. Padded with neutral inputs up to the frame count.
+    std::vector<core_buttons> initial;
+
+    // The amount of candidates to evaluate.
+    size_t iterations;
+
+    // The amount of best candidates which are kept and mutated into new candidates.
+    size_t keep;
+
+    // The seed of the random generator, which makes searches reproducible.
+    uint32_t seed;
+
+    // The RDRAM objective, whose value is the weighted sum of its terms' values.
+    std::vector<core_bf_term> terms;
+
+    // A function computing the objective value, which is used instead of the RDRAM objective if set. Called on the emu thread.
+    std::function<double()> objective;
+
+    core_bf_goal goal;
+
+    // The objective value to approach with core_bf_goal_target.
+    double target;
+} core_bf_params;
+
+/**
+ * \brief A candidate found by an input search.
+ */
+typedef struct {
+    // The candidate's objective value.
+    double value;
+    std::vector<core_buttons> inputs;
+} core_bf_result;
+
+#pragma endregion
+
 #pragma region Cheats
 
 /**
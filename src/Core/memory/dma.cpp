@@ -9,6 +9,7 @@
 #include "flashram.h"
 #include "memory.h"
 #include "pif.h"
+#include "savedata.h"
 #include "savestates.h"
 #include "summercart.h"
 #include <Core.h>
@@ -29,14 +30,14 @@ void dma_pi_read()
     {
         if (use_flashram != 1)
         {
-            fseek(g_sram_file, 0, SEEK_SET);
-            fread(sram, 1, 0x8000, g_sram_file);
+            const uint32_t offset = pi_register.pi_cart_addr_reg - 0x08000000;
+            longueur = (pi_register.pi_rd_len_reg & 0xFFFFFF) + 1;
 
-            for (i = 0; i < (pi_register.pi_rd_len_reg & 0xFFFFFF) + 1; i++)
-                sram[((pi_register.pi_cart_addr_reg - 0x08000000) + i) ^ S8] = ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8];
+            for (i = 0; i < longueur; i++)
+                sram[(offset + i) ^ S8] = ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8];
 
-            fseek(g_sram_file, 0, SEEK_SET);
-            fwrite(sram, 1, 0x8000, g_sram_file);
+            // The byteswapped writes can touch the whole first and last word
+            savedata_mark_dirty(save_sram, offset & ~3, ((offset + longueur + 3) & ~3) - (offset & ~3));
             use_flashram = -1;
         }
         else
@@ -95,9 +96,6 @@ void dma_pi_write()
         {
             if (use_flashram != 1)
             {
-                fseek(g_sram_file, 0, SEEK_SET);
-                fread(sram, 1, 0x8000, g_sram_file);
-
                 for (i = 0; i < (pi_register.pi_wr_len_reg & 0xFFFFFF) + 1; i++)
                     ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8] =
                     sram[(((pi_register.pi_cart_addr_reg - 0x08000000) & 0xFFFF) + i) ^ S8];
@@ -6,6 +6,7 @@
 
 #include "stdafx.h"
 #include "memory.h"
+#include "savedata.h"
 #include <Core.h>
 #include <r4300/r4300.h>
 
@@ -100,27 +101,19 @@ void flashram_command(uint32_t command)
             break;
         case ERASE_MODE:
             {
-                fseek(g_sram_file, 0, SEEK_SET);
-                fread(flashram, 1, 0x20000, g_sram_file);
-
                 for (int32_t i = erase_offset; i < (erase_offset + 128); i++)
                     flashram[i ^ S8] = 0xff;
 
-                fseek(g_sram_file, 0, SEEK_SET);
-                fwrite(flashram, 1, 0x20000, g_sram_file);
+                savedata_mark_dirty(save_flashram, erase_offset, 128);
             }
             break;
         case WRITE_MODE:
             {
-                fseek(g_sram_file, 0, SEEK_SET);
-                fread(flashram, 1, 0x20000, g_sram_file);
-
                 for (int32_t i = 0; i < 128; i++)
                     flashram[(erase_offset + i) ^ S8] =
                     ((unsigned char*)rdram)[(write_pointer + i) ^ S8];
 
-                fseek(g_sram_file, 0, SEEK_SET);
-                fwrite(flashram, 1, 0x20000, g_sram_file);
+                savedata_mark_dirty(save_flashram, erase_offset, 128);
             }
             break;
         case STATUS_MODE:
@@ -157,9 +150,6 @@ void dma_read_flashram()
         break;
     case READ_MODE:
         {
-            fseek(g_fram_file, 0, SEEK_SET);
-            fread(flashram, 1, 0x20000, g_fram_file);
-
             for (i = 0; i < (pi_register.pi_wr_len_reg & 0x0FFFFFF) + 1; i++)
                 ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8] =
                 flashram[(((pi_register.pi_cart_addr_reg - 0x08000000) & 0xFFFF) * 2 + i) ^ S8];
@@ -11,6 +11,7 @@
 #include "pif.h"
 #include "summercart.h"
 #include <Core.h>
+#include <r4300/bruteforce.h>
 #include <r4300/interrupt.h>
 #include <r4300/macros.h>
 #include <r4300/ops.h>
@@ -18,6 +19,7 @@
 #include <r4300/recomph.h>
 #include <r4300/timers.h>
 #include <r4300/vcr.h>
+#include <perf.h>
 
 static int32_t frame;
 
@@ -1212,7 +1214,7 @@ void update_SP()
             g_vr_frame_skipped = is_frame_skipped();
             if (!g_vr_frame_skipped)
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_call(core_perf_calls_rsp_do_rsp_cycles, g_core->plugin_funcs.rsp_do_rsp_cycles, 100);
             }
 
             rsp_register.rsp_pc |= save_pc;
@@ -1288,9 +1290,9 @@ void update_SP()
             // processAList();
             rsp_register.rsp_pc &= 0xFFF;
 
-            if (!g_vr_fast_forward || !g_core->cfg->fastforward_silent)
+            if (!bf_is_active() && (!g_vr_fast_forward || !g_core->cfg->fastforward_silent))
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_call(core_perf_calls_rsp_do_rsp_cycles, g_core->plugin_funcs.rsp_do_rsp_cycles, 100);
             }
             rsp_register.rsp_pc |= save_pc;
 
@@ -1304,9 +1306,9 @@ void update_SP()
         {
             // g_core->log_info(L"other task");
             rsp_register.rsp_pc &= 0xFFF;
-            if (!g_vr_fast_forward || !g_core->cfg->fastforward_silent)
+            if (!bf_is_active() && (!g_vr_fast_forward || !g_core->cfg->fastforward_silent))
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_call(core_perf_calls_rsp_do_rsp_cycles, g_core->plugin_funcs.rsp_do_rsp_cycles, 100);
             }
             rsp_register.rsp_pc |= save_pc;
 
@@ -2056,7 +2058,7 @@ void write_dp()
         dpc_register.dpc_current = dpc_register.dpc_start;
         break;
     case 0x4:
-        g_core->plugin_funcs.video_process_rdp_list();
+        perf_call(core_perf_calls_video_process_rdp_list, g_core->plugin_funcs.video_process_rdp_list);
         MI_register.mi_intr_reg |= 0x20;
         check_interrupt();
         break;
@@ -2109,7 +2111,7 @@ void write_dpb()
     case 0x5:
     case 0x6:
     case 0x7:
-        g_core->plugin_funcs.video_process_rdp_list();
+        perf_call(core_perf_calls_video_process_rdp_list, g_core->plugin_funcs.video_process_rdp_list);
         MI_register.mi_intr_reg |= 0x20;
         check_interrupt();
         break;
@@ -2146,7 +2148,7 @@ void write_dph()
         break;
     case 0x4:
     case 0x6:
-        g_core->plugin_funcs.video_process_rdp_list();
+        perf_call(core_perf_calls_video_process_rdp_list, g_core->plugin_funcs.video_process_rdp_list);
         MI_register.mi_intr_reg |= 0x20;
         check_interrupt();
         break;
@@ -2173,7 +2175,7 @@ void write_dpd()
     {
     case 0x0:
         dpc_register.dpc_current = dpc_register.dpc_start;
-        g_core->plugin_funcs.video_process_rdp_list();
+        perf_call(core_perf_calls_video_process_rdp_list, g_core->plugin_funcs.video_process_rdp_list);
         MI_register.mi_intr_reg |= 0x20;
         check_interrupt();
         break;
@@ -2396,7 +2398,7 @@ void write_vi()
         if (vi_register.vi_status != word)
         {
             vi_register.vi_status = word;
-            g_core->plugin_funcs.video_vi_status_changed();
+            perf_call(core_perf_calls_video_vi_status_changed, g_core->plugin_funcs.video_vi_status_changed);
         }
         return;
         break;
@@ -2404,7 +2406,7 @@ void write_vi()
         if (vi_register.vi_width != word)
         {
             vi_register.vi_width = word;
-            g_core->plugin_funcs.video_vi_width_changed();
+            perf_call(core_perf_calls_video_vi_width_changed, g_core->plugin_funcs.video_vi_width_changed);
         }
         return;
         break;
@@ -2431,7 +2433,7 @@ void write_vib()
         if (vi_register.vi_status != temp)
         {
             vi_register.vi_status = temp;
-            g_core->plugin_funcs.video_vi_status_changed();
+            perf_call(core_perf_calls_video_vi_status_changed, g_core->plugin_funcs.video_vi_status_changed);
         }
         return;
         break;
@@ -2444,7 +2446,7 @@ void write_vib()
         if (vi_register.vi_width != temp)
         {
             vi_register.vi_width = temp;
-            g_core->plugin_funcs.video_vi_width_changed();
+            perf_call(core_perf_calls_video_vi_width_changed, g_core->plugin_funcs.video_vi_width_changed);
         }
         return;
         break;
@@ -2472,7 +2474,7 @@ void write_vih()
         if (vi_register.vi_status != temp)
         {
             vi_register.vi_status = temp;
-            g_core->plugin_funcs.video_vi_status_changed();
+            perf_call(core_perf_calls_video_vi_status_changed, g_core->plugin_funcs.video_vi_status_changed);
         }
         return;
         break;
@@ -2483,7 +2485,7 @@ void write_vih()
         if (vi_register.vi_width != temp)
         {
             vi_register.vi_width = temp;
-            g_core->plugin_funcs.video_vi_width_changed();
+            perf_call(core_perf_calls_video_vi_width_changed, g_core->plugin_funcs.video_vi_width_changed);
         }
         return;
         break;
@@ -2505,7 +2507,7 @@ void write_vid()
         if (vi_register.vi_status != dword >> 32)
         {
             vi_register.vi_status = dword >> 32;
-            g_core->plugin_funcs.video_vi_status_changed();
+            perf_call(core_perf_calls_video_vi_status_changed, g_core->plugin_funcs.video_vi_status_changed);
         }
         vi_register.vi_origin = dword & 0xFFFFFFFF;
         return;
@@ -2514,7 +2516,7 @@ void write_vid()
         if (vi_register.vi_width != dword >> 32)
         {
             vi_register.vi_width = dword >> 32;
-            g_core->plugin_funcs.video_vi_width_changed();
+            perf_call(core_perf_calls_video_vi_width_changed, g_core->plugin_funcs.video_vi_width_changed);
         }
         vi_register.vi_v_intr = dword & 0xFFFFFFFF;
         return;
@@ -2615,8 +2617,9 @@ void write_ai()
     {
     case 0x4:
         ai_register.ai_len = word;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_call(core_perf_calls_audio_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
+        audio_pump_notify();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
         case 0x44:
@@ -2675,7 +2678,7 @@ void write_ai()
         if (ai_register.ai_dacrate != word)
         {
             ai_register.ai_dacrate = word;
-            g_core->plugin_funcs.audio_ai_dacrate_changed(g_sys_type);
+            perf_call(core_perf_calls_audio_ai_dacrate_changed, g_core->plugin_funcs.audio_ai_dacrate_changed, g_sys_type);
             g_core->callbacks.dacrate_changed(g_sys_type);
         }
         return;
@@ -2697,8 +2700,9 @@ void write_aib()
         temp = ai_register.ai_len;
         *((unsigned char*)&temp + ((*address_low & 3) ^ S8)) = g_byte;
         ai_register.ai_len = temp;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_call(core_perf_calls_audio_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
+        audio_pump_notify();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
         case 0x44:
@@ -2756,7 +2760,7 @@ void write_aib()
         if (ai_register.ai_dacrate != temp)
         {
             ai_register.ai_dacrate = temp;
-            g_core->plugin_funcs.audio_ai_dacrate_changed(g_sys_type);
+            perf_call(core_perf_calls_audio_ai_dacrate_changed, g_core->plugin_funcs.audio_ai_dacrate_changed, g_sys_type);
             g_core->callbacks.dacrate_changed(g_sys_type);
         }
         return;
@@ -2776,8 +2780,9 @@ void write_aih()
         temp = ai_register.ai_len;
         *((uint16_t*)((unsigned char*)&temp + ((*address_low & 3) ^ S16))) = hword;
         ai_register.ai_len = temp;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_call(core_perf_calls_audio_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
+        audio_pump_notify();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
         case 0x44:
@@ -2832,7 +2837,7 @@ void write_aih()
         if (ai_register.ai_dacrate != temp)
         {
             ai_register.ai_dacrate = temp;
-            g_core->plugin_funcs.audio_ai_dacrate_changed(g_sys_type);
+            perf_call(core_perf_calls_audio_ai_dacrate_changed, g_core->plugin_funcs.audio_ai_dacrate_changed, g_sys_type);
             g_core->callbacks.dacrate_changed(g_sys_type);
         }
         return;
@@ -2849,8 +2854,9 @@ void write_aid()
     case 0x0:
         ai_register.ai_dram_addr = dword >> 32;
         ai_register.ai_len = dword & 0xFFFFFFFF;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_call(core_perf_calls_audio_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
+        audio_pump_notify();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
         case 0x44:
@@ -2902,7 +2908,7 @@ void write_aid()
         if (ai_register.ai_dacrate != dword >> 32)
         {
             ai_register.ai_dacrate = dword >> 32;
-            g_core->plugin_funcs.audio_ai_dacrate_changed(g_sys_type);
+            perf_call(core_perf_calls_audio_ai_dacrate_changed, g_core->plugin_funcs.audio_ai_dacrate_changed, g_sys_type);
             g_core->callbacks.dacrate_changed(g_sys_type);
         }
         ai_register.ai_bitrate = dword & 0xFFFFFFFF;
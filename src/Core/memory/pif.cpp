@@ -9,10 +9,13 @@
 #include <memory/memory.h>
 #include <memory/pif.h>
 #include <memory/pif_lut.h>
+#include <memory/savedata.h>
 #include <memory/savestates.h>
 #include <cheats.h>
+#include <r4300/bruteforce.h>
 #include <r4300/r4300.h>
 #include <r4300/vcr.h>
+#include <perf.h>
 
 // Amount of VIs since last input poll
 size_t lag_count;
@@ -56,19 +59,13 @@ void EepromCommand(uint8_t* Command)
         break;
     case 4: // read
         {
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fread(eeprom, 1, 0x800, g_eeprom_file);
             memcpy(&Command[4], eeprom + Command[3] * 8, 8);
         }
         break;
     case 5: // write
         {
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fread(eeprom, 1, 0x800, g_eeprom_file);
             memcpy(eeprom + Command[3] * 8, &Command[4], 8);
-
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fwrite(eeprom, 1, 0x800, g_eeprom_file);
+            savedata_mark_dirty(save_eeprom, Command[3] * 8, 8);
         }
         break;
     default:
@@ -140,7 +137,10 @@ void internal_ReadController(int32_t Control, uint8_t* Command)
 
             lag_count = 0;
             core_buttons input = {0};
-            vcr_on_controller_poll(Control, &input);
+            if (!bf_on_controller_poll(Control, &input))
+            {
+                vcr_on_controller_poll(Control, &input);
+            }
             *((uint32_t*)(Command + 3)) = input.value;
         }
         break;
@@ -149,7 +149,7 @@ void internal_ReadController(int32_t Control, uint8_t* Command)
         if (g_core->controls[Control].Present)
         {
             if (g_core->controls[Control].Plugin == (int32_t)ce_raw && g_core->plugin_funcs.input_controller_command)
-                g_core->plugin_funcs.input_read_controller(Control, Command);
+                perf_call(core_perf_calls_input_read_controller, g_core->plugin_funcs.input_read_controller, Control, Command);
         }
         break;
     }
@@ -205,12 +205,6 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                         address &= 0xFFE0;
                         if (address <= 0x7FE0)
                         {
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fread(mempack[0], 1, 0x8000, g_mpak_file);
-                            fread(mempack[1], 1, 0x8000, g_mpak_file);
-                            fread(mempack[2], 1, 0x8000, g_mpak_file);
-                            fread(mempack[3], 1, 0x8000, g_mpak_file);
-
                             memcpy(&Command[5], &mempack[Control][address], 0x20);
                         }
                         else
@@ -223,7 +217,7 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                 break;
             case (int32_t)ce_raw:
                 if (g_core->plugin_funcs.input_controller_command)
-                    g_core->plugin_funcs.input_controller_command(Control, Command);
+                    perf_call(core_perf_calls_input_controller_command, g_core->plugin_funcs.input_controller_command, Control, Command);
                 break;
             default:
                 memset(&Command[5], 0, 0x20);
@@ -248,19 +242,8 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                         address &= 0xFFE0;
                         if (address <= 0x7FE0)
                         {
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fread(mempack[0], 1, 0x8000, g_mpak_file);
-                            fread(mempack[1], 1, 0x8000, g_mpak_file);
-                            fread(mempack[2], 1, 0x8000, g_mpak_file);
-                            fread(mempack[3], 1, 0x8000, g_mpak_file);
-
                             memcpy(&mempack[Control][address], &Command[5], 0x20);
-
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fwrite(mempack[0], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[1], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[2], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[3], 1, 0x8000, g_mpak_file);
+                            savedata_mark_dirty(save_mempak, Control * sizeof(mempack[0]) + address, 0x20);
                         }
                         Command[0x25] = mempack_crc(&Command[5]);
                     }
@@ -268,7 +251,7 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                 break;
             case (int32_t)ce_raw:
                 if (g_core->plugin_funcs.input_controller_command)
-                    g_core->plugin_funcs.input_controller_command(Control, Command);
+                    perf_call(core_perf_calls_input_controller_command, g_core->plugin_funcs.input_controller_command, Control, Command);
                 break;
             default:
                 Command[0x25] = mempack_crc(&Command[5]);
@@ -338,7 +321,7 @@ void update_pif_write()
                 {
                     if (g_core->controls[channel].Present &&
                         g_core->controls[channel].RawData)
-                        g_core->plugin_funcs.input_controller_command(channel, &PIF_RAMb[i]);
+                        perf_call(core_perf_calls_input_controller_command, g_core->plugin_funcs.input_controller_command, channel, &PIF_RAMb[i]);
                     else
                         internal_ControllerCommand(channel, &PIF_RAMb[i]);
                 }
@@ -355,7 +338,7 @@ void update_pif_write()
         i++;
     }
     // PIF_RAMb[0x3F] = 0;
-    g_core->plugin_funcs.input_controller_command(-1, NULL);
+    perf_call(core_perf_calls_input_controller_command, g_core->plugin_funcs.input_controller_command, -1, nullptr);
     /*#ifdef DEBUG_PIF
         if (!one_frame_delay) {
             g_core->log_info(L"---------- after write ----------");
@@ -465,7 +448,7 @@ void update_pif_read()
                     if (g_core->controls[channel].Present &&
                         g_core->controls[channel].RawData && core_vcr_get_task() == task_idle)
                     {
-                        g_core->plugin_funcs.input_read_controller(channel, &PIF_RAMb[i]);
+                        perf_call(core_perf_calls_input_read_controller, g_core->plugin_funcs.input_read_controller, channel, &PIF_RAMb[i]);
                         auto ptr = (core_buttons*)&PIF_RAMb[i + 3];
                         g_core->callbacks.input(ptr, channel);
                     }
@@ -480,7 +463,7 @@ void update_pif_read()
         }
         i++;
     }
-    g_core->plugin_funcs.input_read_controller(-1, NULL);
+    perf_call(core_perf_calls_input_read_controller, g_core->plugin_funcs.input_read_controller, -1, nullptr);
 
 #ifdef DEBUG_PIF
     g_core->log_info(L"---------- after read -----------");
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * The RAM search compares RDRAM against a snapshot in its native host-endian word layout, where every aligned value is stored as one host value.
+ * Values are thus compared without any byte swizzling, which is only applied when candidate indices are converted to addresses.
+ */
+
+#include "stdafx.h"
+#include <Core.h>
+#include <memory/memory.h>
+#include <immintrin.h>
+
+// Candidates are tracked in blocks of this many values. Blocks without candidates are freed, so narrowed-down searches take up little memory and are skipped by later steps.
+constexpr size_t BLOCK_VALUES = 4096;
+constexpr size_t BLOCK_WORDS = BLOCK_VALUES / 64;
+
+struct t_block {
+    uint64_t bits[BLOCK_WORDS];
+};
+
+// Guards all search state
+static std::mutex search_mutex;
+static core_rs_type search_type;
+static std::vector<uint32_t> snapshot;
+static std::vector<uint32_t> current;
+static std::vector<std::unique_ptr<t_block>> blocks;
+static size_t candidate_count;
+
+/**
+ * \brief SSE2 operations on a vector of integer values, which produce per-lane comparison bitmasks.
+ */
+template <typename T>
+struct t_int_lanes {
+    using vector = __m128i;
+    static constexpr size_t count = 16 / sizeof(T);
+
+    static vector load(const T* p)
+    {
+        return _mm_loadu_si128((const __m128i*)p);
+    }
+
+    static vector set1(T value)
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return _mm_set1_epi8((char)value);
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return _mm_set1_epi16((short)value);
+        }
+        else
+        {
+            return _mm_set1_epi32((int)value);
+        }
+    }
+
+    static vector add(vector a, vector b)
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return _mm_add_epi8(a, b);
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return _mm_add_epi16(a, b);
+        }
+        else
+        {
+            return _mm_add_epi32(a, b);
+        }
+    }
+
+    static vector eq(vector a, vector b)
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return _mm_cmpeq_epi8(a, b);
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return _mm_cmpeq_epi16(a, b);
+        }
+        else
+        {
+            return _mm_cmpeq_epi32(a, b);
+        }
+    }
+
+    static vector gt(vector a, vector b)
+    {
+        // SSE2 only has signed comparisons, so unsigned values are biased into the signed range first
+        if constexpr (std::is_unsigned_v<T>)
+        {
+            const vector bias = set1((T)((T)1 << (sizeof(T) * 8 - 1)));
+            a = _mm_xor_si128(a, bias);
+            b = _mm_xor_si128(b, bias);
+        }
+        if constexpr (sizeof(T) == 1)
+        {
+            return _mm_cmpgt_epi8(a, b);
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return _mm_cmpgt_epi16(a, b);
+        }
+        else
+        {
+            return _mm_cmpgt_epi32(a, b);
+        }
+    }
+
+    static uint32_t mask(vector m)
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return (uint32_t)_mm_movemask_epi8(m);
+        }
+        else if constexpr (sizeof(T) == 2)
+        {
+            return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128()));
+        }
+        else
+        {
+            return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(m));
+        }
+    }
+};
+
+/**
+ * \brief SSE operations on a vector of float values, which produce per-lane comparison bitmasks.
+ */
+struct t_float_lanes {
+    using vector = __m128;
+    static constexpr size_t count = 4;
+
+    static vector load(const float* p)
+    {
+        return _mm_loadu_ps(p);
+    }
+
+    static vector set1(float value)
+    {
+        return _mm_set1_ps(value);
+    }
+
+    static vector add(vector a, vector b)
+    {
+        return _mm_add_ps(a, b);
+    }
+
+    static vector eq(vector a, vector b)
+    {
+        return _mm_cmpeq_ps(a, b);
+    }
+
+    static vector gt(vector a, vector b)
+    {
+        return _mm_cmpgt_ps(a, b);
+    }
+
+    static uint32_t mask(vector m)
+    {
+        return (uint32_t)_mm_movemask_ps(m);
+    }
+};
+
+template <typename T>
+using t_lanes = std::conditional_t<std::is_floating_point_v<T>, t_float_lanes, t_int_lanes<T>>;
+
+/**
+ * \brief Narrows down the candidates of all blocks to the values matching a comparison.
+ * \param cur The current values.
+ * \param prev The values at the previous step.
+ * \param cmp A function which compares a vector of current values with a vector of previous values and returns the per-lane bitmask of matches.
+ */
+template <typename T, typename Cmp>
+static void filter_blocks(const T* cur, const T* prev, Cmp cmp)
+{
+    using L = t_lanes<T>;
+
+    candidate_count = 0;
+    for (size_t b = 0; b < blocks.size(); ++b)
+    {
+        auto& block = blocks[b];
+        if (!block)
+        {
+            continue;
+        }
+
+        size_t block_count = 0;
+        for (size_t w = 0; w < BLOCK_WORDS; ++w)
+        {
+            uint64_t& bits = block->bits[w];
+            if (bits == 0)
+            {
+                continue;
+            }
+
+            const size_t base = b * BLOCK_VALUES + w * 64;
+            uint64_t matches = 0;
+            for (size_t i = 0; i < 64; i += L::count)
+            {
+                matches |= (uint64_t)cmp(L::load(cur + base + i), L::load(prev + base + i)) << i;
+            }
+
+            bits &= matches;
+            block_count += std::popcount(bits);
+        }
+
+        if (block_count == 0)
+        {
+            block.reset();
+        }
+        candidate_count += block_count;
+    }
+}
+
+template <typename T>
+static void filter_typed(core_rs_cmp cmp, double value)
+{
+    using L = t_lanes<T>;
+
+    // Going through a signed 64-bit integer lets negative deltas wrap around for unsigned types instead of being undefined
+    T converted;
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        converted = (T)value;
+    }
+    else
+    {
+        converted = (T)(int64_t)value;
+    }
+
+    const auto v = L::set1(converted);
+    const uint32_t all = (1u << L::count) - 1;
+    const auto cur = (const T*)current.data();
+    const auto prev = (const T*)snapshot.data();
+
+    switch (cmp)
+    {
+    case core_rs_cmp_equal:
+        filter_blocks(cur, prev, [&](auto c, auto) { return L::mask(L::eq(c, v)); });
+        break;
+    case core_rs_cmp_not_equal:
+        filter_blocks(cur, prev, [&](auto c, auto) { return ~L::mask(L::eq(c, v)) & all; });
+        break;
+    case core_rs_cmp_greater:
+        filter_blocks(cur, prev, [&](auto c, auto) { return L::mask(L::gt(c, v)); });
+        break;
+    case core_rs_cmp_less:
+        filter_blocks(cur, prev, [&](auto c, auto) { return L::mask(L::gt(v, c)); });
+        break;
+    case core_rs_cmp_changed:
+        filter_blocks(cur, prev, [&](auto c, auto p) { return ~L::mask(L::eq(c, p)) & all; });
+        break;
+    case core_rs_cmp_unchanged:
+        filter_blocks(cur, prev, [&](auto c, auto p) { return L::mask(L::eq(c, p)); });
+        break;
+    case core_rs_cmp_increased:
+        filter_blocks(cur, prev, [&](auto c, auto p) { return L::mask(L::gt(c, p)); });
+        break;
+    case core_rs_cmp_decreased:
+        filter_blocks(cur, prev, [&](auto c, auto p) { return L::mask(L::gt(p, c)); });
+        break;
+    case core_rs_cmp_changed_by:
+        filter_blocks(cur, prev, [&](auto c, auto p) { return L::mask(L::eq(c, L::add(p, v))); });
+        break;
+    }
+}
+
+static size_t get_type_size(core_rs_type type)
+{
+    switch (type)
+    {
+    case core_rs_type_u8:
+    case core_rs_type_s8:
+        return 1;
+    case core_rs_type_u16:
+    case core_rs_type_s16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+void core_rs_begin(core_rs_type type)
+{
+    std::lock_guard lock(search_mutex);
+
+    search_type = type;
+    snapshot.assign(std::begin(rdram), std::end(rdram));
+    current.resize(snapshot.size());
+
+    const size_t value_count = sizeof(rdram) / get_type_size(type);
+    blocks.clear();
+    blocks.resize(value_count / BLOCK_VALUES);
+    for (auto& block : blocks)
+    {
+        block = std::make_unique<t_block>();
+        std::ranges::fill(block->bits, UINT64_MAX);
+    }
+    candidate_count = value_count;
+}
+
+size_t core_rs_filter(core_rs_cmp cmp, double value)
+{
+    std::lock_guard lock(search_mutex);
+
+    if (blocks.empty())
+    {
+        return 0;
+    }
+
+    // RDRAM is copied first, so the step sees a consistent state even while the emulation thread keeps writing to it
+    memcpy(current.data(), rdram, sizeof(rdram));
+
+    switch (search_type)
+    {
+    case core_rs_type_u8:
+        filter_typed<uint8_t>(cmp, value);
+        break;
+    case core_rs_type_s8:
+        filter_typed<int8_t>(cmp, value);
+        break;
+    case core_rs_type_u16:
+        filter_typed<uint16_t>(cmp, value);
+        break;
+    case core_rs_type_s16:
+        filter_typed<int16_t>(cmp, value);
+        break;
+    case core_rs_type_u32:
+        filter_typed<uint32_t>(cmp, value);
+        break;
+    case core_rs_type_s32:
+        filter_typed<int32_t>(cmp, value);
+        break;
+    case core_rs_type_float:
+        filter_typed<float>(cmp, value);
+        break;
+    }
+
+    std::swap(snapshot, current);
+    return candidate_count;
+}
+
+size_t core_rs_get_count()
+{
+    std::lock_guard lock(search_mutex);
+    return candidate_count;
+}
+
+void core_rs_get_candidates(std::vector<uint32_t>& addresses, size_t max)
+{
+    std::lock_guard lock(search_mutex);
+
+    addresses.clear();
+    addresses.reserve(std::min(max + 3, candidate_count));
+
+    // Swizzling reverses the order of bytes and halfwords within a word, so whole words are collected and the addresses are only cut to the maximum once they're sorted
+    const auto size = (uint8_t)get_type_size(search_type);
+    const size_t values_per_word = std::max(4 / size, 1);
+    size_t last_word = SIZE_MAX;
+    bool full = false;
+    for (size_t b = 0; b < blocks.size() && !full; ++b)
+    {
+        if (!blocks[b])
+        {
+            continue;
+        }
+        for (size_t w = 0; w < BLOCK_WORDS && !full; ++w)
+        {
+            for (uint64_t bits = blocks[b]->bits[w]; bits != 0; bits &= bits - 1)
+            {
+                const size_t index = b * BLOCK_VALUES + w * 64 + std::countr_zero(bits);
+                const size_t word = index / values_per_word;
+                if (addresses.size() >= max && word != last_word)
+                {
+                    full = true;
+                    break;
+                }
+                last_word = word;
+                addresses.push_back(to_addr((uint32_t)(index * size), size));
+            }
+        }
+    }
+
+    std::ranges::sort(addresses);
+    if (addresses.size() > max)
+    {
+        addresses.resize(max);
+    }
+}
+
+void core_rs_end()
+{
+    std::lock_guard lock(search_mutex);
+
+    blocks.clear();
+    blocks.shrink_to_fit();
+    snapshot = {};
+    current = {};
+    candidate_count = 0;
+}
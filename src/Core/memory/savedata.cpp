@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include "savedata.h"
+#include "memory.h"
+#include <Core.h>
+#include <r4300/r4300.h>
+#include <io.h>
+
+// How long the write-back thread waits after a modification before writing, so that a game's burst of writes is merged into one
+constexpr auto WRITE_BACK_DELAY = std::chrono::milliseconds(500);
+
+struct t_save_file {
+    const wchar_t* extension;
+    uint8_t* data;
+    size_t size;
+    FILE* file;
+
+    // The modified range [dirty_start, dirty_end) which hasn't been written back yet
+    size_t dirty_start;
+    size_t dirty_end;
+};
+
+static t_save_file save_files[save_count] = {
+{L"eep", eeprom, sizeof(eeprom)},
+{L"sra", sram, sizeof(sram)},
+{L"fla", flashram, sizeof(flashram)},
+{L"mpk", (uint8_t*)mempack, sizeof(mempack)},
+};
+
+// Guards the dirty ranges and the write-back thread's requests
+static std::mutex dirty_mutex;
+static std::condition_variable dirty_cv;
+
+// The save files are only written by the write-back thread, and by savedata_close once that thread has stopped
+static std::thread write_back_thread;
+static bool write_back_stop_requested;
+static bool flush_requested;
+
+static std::filesystem::path get_save_path(const t_save_file& save)
+{
+    return std::format(L"{}{} {}.{}", g_core->get_saves_directory().wstring(), string_to_wstring((const char*)ROM_HEADER.nom), core_vr_country_code_to_country_name(ROM_HEADER.Country_code), save.extension);
+}
+
+static bool open_save_file(const std::filesystem::path& path, FILE** file)
+{
+    g_core->log_info(std::format(L"[Core] Opening core stream from {}...", path.wstring()));
+
+    if (!exists(path))
+    {
+        FILE* f = fopen(path.string().c_str(), "w");
+        if (!f)
+        {
+            return false;
+        }
+        fflush(f);
+        fclose(f);
+    }
+    *file = fopen(path.string().c_str(), "rb+");
+    return *file != nullptr;
+}
+
+static void reset_dirty_range(t_save_file& save)
+{
+    save.dirty_start = SIZE_MAX;
+    save.dirty_end = 0;
+}
+
+static bool has_dirty_ranges()
+{
+    return std::ranges::any_of(save_files, [](const t_save_file& save) {
+        return save.dirty_start < save.dirty_end;
+    });
+}
+
+/**
+ * \brief Writes the dirty ranges of all saves to their files.
+ * \param commit Whether the written data should also be committed to disk.
+ */
+static void write_back(bool commit)
+{
+    // The ranges are copied out so the emulation thread isn't blocked by the actual writes.
+    // If it modifies a range while it's being copied, it marks the range as dirty again afterwards, so the next write-back picks up the final data.
+    std::vector<uint8_t> buffers[save_count];
+    size_t offsets[save_count]{};
+    {
+        std::lock_guard lock(dirty_mutex);
+        for (size_t i = 0; i < save_count; ++i)
+        {
+            auto& save = save_files[i];
+            if (save.dirty_start >= save.dirty_end)
+            {
+                continue;
+            }
+            buffers[i].assign(save.data + save.dirty_start, save.data + save.dirty_end);
+            offsets[i] = save.dirty_start;
+            reset_dirty_range(save);
+        }
+    }
+
+    for (size_t i = 0; i < save_count; ++i)
+    {
+        FILE* file = save_files[i].file;
+        if (!file)
+        {
+            continue;
+        }
+        if (!buffers[i].empty())
+        {
+            fseek(file, offsets[i], SEEK_SET);
+            fwrite(buffers[i].data(), 1, buffers[i].size(), file);
+            fflush(file);
+        }
+        if (commit)
+        {
+            _commit(_fileno(file));
+        }
+    }
+}
+
+static void write_back_thread_proc()
+{
+    std::unique_lock lock(dirty_mutex);
+    while (true)
+    {
+        dirty_cv.wait(lock, [] {
+            return write_back_stop_requested || flush_requested || has_dirty_ranges();
+        });
+
+        if (write_back_stop_requested)
+        {
+            break;
+        }
+
+        // A flush skips the delay, since the user expects the data to be on disk soon after pausing
+        dirty_cv.wait_for(lock, WRITE_BACK_DELAY, [] {
+            return write_back_stop_requested || flush_requested;
+        });
+
+        const bool commit = flush_requested;
+        flush_requested = false;
+
+        lock.unlock();
+        write_back(commit);
+        lock.lock();
+    }
+}
+
+bool savedata_open()
+{
+    for (auto& save : save_files)
+    {
+        if (!open_save_file(get_save_path(save), &save.file))
+        {
+            for (auto& opened_save : save_files)
+            {
+                if (opened_save.file)
+                {
+                    fclose(opened_save.file);
+                    opened_save.file = nullptr;
+                }
+            }
+            return false;
+        }
+
+        memset(save.data, 0, save.size);
+        fseek(save.file, 0, SEEK_SET);
+        fread(save.data, 1, save.size, save.file);
+        reset_dirty_range(save);
+    }
+
+    write_back_stop_requested = false;
+    flush_requested = false;
+    write_back_thread = std::thread(write_back_thread_proc);
+    return true;
+}
+
+void savedata_close()
+{
+    {
+        std::lock_guard lock(dirty_mutex);
+        write_back_stop_requested = true;
+    }
+    dirty_cv.notify_one();
+    if (write_back_thread.joinable())
+    {
+        write_back_thread.join();
+    }
+
+    write_back(true);
+
+    for (auto& save : save_files)
+    {
+        if (save.file)
+        {
+            fclose(save.file);
+            save.file = nullptr;
+        }
+    }
+}
+
+void savedata_mark_dirty(save_type type, size_t offset, size_t size)
+{
+    auto& save = save_files[type];
+    if (offset >= save.size)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(dirty_mutex);
+        save.dirty_start = std::min(save.dirty_start, offset);
+        save.dirty_end = std::max(save.dirty_end, std::min(offset + size, save.size));
+    }
+    dirty_cv.notify_one();
+}
+
+void savedata_flush()
+{
+    {
+        std::lock_guard lock(dirty_mutex);
+        flush_requested = true;
+    }
+    dirty_cv.notify_one();
+}
+
+void savedata_clear()
+{
+    for (auto& save : save_files)
+    {
+        FILE* file;
+        if (!open_save_file(get_save_path(save), &file))
+        {
+            continue;
+        }
+        const std::vector<uint8_t> zeroes(save.size);
+        fwrite(zeroes.data(), 1, zeroes.size(), file);
+        fclose(file);
+    }
+}
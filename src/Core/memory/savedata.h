@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * Save data is kept authoritative in memory (see sram, eeprom, flashram and mempack in memory.h).
+ * Modified ranges are written back to the save files by a background thread, so the emulation thread never waits on file I/O.
+ */
+
+typedef enum {
+    save_eeprom,
+    save_sram,
+    save_flashram,
+    save_mempak,
+    save_count,
+} save_type;
+
+/**
+ * \brief Opens the current rom's save files, loads their contents into memory and starts the write-back thread.
+ * \return Whether all save files could be opened.
+ */
+bool savedata_open();
+
+/**
+ * \brief Writes back all pending changes, stops the write-back thread and closes the save files.
+ */
+void savedata_close();
+
+/**
+ * \brief Notifies the write-back thread that a range of a save has been modified in memory.
+ * \param type The save type.
+ * \param offset The offset of the range into the save's buffer.
+ * \param size The size of the range.
+ */
+void savedata_mark_dirty(save_type type, size_t offset, size_t size);
+
+/**
+ * \brief Asks the write-back thread to write back all pending changes and commit them to disk without waiting for the usual delay.
+ * \remarks Doesn't block. Only savedata_close waits for the data to be written.
+ */
+void savedata_flush();
+
+/**
+ * \brief Clears the current rom's EEPROM, SRAM, FlashRAM and mempak files.
+ * \remarks Must be called while the save files aren't open.
+ */
+void savedata_clear();
@@ -8,6 +8,7 @@
 #include "savestates.h"
 #include <libdeflate.h>
 #include <Core.h>
+#include <r4300/bruteforce.h>
 #include <r4300/interrupt.h>
 #include <r4300/r4300.h>
 #include <r4300/rom.h>
@@ -17,6 +18,7 @@
 #include "flashram.h"
 #include "memory.h"
 #include "summercart.h"
+#include <perf.h>
 
 // st that comes from no delay fix mupen, it has some differences compared to new st:
 // - one frame of input is "embedded", that is the pif ram holds already fetched controller info.
@@ -79,9 +81,6 @@ std::vector<uint8_t> g_undo_savestate;
 
 void get_paths_for_task(const t_savestate_task& task, std::filesystem::path& st_path, std::filesystem::path& sd_path)
 {
-    sd_path = g_core->get_saves_directory() / (const char*)ROM_HEADER.nom;
-    sd_path.replace_extension(".vhd");
-
     if (task.medium == core_st_medium_slot)
     {
         st_path = std::format(
@@ -90,6 +89,14 @@ void get_paths_for_task(const t_savestate_task& task, std::filesystem::path& st_
         string_to_wstring((const char*)ROM_HEADER.nom),
         core_vr_country_code_to_country_name(ROM_HEADER.Country_code), std::to_wstring(task.params.slot));
     }
+
+    // Each savestate has its own SD card overlay next to it. Savestates in memory don't carry one.
+    sd_path.clear();
+    if (task.medium == core_st_medium_slot || task.medium == core_st_medium_path)
+    {
+        sd_path = st_path;
+        sd_path += L".sd";
+    }
 }
 
 
@@ -234,13 +241,12 @@ std::vector<uint8_t> generate_savestate()
 
 void savestates_save_immediate_impl(const t_savestate_task& task)
 {
-    // TODO: Reimplement timing
+    const auto start = std::chrono::high_resolution_clock::now();
 
     const auto st = generate_savestate();
 
     if (task.medium == core_st_medium_slot || task.medium == core_st_medium_path)
     {
-        // Always save summercart for some reason
         std::filesystem::path new_st_path = task.params.path;
         std::filesystem::path new_sd_path = "";
         get_paths_for_task(task, new_st_path, new_sd_path);
@@ -269,13 +275,17 @@ void savestates_save_immediate_impl(const t_savestate_task& task)
         fclose(f);
     }
 
+    perf_add(core_perf_st_saves);
+    perf_add(core_perf_st_save_time, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count());
+    perf_add(core_perf_st_save_bytes, st.size());
+
     task.callback(Res_Ok, st);
     g_core->callbacks.save_state();
 }
 
 void savestates_load_immediate_impl(const t_savestate_task& task)
 {
-    // TODO: Reimplement timing
+    const auto start = std::chrono::high_resolution_clock::now();
 
     memset(g_event_queue_buf, 0, sizeof(g_event_queue_buf));
 
@@ -474,6 +484,10 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         g_st_skip_dma = true;
     }
 
+    perf_add(core_perf_st_loads);
+    perf_add(core_perf_st_load_time, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count());
+    perf_add(core_perf_st_load_bytes, decompressed_buf.size());
+
     g_core->callbacks.load_state();
     task.callback(Res_Ok, decompressed_buf);
 
@@ -495,6 +509,8 @@ failedLoad:
         // g_core->log_info(L".st jump: {:#06x}, stopped here:{:#06x}", PC->addr, last_addr);
         last_addr = PC->addr;
     }
+
+    perf_sync_count();
 }
 
 /**
@@ -598,7 +614,8 @@ void savestates_log_tasks()
  */
 void savestates_create_undo_point()
 {
-    if (!g_core->cfg->st_undo_load)
+    // Input searches load a savestate for every candidate, which would make the undo savestate useless while costing a save each time
+    if (!g_core->cfg->st_undo_load || bf_is_active())
     {
         return;
     }
@@ -792,10 +809,18 @@ bool core_st_do_memory(const std::vector<uint8_t>& buffer, const core_st_job job
         return false;
     }
 
+    // The task invokes its callback unconditionally, so a null callback is wrapped like in the other mediums
+    auto pre_callback = [=](const core_result result, const std::vector<uint8_t>& buffer) {
+        if (callback)
+        {
+            callback(result, buffer);
+        }
+    };
+
     const t_savestate_task task = {
     .job = job,
     .medium = core_st_medium_memory,
-    .callback = callback,
+    .callback = pre_callback,
     .params = {
     .buffer = buffer},
     .ignore_warnings = ignore_warnings,
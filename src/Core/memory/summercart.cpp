@@ -9,6 +9,8 @@
 #include <memory/memory.h>
 #include <memory/summercart.h>
 #include <r4300/rom.h>
+#include <xxhash/xxh64.h>
+#include <Windows.h>
 
 struct vhd {
     char cookie[8];
@@ -41,20 +43,45 @@ struct vhd {
 #define vhd_64(val) _byteswap_uint64(val)
 #endif
 
-static void vhd_copy(struct vhd* vhd, FILE* dst, FILE* src, void* buf, uint32_t n)
-{
-    uint64_t len;
-    fseek(src, -512, SEEK_END);
-    fread(vhd, 1, sizeof(struct vhd), src);
-    fseek(src, 0, SEEK_SET);
-    for (len = vhd_64(vhd->disk_size) / 512; len > 0; len -= n)
-    {
-        if (n > len)
-            n = len;
-        fread(buf, n, 512, src);
-        fwrite(buf, n, 512, dst);
-    }
-}
+constexpr uint32_t SD_SECTOR_SIZE = 512;
+
+// Identifies a savestate's SD card overlay file
+constexpr char SD_OVERLAY_MAGIC[4] = {'S', 'D', 'O', 'V'};
+constexpr uint32_t SD_OVERLAY_VERSION = 1;
+
+struct sd_overlay_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t session;
+    uint32_t sector_count;
+    uint32_t reserved;
+};
+
+/**
+ * The SD card image is mapped into memory for the duration of emulation, so transfers are plain copies and the OS writes modified pages back to the file on its own.
+ *
+ * Every sector which is written to for the first time in a session has its previous contents journaled.
+ * The image as it was when the session began is the session's base, and a savestate only stores the sectors which differ from it (the overlay).
+ * The base itself is written to disk when the first savestate of a session is saved, so states can still be loaded after the session is over.
+ * A session is identified by the hash of its base's contents, so sessions starting from the same image share one base file.
+ */
+struct sd_card {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    uint8_t* data = nullptr;
+    uint32_t sector_count = 0;
+
+    // Identifies the base which the overlays are relative to, or 0 if the base hasn't been hashed and saved yet
+    uint64_t session = 0;
+
+    // Bitmap of sectors which may differ from the base
+    std::vector<uint64_t> dirty;
+
+    // The base contents of all sectors which have been written to in this session
+    std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]>> originals;
+};
+
+static sd_card card;
 
 struct summercart summercart;
 
@@ -64,168 +91,361 @@ static int32_t sd_error(const wchar_t* text, const wchar_t* caption)
     return -1;
 }
 
-static int32_t sd_seek(FILE* fp, const wchar_t* caption)
+static void sd_close()
+{
+    if (card.data)
+    {
+        FlushViewOfFile(card.data, 0);
+        UnmapViewOfFile(card.data);
+    }
+    if (card.mapping)
+        CloseHandle(card.mapping);
+    if (card.file != INVALID_HANDLE_VALUE)
+        CloseHandle(card.file);
+    card = sd_card{};
+}
+
+static std::filesystem::path sd_get_base_path(uint64_t session)
+{
+    auto path = g_core->get_summercart_path();
+    path += std::format(L".{:016x}.base", session);
+    return path;
+}
+
+/**
+ * \brief Maps the SD card image if it isn't mapped yet.
+ * \param caption The caption of the error dialog shown on failure.
+ * \return Whether the image is mapped.
+ */
+static bool sd_open(const wchar_t* caption)
 {
+    if (card.data)
+        return true;
+
+    const auto path = g_core->get_summercart_path();
+    card.file = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (card.file == INVALID_HANDLE_VALUE)
+    {
+        sd_error(L"Could not open SD image file.", caption);
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(card.file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(struct vhd) || (uint64_t)file_size.QuadPart > SIZE_MAX)
+    {
+        sd_close();
+        sd_error(L"Read error.", caption);
+        return false;
+    }
+
+    card.mapping = CreateFileMappingW(card.file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    card.data = card.mapping ? (uint8_t*)MapViewOfFile(card.mapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+    if (!card.data)
+    {
+        sd_close();
+        sd_error(L"Could not map SD image file.", caption);
+        return false;
+    }
+
     struct vhd vhd;
-    uint32_t sector = summercart.sd_sector;
-    uint32_t count = summercart.data1;
-    if (fseek(fp, -512, SEEK_END))
-        return sd_error(L"Seek(1) error.", caption);
-    if (fread(&vhd, 1, sizeof(struct vhd), fp) != sizeof(struct vhd))
-        return sd_error(L"Read error.", caption);
+    memcpy(&vhd, card.data + file_size.QuadPart - sizeof(struct vhd), sizeof(struct vhd));
     if (memcmp(vhd.cookie, "conectix", 8))
-        return sd_error(L"Invalid VHD file.", caption);
+    {
+        sd_close();
+        sd_error(L"Invalid VHD file.", caption);
+        return false;
+    }
     if (vhd_32(vhd.type) != 2)
-        return sd_error(L"Invalid VHD type: must be a fixed disk.", caption);
-    if ((int64_t)sector + count > vhd_64(vhd.disk_size) / 512)
-        return -1;
-    if (fseek(fp, 512 * (int64_t)sector, SEEK_SET))
-        return sd_error(L"Seek(2) error.", caption);
-    return 0;
+    {
+        sd_close();
+        sd_error(L"Invalid VHD type: must be a fixed disk.", caption);
+        return false;
+    }
+
+    // The footer follows the data, so a disk size beyond it can't be trusted
+    const uint64_t disk_size = std::min<uint64_t>(vhd_64(vhd.disk_size), file_size.QuadPart - sizeof(struct vhd));
+    card.sector_count = (uint32_t)std::min<uint64_t>(disk_size / SD_SECTOR_SIZE, UINT32_MAX);
+    card.dirty.assign((card.sector_count + 63) / 64, 0);
+    return true;
+}
+
+static bool sd_is_dirty(uint32_t sector)
+{
+    return card.dirty[sector / 64] >> (sector % 64) & 1;
+}
+
+/**
+ * \brief Journals a sector's base contents if needed and marks it as dirty. Must be called before the sector is modified.
+ */
+static void sd_touch(uint32_t sector)
+{
+    card.dirty[sector / 64] |= 1ull << (sector % 64);
+
+    auto& original = card.originals[sector];
+    if (!original)
+    {
+        original = std::make_unique<uint8_t[]>(SD_SECTOR_SIZE);
+        memcpy(original.get(), card.data + (size_t)sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE);
+    }
+}
+
+/**
+ * \brief Resolves the target buffer of a transfer.
+ * \param addr The transfer address, which is made relative to the returned buffer.
+ * \param size The transfer size.
+ * \return The target buffer, or nullptr if the transfer is out of bounds.
+ */
+static char* sd_get_target(uint32_t& addr, uint32_t size)
+{
+    if (addr >= 0x1ffe0000 && addr + size <= 0x1ffe2000)
+    {
+        addr -= 0x1ffe0000;
+        return summercart.buffer;
+    }
+    if (addr >= 0x10000000 && addr + size <= 0x14000000)
+    {
+        addr -= 0x10000000;
+        return (char*)rom;
+    }
+    return nullptr;
 }
 
 static void sd_read()
 {
-    uint32_t i;
-    FILE* fp;
-    const auto path = g_core->get_summercart_path();
-    char* ptr = NULL;
     uint32_t addr = summercart.data0 & 0x1fffffff;
     uint32_t count = summercart.data1;
-    uint32_t size = 512 * count;
+    uint32_t size = SD_SECTOR_SIZE * count;
 
     if (count > 131072)
         return;
 
-    if ((fp = fopen(path.string().c_str(), "rb")))
-    {
-        char s = S8;
-        if (!sd_seek(fp, L"SD read error"))
-        {
-            if (addr >= 0x1ffe0000 && addr + size <= 0x1ffe2000)
-            {
-                addr -= 0x1ffe0000;
-                ptr = summercart.buffer;
-            }
-            if (addr >= 0x10000000 && addr + size <= 0x14000000)
-            {
-                s ^= summercart.sd_byteswap;
-                addr -= 0x10000000;
-                ptr = (char*)rom;
-            }
-        }
-        if (ptr)
-        {
-            for (i = 0; i < size; i++)
-                ptr[(addr + i) ^ s] = fgetc(fp);
-            summercart.status = 0;
-        }
-        fclose(fp);
-    }
-    else
-        sd_error(L"Could not open SD image file.", L"SD read error");
+    if (!sd_open(L"SD read error"))
+        return;
+
+    if ((uint64_t)summercart.sd_sector + count > card.sector_count)
+        return;
+
+    char* ptr = sd_get_target(addr, size);
+    if (!ptr)
+        return;
+
+    char s = S8;
+    if (ptr == (char*)rom)
+        s ^= summercart.sd_byteswap;
+
+    const uint8_t* src = card.data + (size_t)summercart.sd_sector * SD_SECTOR_SIZE;
+    for (uint32_t i = 0; i < size; i++)
+        ptr[(addr + i) ^ s] = src[i];
+    summercart.status = 0;
 }
 
 static void sd_write()
 {
-    uint32_t i;
-    FILE* fp;
-    const auto path = g_core->get_summercart_path();
-    char* ptr = NULL;
     uint32_t addr = summercart.data0 & 0x1fffffff;
     uint32_t count = summercart.data1;
-    uint32_t size = 512 * count;
+    uint32_t size = SD_SECTOR_SIZE * count;
 
     if (count > 131072)
         return;
 
-    if ((fp = fopen(path.string().c_str(), "r+b")))
+    if (!sd_open(L"SD write error"))
+        return;
+
+    if ((uint64_t)summercart.sd_sector + count > card.sector_count)
+        return;
+
+    char* ptr = sd_get_target(addr, size);
+    if (!ptr)
+        return;
+
+    for (uint32_t i = 0; i < count; i++)
+        sd_touch(summercart.sd_sector + i);
+
+    uint8_t* dst = card.data + (size_t)summercart.sd_sector * SD_SECTOR_SIZE;
+    for (uint32_t i = 0; i < size; i++)
+        dst[i] = ptr[(addr + i) ^ S8];
+    summercart.status = 0;
+}
+
+/**
+ * \brief Gets a sector's contents in the current session's base.
+ */
+static const uint8_t* sd_get_base_sector(uint32_t sector)
+{
+    // Sectors which were never dirtied still hold their base contents
+    if (sd_is_dirty(sector))
+        return card.originals[sector].get();
+    return card.data + (size_t)sector * SD_SECTOR_SIZE;
+}
+
+/**
+ * \brief Hashes the current session's base, which identifies the session.
+ */
+static uint64_t sd_hash_base()
+{
+    // The sectors are hashed one by one, since the base is spread across the image and the journal
+    uint64_t hash = card.sector_count;
+    for (uint32_t sector = 0; sector < card.sector_count; ++sector)
+        hash = xxh64::hash((const char*)sd_get_base_sector(sector), SD_SECTOR_SIZE, hash);
+    return hash ? hash : 1;
+}
+
+/**
+ * \brief Writes the current session's base to disk, unless an identical base is already there.
+ */
+static bool sd_save_base()
+{
+    const auto path = sd_get_base_path(card.session);
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) == (uintmax_t)card.sector_count * SD_SECTOR_SIZE)
+        return true;
+
+    // The base is written to a temporary file first, so an incomplete base is never mistaken for a valid one
+    auto temp_path = path;
+    temp_path += L".tmp";
+    FILE* f = _wfopen(temp_path.wstring().c_str(), L"wb");
+    if (!f)
+        return false;
+
+    bool ok = true;
+    for (uint32_t sector = 0; sector < card.sector_count; ++sector)
+        ok &= fwrite(sd_get_base_sector(sector), 1, SD_SECTOR_SIZE, f) == SD_SECTOR_SIZE;
+    ok &= fclose(f) == 0;
+
+    if (ok)
+        std::filesystem::rename(temp_path, path, ec);
+    if (!ok || ec)
     {
-        if (!sd_seek(fp, L"SD write error"))
-        {
-            if (addr >= 0x1ffe0000 && addr + size <= 0x1ffe2000)
-            {
-                addr -= 0x1ffe0000;
-                ptr = summercart.buffer;
-            }
-            if (addr >= 0x10000000 && addr + size <= 0x14000000)
-            {
-                addr -= 0x10000000;
-                ptr = (char*)rom;
-            }
-        }
-        if (ptr)
-        {
-            for (i = 0; i < size; i++)
-                fputc(ptr[(addr + i) ^ S8], fp);
-            summercart.status = 0;
-        }
-        fclose(fp);
+        std::filesystem::remove(temp_path, ec);
+        return false;
     }
-    else
-        sd_error(L"Could not open SD image file.", L"SD write error");
+    return true;
 }
 
 void save_summercart(const std::filesystem::path& path)
 {
-    uint32_t n;
-    void* buf;
-    FILE* sdf;
-    FILE* stf;
-    struct vhd vhd;
-    const auto smc_path = g_core->get_summercart_path();
+    if (!sd_open(L"Save error"))
+        return;
 
-    if ((buf = malloc(512 * (n = 128))))
+    if (!card.session)
     {
-        if ((sdf = fopen(smc_path.string().c_str(), "rb")))
+        card.session = sd_hash_base();
+        if (!sd_save_base())
         {
-            if ((stf = fopen(path.string().c_str(), "wb")))
-            {
-                vhd_copy(&vhd, stf, sdf, buf, n);
-                fwrite(&summercart, 1, sizeof(struct summercart), stf);
-                fwrite(&vhd, 1, sizeof(struct vhd), stf);
-                fclose(stf);
-            }
-            else
-                sd_error(L"Could not open SD state file.", L"Save error");
-            fclose(sdf);
+            card.session = 0;
+            sd_error(L"Could not write SD base image.", L"Save error");
+            return;
         }
-        else
-            sd_error(L"Could not open SD image file.", L"Save error");
     }
-    else
-        sd_error(L"Could not allocate buffer.", L"Save error");
+
+    std::vector<uint32_t> sectors;
+    for (uint32_t sector = 0; sector < card.sector_count; ++sector)
+    {
+        if (sd_is_dirty(sector))
+            sectors.push_back(sector);
+    }
+
+    FILE* f = _wfopen(path.wstring().c_str(), L"wb");
+    if (!f)
+    {
+        sd_error(L"Could not open SD state file.", L"Save error");
+        return;
+    }
+
+    sd_overlay_header header{};
+    memcpy(header.magic, SD_OVERLAY_MAGIC, sizeof(header.magic));
+    header.version = SD_OVERLAY_VERSION;
+    header.session = card.session;
+    header.sector_count = (uint32_t)sectors.size();
+
+    fwrite(&header, 1, sizeof(header), f);
+    fwrite(sectors.data(), sizeof(uint32_t), sectors.size(), f);
+    for (const auto sector : sectors)
+        fwrite(card.data + (size_t)sector * SD_SECTOR_SIZE, 1, SD_SECTOR_SIZE, f);
+    fwrite(&summercart, 1, sizeof(struct summercart), f);
+    fclose(f);
 }
 
 void load_summercart(const std::filesystem::path& path)
 {
-    uint32_t n;
-    void* buf;
-    FILE* stf;
-    FILE* sdf;
-    struct vhd vhd;
-    const auto smc_path = g_core->get_summercart_path();
-    if ((buf = malloc(512 * (n = 128))))
+    if (path.empty())
+        return;
+
+    if (!sd_open(L"Load error"))
+        return;
+
+    FILE* f = _wfopen(path.wstring().c_str(), L"rb");
+    if (!f)
+    {
+        sd_error(L"Could not open SD state file.", L"Load error");
+        return;
+    }
+
+    sd_overlay_header header{};
+    if (fread(&header, 1, sizeof(header), f) != sizeof(header) || memcmp(header.magic, SD_OVERLAY_MAGIC, sizeof(header.magic)) || header.version != SD_OVERLAY_VERSION || header.sector_count > card.sector_count)
+    {
+        fclose(f);
+        sd_error(L"Invalid SD state file.", L"Load error");
+        return;
+    }
+
+    std::vector<uint32_t> sectors(header.sector_count);
+    std::vector<uint8_t> overlay((size_t)header.sector_count * SD_SECTOR_SIZE);
+    struct summercart state;
+    const bool complete = fread(sectors.data(), sizeof(uint32_t), sectors.size(), f) == sectors.size()
+    && fread(overlay.data(), 1, overlay.size(), f) == overlay.size()
+    && fread(&state, 1, sizeof(state), f) == sizeof(state);
+    fclose(f);
+
+    if (!complete || std::ranges::any_of(sectors, [](uint32_t sector) { return sector >= card.sector_count; }))
     {
-        if ((stf = fopen(smc_path.string().c_str(), "rb")))
+        sd_error(L"Invalid SD state file.", L"Load error");
+        return;
+    }
+
+    const size_t size = (size_t)card.sector_count * SD_SECTOR_SIZE;
+    if (header.session == card.session)
+    {
+        // Revert to our base, which we have journaled
+        for (const auto& [sector, original] : card.originals)
         {
-            if ((sdf = fopen(path.string().c_str(), "wb")))
-            {
-                vhd_copy(&vhd, sdf, stf, buf, n);
-                fread(&summercart, 1, sizeof(struct summercart), stf);
-                fwrite(&vhd, 1, sizeof(struct vhd), sdf);
-                fclose(sdf);
-            }
-            else
-                sd_error(L"Could not open SD image file.", L"Load error");
-            fclose(stf);
+            if (sd_is_dirty(sector))
+                memcpy(card.data + (size_t)sector * SD_SECTOR_SIZE, original.get(), SD_SECTOR_SIZE);
         }
-        else
-            sd_error(L"Could not open SD state file.", L"Load error");
-        free(buf);
     }
     else
-        sd_error(L"Could not allocate buffer.", L"Load error");
+    {
+        // The state belongs to another session, so we switch over to its base
+        FILE* base = _wfopen(sd_get_base_path(header.session).wstring().c_str(), L"rb");
+        if (!base)
+        {
+            sd_error(L"Could not open the SD base image of this state.", L"Load error");
+            return;
+        }
+        const bool read = fread(card.data, 1, size, base) == size;
+        fclose(base);
+        if (!read)
+        {
+            sd_error(L"Could not read the SD base image of this state.", L"Load error");
+            return;
+        }
+        card.originals.clear();
+        card.session = header.session;
+    }
+    std::ranges::fill(card.dirty, 0);
+
+    for (size_t i = 0; i < sectors.size(); ++i)
+    {
+        sd_touch(sectors[i]);
+        memcpy(card.data + (size_t)sectors[i] * SD_SECTOR_SIZE, overlay.data() + i * SD_SECTOR_SIZE, SD_SECTOR_SIZE);
+    }
+
+    summercart = state;
+}
+
+void close_summercart()
+{
+    sd_close();
 }
 
 void init_summercart()
@@ -21,8 +21,24 @@ struct summercart {
 
 extern struct summercart summercart;
 
+/**
+ * \brief Saves the SD card's state as an overlay over the current session's base image.
+ * \param path The overlay file's path.
+ */
 void save_summercart(const std::filesystem::path& path);
+
+/**
+ * \brief Restores the SD card's state from an overlay file.
+ * \param path The overlay file's path. If empty, nothing is restored.
+ */
 void load_summercart(const std::filesystem::path& path);
+
 void init_summercart();
+
+/**
+ * \brief Flushes and unmaps the SD card image.
+ */
+void close_summercart();
+
 uint32_t read_summercart(uint32_t address);
 void write_summercart(uint32_t address, uint32_t value);
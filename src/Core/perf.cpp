@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include <Core.h>
+#include <perf.h>
+#include <r4300/r4300.h>
+#include <r4300/macros.h>
+
+// Count deltas above this are treated as Count having been overwritten (e.g. by an MTC0) rather than as executed instructions
+constexpr uint32_t MAX_COUNT_DELTA = 0x10000000;
+
+struct t_perf_block {
+    std::atomic<uint64_t> values[core_perf_counter_count]{};
+};
+
+/**
+ * \brief Owns the current thread's counter block, and folds its values into the retired block when the thread exits.
+ */
+struct t_perf_thread {
+    std::shared_ptr<t_perf_block> block;
+
+    t_perf_thread();
+    ~t_perf_thread();
+};
+
+// Guards the block list and the retired block
+static std::mutex blocks_mutex;
+static std::vector<std::shared_ptr<t_perf_block>> blocks;
+static uint64_t retired[core_perf_counter_count];
+
+// The totals at the last reset, which are subtracted from the sums since counters can't be cleared from outside their owning thread
+static uint64_t baseline[core_perf_counter_count];
+
+// Guards the frame snapshot
+static std::mutex frame_mutex;
+static core_perf_snapshot frame_snapshot;
+static core_perf_snapshot last_frame_totals;
+
+static uint32_t last_count;
+static uint64_t last_skipped_cycles;
+
+t_perf_thread::t_perf_thread()
+    : block(std::make_shared<t_perf_block>())
+{
+    std::lock_guard lock(blocks_mutex);
+    blocks.push_back(block);
+}
+
+t_perf_thread::~t_perf_thread()
+{
+    std::lock_guard lock(blocks_mutex);
+    for (size_t i = 0; i < core_perf_counter_count; ++i)
+    {
+        retired[i] += block->values[i].load(std::memory_order_relaxed);
+    }
+    std::erase(blocks, block);
+}
+
+static thread_local t_perf_thread perf_thread;
+
+void perf_add(core_perf_counter counter, uint64_t value)
+{
+    // Only the owning thread writes to its block, so a relaxed load and store can't lose updates
+    auto& v = perf_thread.block->values[counter];
+    v.store(v.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Sums up the counters of all threads since the core was initialized.
+ */
+static void get_raw_totals(core_perf_snapshot* snapshot)
+{
+    std::lock_guard lock(blocks_mutex);
+    memcpy(snapshot->values, retired, sizeof(retired));
+    for (const auto& block : blocks)
+    {
+        for (size_t i = 0; i < core_perf_counter_count; ++i)
+        {
+            snapshot->values[i] += block->values[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void perf_sync_count()
+{
+    last_count = core_Count;
+    last_skipped_cycles = g_vr_idle_loop_skipped_cycles;
+}
+
+void perf_on_frame()
+{
+    // Count advances by 2 per instruction, and skipped idle loops advance it without executing anything
+    const uint32_t count_delta = core_Count - last_count;
+    const uint64_t skipped_delta = g_vr_idle_loop_skipped_cycles - last_skipped_cycles;
+    perf_sync_count();
+
+    if (count_delta <= MAX_COUNT_DELTA && count_delta >= skipped_delta)
+    {
+        core_perf_counter counter = core_perf_instructions_cached_interp;
+        if (dynacore)
+        {
+            counter = core_perf_instructions_dynarec;
+        }
+        else if (interpcore)
+        {
+            counter = core_perf_instructions_pure_interp;
+        }
+        perf_add(counter, (count_delta - skipped_delta) / 2);
+    }
+
+    core_perf_snapshot totals;
+    get_raw_totals(&totals);
+
+    std::lock_guard lock(frame_mutex);
+    for (size_t i = 0; i < core_perf_counter_count; ++i)
+    {
+        frame_snapshot.values[i] = totals.values[i] - last_frame_totals.values[i];
+    }
+    last_frame_totals = totals;
+}
+
+void core_perf_get_totals(core_perf_snapshot* snapshot)
+{
+    get_raw_totals(snapshot);
+
+    std::lock_guard lock(blocks_mutex);
+    for (size_t i = 0; i < core_perf_counter_count; ++i)
+    {
+        snapshot->values[i] -= baseline[i];
+    }
+}
+
+void core_perf_get_frame(core_perf_snapshot* snapshot)
+{
+    std::lock_guard lock(frame_mutex);
+    *snapshot = frame_snapshot;
+}
+
+void core_perf_reset()
+{
+    core_perf_snapshot totals;
+    get_raw_totals(&totals);
+
+    std::lock_guard lock(blocks_mutex);
+    memcpy(baseline, totals.values, sizeof(baseline));
+}
+
+const wchar_t* core_perf_get_counter_name(core_perf_counter counter)
+{
+    static constexpr const wchar_t* names[] = {
+    L"Instructions (Cached Interpreter)",
+    L"Instructions (Dynarec)",
+    L"Instructions (Pure Interpreter)",
+    L"Blocks Compiled",
+    L"Pages Invalidated",
+    L"Code Cache Flushes",
+    L"VI Interrupts",
+    L"Compare Interrupts",
+    L"Check Interrupts",
+    L"SI Interrupts",
+    L"PI Interrupts",
+    L"AI Interrupts",
+    L"SP Interrupts",
+    L"DP Interrupts",
+    L"Special Interrupts",
+    L"updateScreen Calls",
+    L"ProcessRDPList Calls",
+    L"ViStatusChanged Calls",
+    L"ViWidthChanged Calls",
+    L"DoRspCycles Calls",
+    L"AiLenChanged Calls",
+    L"AiDacrateChanged Calls",
+    L"AiUpdate Calls",
+    L"GetKeys Calls",
+    L"ControllerCommand Calls",
+    L"ReadController Calls",
+    L"updateScreen Time (ns)",
+    L"ProcessRDPList Time (ns)",
+    L"ViStatusChanged Time (ns)",
+    L"ViWidthChanged Time (ns)",
+    L"DoRspCycles Time (ns)",
+    L"AiLenChanged Time (ns)",
+    L"AiDacrateChanged Time (ns)",
+    L"AiUpdate Time (ns)",
+    L"GetKeys Time (ns)",
+    L"ControllerCommand Time (ns)",
+    L"ReadController Time (ns)",
+    L"Savestate Saves",
+    L"Savestate Save Time (ns)",
+    L"Savestate Save Bytes",
+    L"Savestate Loads",
+    L"Savestate Load Time (ns)",
+    L"Savestate Load Bytes",
+    };
+    static_assert(std::size(names) == core_perf_counter_count);
+
+    if (counter < 0 || counter >= core_perf_counter_count)
+    {
+        return L"";
+    }
+    return names[counter];
+}
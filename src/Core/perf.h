@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * Performance counters are accumulated in per-thread blocks which only their owning thread writes to, so incrementing one is a plain load and store without any synchronization.
+ * Readers sum up all blocks, and a per-frame snapshot is taken on the emulation thread when a frame is generated.
+ */
+
+/**
+ * \brief Adds a value to a performance counter of the current thread.
+ */
+void perf_add(core_perf_counter counter, uint64_t value = 1);
+
+/**
+ * \brief Measures the time spent in a scope and accounts it to a plugin entry point's call and time counters.
+ */
+struct perf_scope {
+    explicit perf_scope(core_perf_counter calls_counter)
+        : calls_counter(calls_counter), start(std::chrono::high_resolution_clock::now())
+    {
+    }
+
+    ~perf_scope()
+    {
+        const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        perf_add(calls_counter);
+        perf_add((core_perf_counter)(calls_counter - core_perf_calls_video_update_screen + core_perf_time_video_update_screen), std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    perf_scope(const perf_scope&) = delete;
+    perf_scope& operator=(const perf_scope&) = delete;
+
+private:
+    core_perf_counter calls_counter;
+    std::chrono::high_resolution_clock::time_point start;
+};
+
+/**
+ * \brief Calls a plugin entry point and accounts the call to its performance counters.
+ * \param calls_counter The entry point's call counter.
+ * \param fn The entry point.
+ * \param args The arguments to pass to the entry point.
+ * \return The entry point's return value.
+ */
+template <typename Fn, typename... Args>
+decltype(auto) perf_call(core_perf_counter calls_counter, Fn fn, Args&&... args)
+{
+    const perf_scope scope(calls_counter);
+    return fn(std::forward<Args>(args)...);
+}
+
+/**
+ * \brief Resynchronizes the instruction counters with the COP0 Count register. Must be called after Count is overwritten, e.g. on reset or savestate load.
+ */
+void perf_sync_count();
+
+/**
+ * \brief To be called by the emulation thread when a new frame is generated. Accounts executed instructions and takes the per-frame snapshot.
+ */
+void perf_on_frame();
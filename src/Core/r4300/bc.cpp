@@ -51,7 +51,7 @@ void BC1F_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BC1F();
     }
@@ -100,7 +100,7 @@ void BC1T_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BC1T();
     }
@@ -159,7 +159,7 @@ void BC1FL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BC1FL();
     }
@@ -218,7 +218,7 @@ void BC1TL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BC1TL();
     }
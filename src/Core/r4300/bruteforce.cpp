@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * The input search is driven entirely from the emulation thread's controller polls.
+ * Each candidate starts with a load of the search's savestate, which is done by the savestate work at the start of the next poll.
+ * The candidate's inputs are then fed to the searched controller for the following polls, and the objective is evaluated at the poll after the last input.
+ */
+
+#include "stdafx.h"
+#include <Core.h>
+#include <include/core_api.h>
+#include <memory/memory.h>
+#include <r4300/bruteforce.h>
+#include <r4300/r4300.h>
+
+struct t_candidate {
+    // The candidate's score, which is higher for better candidates regardless of the goal
+    double fitness;
+    double value;
+    std::vector<core_buttons> inputs;
+};
+
+// Guards the population and the evaluation count for readers on other threads. The remaining state is only touched by the emulation thread while the search is active.
+static std::mutex search_mutex;
+static std::atomic<bool> active;
+static std::atomic<bool> stop_requested;
+static std::atomic<bool> loading;
+
+static core_bf_params params;
+static std::vector<t_candidate> population;
+static size_t evaluated;
+static t_candidate candidate;
+static size_t frame;
+static std::mt19937 rng;
+
+/**
+ * \brief Reads an RDRAM value of the specified type.
+ */
+static double read_value(uint32_t address, core_rs_type type)
+{
+    const auto ram = (uint8_t*)rdram;
+    switch (type)
+    {
+    case core_rs_type_u8:
+        return core_rdram_load<uint8_t>(ram, address);
+    case core_rs_type_s8:
+        return core_rdram_load<int8_t>(ram, address);
+    case core_rs_type_u16:
+        return core_rdram_load<uint16_t>(ram, address);
+    case core_rs_type_s16:
+        return core_rdram_load<int16_t>(ram, address);
+    case core_rs_type_u32:
+        return core_rdram_load<uint32_t>(ram, address);
+    case core_rs_type_s32:
+        return core_rdram_load<int32_t>(ram, address);
+    case core_rs_type_float:
+        return core_rdram_load<float>(ram, address);
+    }
+    return 0.0;
+}
+
+static size_t get_type_size(core_rs_type type)
+{
+    switch (type)
+    {
+    case core_rs_type_u8:
+    case core_rs_type_s8:
+        return 1;
+    case core_rs_type_u16:
+    case core_rs_type_s16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+static double get_fitness(double value)
+{
+    if (std::isnan(value))
+    {
+        return -INFINITY;
+    }
+
+    switch (params.goal)
+    {
+    case core_bf_goal_minimize:
+        return -value;
+    case core_bf_goal_target:
+        return -fabs(value - params.target);
+    default:
+        return value;
+    }
+}
+
+/**
+ * \brief Generates a random input within the search's input space. Buttons outside the button mask and axes without a range are taken from the specified input.
+ */
+static core_buttons random_input(core_buttons base)
+{
+    core_buttons input{};
+    input.value = (base.value & ~params.button_mask & 0xFFFF) | (rng() & params.button_mask & 0xFFFF);
+    input.x = params.x_min == 0 && params.x_max == 0 ? base.x : std::uniform_int_distribution<int32_t>(params.x_min, params.x_max)(rng);
+    input.y = params.y_min == 0 && params.y_max == 0 ? base.y : std::uniform_int_distribution<int32_t>(params.y_min, params.y_max)(rng);
+    return input;
+}
+
+/**
+ * \brief Picks the next candidate by mutating one of the best candidates.
+ */
+static void next_candidate()
+{
+    // The better of two random picks is mutated, which favours good candidates without starving the others
+    const size_t a = rng() % population.size();
+    const size_t b = rng() % population.size();
+    candidate.inputs = population[std::min(a, b)].inputs;
+
+    // Mostly single-frame changes, with an exponentially decreasing chance of changing more frames at once
+    size_t changes = 1;
+    while (changes < params.frames && (rng() & 1))
+    {
+        ++changes;
+    }
+
+    for (size_t i = 0; i < changes; ++i)
+    {
+        const size_t f = rng() % params.frames;
+
+        // Games often expect inputs to be held, so copying a neighbouring frame's input is as likely as a random one
+        if (f > 0 && (rng() & 1))
+        {
+            candidate.inputs[f] = candidate.inputs[f - 1];
+        }
+        else
+        {
+            candidate.inputs[f] = random_input(candidate.inputs[f]);
+        }
+    }
+}
+
+/**
+ * \brief Scores the current candidate and adds it to the population if it's among the best.
+ */
+static void evaluate()
+{
+    double value = 0.0;
+    if (params.objective)
+    {
+        value = params.objective();
+    }
+    else
+    {
+        for (const auto& term : params.terms)
+        {
+            value += read_value(term.address, term.type) * term.weight;
+        }
+    }
+
+    candidate.value = value;
+    candidate.fitness = get_fitness(value);
+
+    std::lock_guard lock(search_mutex);
+    ++evaluated;
+
+    // Candidates which aren't better than the worst kept one are pruned
+    if (population.size() >= params.keep && candidate.fitness <= population.back().fitness)
+    {
+        return;
+    }
+
+    const auto it = std::ranges::upper_bound(population, candidate.fitness, std::greater{}, &t_candidate::fitness);
+    population.insert(it, candidate);
+    if (population.size() > params.keep)
+    {
+        population.pop_back();
+    }
+}
+
+static void on_base_state_loaded(core_result result, const std::vector<uint8_t>&)
+{
+    if (result != Res_Ok)
+    {
+        g_core->log_error(std::format(L"[BF] Savestate load failed with error {}, stopping search", (int32_t)result));
+        active.store(false, std::memory_order_release);
+        return;
+    }
+
+    frame = 0;
+    loading.store(false, std::memory_order_release);
+}
+
+static void load_base_state()
+{
+    loading.store(true, std::memory_order_release);
+    core_st_do_memory(params.state, core_st_job_load, on_base_state_loaded, true);
+}
+
+/**
+ * \brief Ends the search and restores its savestate.
+ */
+static void finish()
+{
+    g_core->log_info(std::format(L"[BF] Search finished after {} candidates", evaluated));
+    core_st_do_memory(params.state, core_st_job_load, [](const core_result result, const std::vector<uint8_t>&) {
+        if (result != Res_Ok)
+        {
+            g_core->log_error(std::format(L"[BF] Failed to restore the starting savestate (error {})", (int32_t)result));
+        }
+    },
+                      true);
+    active.store(false, std::memory_order_release);
+}
+
+bool bf_is_active()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+bool bf_on_controller_poll(int32_t index, core_buttons* input)
+{
+    if (!active.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    // Polls before the savestate is loaded and polls of other controllers are held at neutral
+    input->value = 0;
+    if (index != params.controller || loading.load(std::memory_order_acquire))
+    {
+        return true;
+    }
+
+    if (stop_requested.load(std::memory_order_relaxed))
+    {
+        finish();
+        return true;
+    }
+
+    if (frame < params.frames)
+    {
+        *input = candidate.inputs[frame++];
+        return true;
+    }
+
+    // The previous poll's input has been processed by now, so RDRAM reflects the effects of the whole candidate
+    evaluate();
+
+    if (evaluated >= params.iterations)
+    {
+        finish();
+        return true;
+    }
+
+    next_candidate();
+    load_base_state();
+    return true;
+}
+
+void bf_on_core_stop()
+{
+    active.store(false, std::memory_order_release);
+}
+
+core_result core_bf_start(const core_bf_params& search_params)
+{
+    if (!emu_launched)
+    {
+        return VR_NotRunning;
+    }
+
+    if (core_vcr_get_task() != task_idle)
+    {
+        return BF_MovieActive;
+    }
+
+    if (search_params.state.empty() || search_params.frames == 0 || search_params.iterations == 0 || search_params.keep == 0
+        || search_params.controller < 0 || search_params.controller > 3
+        || search_params.x_min > search_params.x_max || search_params.y_min > search_params.y_max
+        || (search_params.terms.empty() && !search_params.objective))
+    {
+        return BF_InvalidParameters;
+    }
+
+    for (const auto& term : search_params.terms)
+    {
+        if ((term.address & CORE_ADDR_MASK) % get_type_size(term.type) != 0)
+        {
+            return BF_InvalidParameters;
+        }
+    }
+
+    std::lock_guard lock(search_mutex);
+
+    if (active.load(std::memory_order_acquire))
+    {
+        return BF_AlreadyRunning;
+    }
+
+    params = search_params;
+
+    // The savestate is loaded once per candidate, so it's decompressed upfront instead of on every load
+    params.state = auto_decompress(params.state);
+    if (params.state.empty())
+    {
+        return BF_InvalidParameters;
+    }
+
+    population.clear();
+    evaluated = 0;
+    rng.seed(params.seed);
+
+    candidate = {};
+    candidate.inputs = params.initial;
+    candidate.inputs.resize(params.frames, core_buttons{});
+
+    stop_requested.store(false, std::memory_order_relaxed);
+
+    // The search must be active before the savestate is loaded, so no polls with other inputs can happen in between
+    active.store(true, std::memory_order_release);
+    load_base_state();
+
+    g_core->log_info(std::format(L"[BF] Search started with {} frames and {} candidates", params.frames, params.iterations));
+    return Res_Ok;
+}
+
+void core_bf_stop()
+{
+    stop_requested.store(true, std::memory_order_relaxed);
+}
+
+bool core_bf_is_running()
+{
+    return active.load(std::memory_order_acquire);
+}
+
+size_t core_bf_get_evaluated()
+{
+    std::lock_guard lock(search_mutex);
+    return evaluated;
+}
+
+void core_bf_get_results(std::vector<core_bf_result>& results)
+{
+    std::lock_guard lock(search_mutex);
+
+    results.clear();
+    results.reserve(population.size());
+    for (const auto& c : population)
+    {
+        results.push_back({.value = c.value, .inputs = c.inputs});
+    }
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * \brief Gets whether an input search is running. While it is, frames aren't rendered, audio isn't generated and emulation isn't throttled.
+ */
+bool bf_is_active();
+
+/**
+ * \brief Notifies the input search about a controller being polled.
+ * \param index The polled controller's index
+ * \param input The controller's input data
+ * \return Whether the input search provided the input, in which case the poll mustn't be handled any further.
+ */
+bool bf_on_controller_poll(int32_t index, core_buttons* input);
+
+/**
+ * \brief Stops the input search without restoring its savestate. Must be called from the emulation thread when the core stops.
+ */
+void bf_on_core_stop();
@@ -6,6 +6,7 @@
 
 #include "stdafx.h"
 #include <r4300/debugger.h>
+#include <r4300/r4300.h>
 #include <Core.h>
 
 bool g_resumed = true;
@@ -20,6 +21,18 @@ static uint32_t dummy_doRspCycles(uint32_t cycles)
     return cycles;
 }
 
+/**
+ * \brief Recompiles the cached interpreter's blocks if the debugger started or stopped observing instructions.
+ * \param was_active Whether the debugger was active before the state change.
+ */
+static void update_instrumentation(bool was_active)
+{
+    if (interpcore == 0 && was_active != Debugger::is_active())
+    {
+        core_vr_recompile(UINT32_MAX);
+    }
+}
+
 bool core_dbg_get_resumed()
 {
     return g_resumed;
@@ -27,18 +40,22 @@ bool core_dbg_get_resumed()
 
 void core_dbg_set_is_resumed(bool value)
 {
+    const bool was_active = Debugger::is_active();
     if (value)
     {
         g_instruction_advancing = false;
     }
     g_resumed = value;
+    update_instrumentation(was_active);
     g_core->callbacks.debugger_resumed_changed(g_resumed);
 }
 
 void core_dbg_step()
 {
+    const bool was_active = Debugger::is_active();
     g_instruction_advancing = true;
     g_resumed = true;
+    update_instrumentation(was_active);
 }
 
 bool core_dbg_get_dma_read_enabled()
@@ -71,6 +88,11 @@ void core_dbg_set_rsp_enabled(bool value)
         g_core->plugin_funcs.rsp_do_rsp_cycles = dummy_doRspCycles;
 }
 
+bool Debugger::is_active()
+{
+    return !g_resumed || g_instruction_advancing;
+}
+
 void Debugger::on_late_cycle(uint32_t opcode, uint32_t address)
 {
     g_cpu_state = {
@@ -8,6 +8,11 @@
 
 namespace Debugger
 {
+    /**
+     * \brief Gets whether the debugger needs to observe every instruction, i.e. it's paused or stepping
+     */
+    bool is_active();
+
     /**
      * \brief Notifies the debugger of a processor cycle ending
      * \param opcode The processor's opcode
@@ -10,12 +10,14 @@
 #include <Core.h>
 #include <r4300/interrupt.h>
 #include <memory/memory.h>
+#include <r4300/bruteforce.h>
 #include <r4300/r4300.h>
 #include <r4300/macros.h>
 #include <r4300/exception.h>
 #include <r4300/vcr.h>
 #include <r4300/timers.h>
 #include <memory/pif.h>
+#include <perf.h>
 
 typedef struct _interrupt_queue {
     int32_t type;
@@ -491,6 +493,7 @@ void gen_interrupt()
     switch (q->type)
     {
     case SPECIAL_INT: // does nothing, spammed when Count is close to rolling over
+        perf_add(core_perf_interrupts_special);
         // g_core->log_info(L"SPECIAL, count: {:#06x}", q->count);
         if (core_Count > 0x10000000)
             return;
@@ -501,6 +504,8 @@ void gen_interrupt()
 
     case VI_INT:
         {
+            perf_add(core_perf_interrupts_vi);
+
             lag_count++;
 
             // NOTE: It's ok to not update screen when lagging, doesn't cause any obvious issues
@@ -509,9 +514,12 @@ void gen_interrupt()
 
             // NOTE: When frame advancing, screen_invalidated has a higher change of being false despite the fact it should be true
             // The update-limiting logic doesn't apply in frameadvance because there are no high-frequency updates
-            if (update || frame_advance_outstanding)
+            if ((update || frame_advance_outstanding) && !bf_is_active())
             {
-                g_core->update_screen();
+                {
+                    const perf_scope scope(core_perf_calls_video_update_screen);
+                    g_core->update_screen();
+                }
                 screen_invalidated = false;
             }
 
@@ -540,6 +548,7 @@ void gen_interrupt()
             break;
         }
     case COMPARE_INT: // game can set Compare register to some value, and make a timer like that
+        perf_add(core_perf_interrupts_compare);
         // g_core->log_info(L"COMPARE, count: {:#06x}", q->count);
         remove_interrupt_event();
         core_Count += 2;
@@ -548,6 +557,7 @@ void gen_interrupt()
         break;
 
     case CHECK_INT: // fake interrupt used to trigger exception handler (when interrupt is pending)
+        perf_add(core_perf_interrupts_check);
         // g_core->log_info(L"CHECK, count: {:#06x}", q->count);
         remove_interrupt_event();
         break;
@@ -555,6 +565,7 @@ void gen_interrupt()
     // serial interface, means that PIF copy/write happened (controllers)
     // notice this is spammed a lot during loading
     case SI_INT:
+        perf_add(core_perf_interrupts_si);
         // g_core->log_info(L"SI, count: {:#06x}", q->count);
         PIF_RAMb[0x3F] = 0x0;
         remove_interrupt_event();
@@ -564,6 +575,7 @@ void gen_interrupt()
 
     // peripherial interface, dma between cartridge and rdram finished
     case PI_INT:
+        perf_add(core_perf_interrupts_pi);
         // g_core->log_info(L"PI, count: {:#06x}", q->count);
         remove_interrupt_event();
         MI_register.mi_intr_reg |= 0x10;
@@ -571,6 +583,8 @@ void gen_interrupt()
         break;
 
     case AI_INT:
+        perf_add(core_perf_interrupts_ai);
+        audio_pump_notify();
         // g_core->log_info(L"AI, count: {:#06x}", q->count);
         if (ai_register.ai_status & 0x80000000) // full
         {
@@ -597,6 +611,7 @@ void gen_interrupt()
         break;
 
     case SP_INT: // related to rsp
+        perf_add(core_perf_interrupts_sp);
         // g_core->log_info(L"SP, count: {:#06x}", q->count);
         remove_interrupt_event();
         sp_register.sp_status_reg |= 0x303;
@@ -611,6 +626,7 @@ void gen_interrupt()
         break;
 
     case DP_INT:
+        perf_add(core_perf_interrupts_dp);
         // g_core->log_info(L"DP, count: {:#06x}", q->count);
         remove_interrupt_event();
         dpc_register.dpc_status &= ~2;
@@ -483,7 +483,7 @@ static void BLTZ()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -514,7 +514,7 @@ static void BGEZ()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -545,7 +545,7 @@ static void BLTZL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -580,7 +580,7 @@ static void BGEZL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -618,7 +618,7 @@ static void BLTZAL()
                     skip = next_interrupt - core_Count;
                     if (skip > 3)
                     {
-                        core_Count += (skip & 0xFFFFFFFC);
+                        skip_count(skip & 0xFFFFFFFC);
                         return;
                     }
                 }
@@ -655,7 +655,7 @@ static void BGEZAL()
                     skip = next_interrupt - core_Count;
                     if (skip > 3)
                     {
-                        core_Count += (skip & 0xFFFFFFFC);
+                        skip_count(skip & 0xFFFFFFFC);
                         return;
                     }
                 }
@@ -692,7 +692,7 @@ static void BLTZALL()
                     skip = next_interrupt - core_Count;
                     if (skip > 3)
                     {
-                        core_Count += (skip & 0xFFFFFFFC);
+                        skip_count(skip & 0xFFFFFFFC);
                         return;
                     }
                 }
@@ -733,7 +733,7 @@ static void BGEZALL()
                     skip = next_interrupt - core_Count;
                     if (skip > 3)
                     {
-                        core_Count += (skip & 0xFFFFFFFC);
+                        skip_count(skip & 0xFFFFFFFC);
                         return;
                     }
                 }
@@ -1154,7 +1154,7 @@ static void BC1F()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -1184,7 +1184,7 @@ static void BC1T()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -1214,7 +1214,7 @@ static void BC1FL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -1248,7 +1248,7 @@ static void BC1TL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -2223,7 +2223,7 @@ static void REGIMM()
         skip = next_interrupt - core_Count;    \
         if (skip > 3)                          \
         {                                      \
-            core_Count += (skip & 0xFFFFFFFC); \
+            skip_count(skip & 0xFFFFFFFC);    \
             return;                            \
         }                                      \
     }
@@ -2443,7 +2443,7 @@ static void BEQL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -2482,7 +2482,7 @@ static void BNEL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -2520,7 +2520,7 @@ static void BLEZL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
@@ -2558,7 +2558,7 @@ static void BGTZL()
                 skip = next_interrupt - core_Count;
                 if (skip > 3)
                 {
-                    core_Count += (skip & 0xFFFFFFFC);
+                    skip_count(skip & 0xFFFFFFFC);
                     return;
                 }
             }
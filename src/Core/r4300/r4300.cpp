@@ -8,7 +8,10 @@
 #include <Core.h>
 #include <memory/memory.h>
 #include <memory/pif.h>
+#include <memory/savedata.h>
+#include <memory/summercart.h>
 #include <memory/savestates.h>
+#include <r4300/bruteforce.h>
 #include <r4300/exception.h>
 #include <r4300/interrupt.h>
 #include <r4300/macros.h>
@@ -17,6 +20,7 @@
 #include <r4300/recomp.h>
 #include <r4300/timers.h>
 #include <r4300/vcr.h>
+#include <perf.h>
 
 #ifdef WIN32
 // VirtualAlloc
@@ -28,12 +32,27 @@ std::thread audio_thread_handle;
 
 std::atomic<bool> audio_thread_stop_requested;
 
+// The audio thread ticks the audio plugin at a fraction of the current AI buffer's playback time, within these bounds
+constexpr auto AUDIO_PUMP_MIN_INTERVAL = std::chrono::milliseconds(1);
+constexpr auto AUDIO_PUMP_MAX_INTERVAL = std::chrono::milliseconds(8);
+
+// How many buffer playback times the audio thread keeps ticking after the AI was last fed before it parks
+constexpr int32_t AUDIO_PUMP_LINGER_BUFFERS = 2;
+
+// Guards audio_pump_signaled and the audio thread's parking
+static std::mutex audio_pump_mutex;
+static std::condition_variable audio_pump_cv;
+static bool audio_pump_signaled;
+
 // Lock to prevent emu state change race conditions
 std::recursive_mutex g_emu_cs;
 
 std::filesystem::path rom_path;
 
 bool g_vr_beq_ignore_jmp;
+std::atomic<bool> g_vr_block_exit_requested;
+bool g_vr_idle_loop_detection;
+uint64_t g_vr_idle_loop_skipped_cycles;
 volatile bool emu_launched = false;
 volatile bool emu_paused = false;
 volatile bool core_executing = false;
@@ -63,6 +82,8 @@ precomp_instr* PC;
 char invalid_code[0x100000];
 std::atomic<bool> screen_invalidated = true;
 precomp_block *blocks[0x100000], *actual;
+// Pages with an allocated block. Lets init and teardown skip the untouched parts of blocks, which would otherwise be paged in by scanning it.
+static std::vector<uint32_t> allocated_blocks;
 int32_t rounding_mode = MUP_ROUND_NEAREST;
 int32_t trunc_mode = MUP_ROUND_TRUNC, round_mode = MUP_ROUND_NEAREST, ceil_mode = MUP_ROUND_CEIL, floor_mode = MUP_ROUND_FLOOR;
 int16_t x87_status_word;
@@ -73,11 +94,6 @@ bool g_vr_fast_forward;
 bool g_vr_frame_skipped;
 core_system_type g_sys_type;
 
-FILE* g_eeprom_file;
-FILE* g_sram_file;
-FILE* g_fram_file;
-FILE* g_mpak_file;
-
 /*#define check_memory() \
    if (!invalid_code[address>>12]) \
        invalid_code[address>>12] = 1;*/
@@ -92,26 +108,6 @@ void core_vr_invalidate_visuals()
     screen_invalidated = true;
 }
 
-std::filesystem::path get_sram_path()
-{
-    return std::format(L"{}{} {}.sra", g_core->get_saves_directory().wstring(), string_to_wstring((const char*)ROM_HEADER.nom), core_vr_country_code_to_country_name(ROM_HEADER.Country_code));
-}
-
-std::filesystem::path get_eeprom_path()
-{
-    return std::format(L"{}{} {}.eep", g_core->get_saves_directory().wstring(), string_to_wstring((const char*)ROM_HEADER.nom), core_vr_country_code_to_country_name(ROM_HEADER.Country_code));
-}
-
-std::filesystem::path get_flashram_path()
-{
-    return std::format(L"{}{} {}.fla", g_core->get_saves_directory().wstring(), string_to_wstring((const char*)ROM_HEADER.nom), core_vr_country_code_to_country_name(ROM_HEADER.Country_code));
-}
-
-std::filesystem::path get_mempak_path()
-{
-    return std::format(L"{}{} {}.mpk", g_core->get_saves_directory().wstring(), string_to_wstring((const char*)ROM_HEADER.nom), core_vr_country_code_to_country_name(ROM_HEADER.Country_code));
-}
-
 void core_vr_resume_emu()
 {
     if (emu_launched)
@@ -133,6 +129,7 @@ void core_vr_pause_emu()
     if (emu_launched)
     {
         emu_paused = 1;
+        savedata_flush();
     }
 
     g_core->callbacks.emu_paused_changed(emu_paused);
@@ -260,7 +257,7 @@ void J_IDLE()
     update_count();
     skip = next_interrupt - core_Count;
     if (skip > 3)
-        core_Count += (skip & 0xFFFFFFFC);
+        skip_count(skip & 0xFFFFFFFC);
     else
         J();
 }
@@ -311,7 +308,7 @@ void JAL_IDLE()
     update_count();
     skip = next_interrupt - core_Count;
     if (skip > 3)
-        core_Count += (skip & 0xFFFFFFFC);
+        skip_count(skip & 0xFFFFFFFC);
     else
         JAL();
 }
@@ -357,7 +354,7 @@ void BEQ_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BEQ();
     }
@@ -406,7 +403,7 @@ void BNE_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BNE();
     }
@@ -453,7 +450,7 @@ void BLEZ_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLEZ();
     }
@@ -500,7 +497,7 @@ void BGTZ_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGTZ();
     }
@@ -618,7 +615,7 @@ void BEQL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BEQL();
     }
@@ -679,7 +676,7 @@ void BNEL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BNEL();
     }
@@ -740,7 +737,7 @@ void BLEZL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLEZL();
     }
@@ -801,7 +798,7 @@ void BGTZL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGTZL();
     }
@@ -1580,16 +1577,7 @@ inline void jump_to_func()
     actual = blocks[addr >> 12];
     if (invalid_code[addr >> 12])
     {
-        if (!blocks[addr >> 12])
-        {
-            blocks[addr >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-            actual = blocks[addr >> 12];
-            blocks[addr >> 12]->code = NULL;
-            blocks[addr >> 12]->block = NULL;
-            blocks[addr >> 12]->jumps_table = NULL;
-        }
-        blocks[addr >> 12]->start = addr & ~0xFFF;
-        blocks[addr >> 12]->end = (addr & ~0xFFF) + 0x1000;
+        actual = alloc_block(addr);
         init_block((int32_t*)(rdram + (((paddr - (addr - blocks[addr >> 12]->start)) & 0x1FFFFFFF) >> 2)),
                    blocks[addr >> 12]);
     }
@@ -1629,23 +1617,64 @@ void update_count()
     }
 }
 
+void skip_count(uint32_t cycles)
+{
+    core_Count += cycles;
+    g_vr_idle_loop_skipped_cycles += cycles;
+}
+
+precomp_block* alloc_block(uint32_t addr)
+{
+    precomp_block*& block = blocks[addr >> 12];
+    if (!block)
+    {
+        block = (precomp_block*)malloc(sizeof(precomp_block));
+        block->code = NULL;
+        block->block = NULL;
+        block->reg_cache = NULL;
+        block->jumps_table = NULL;
+        block->hash = 0;
+        block->start = addr & ~0xFFF;
+        block->end = (addr & ~0xFFF) + 0x1000;
+        allocated_blocks.push_back(addr >> 12);
+    }
+    return block;
+}
+
+void free_blocks()
+{
+    for (const auto page : allocated_blocks)
+    {
+        precomp_block*& block = blocks[page];
+        if (block->block)
+        {
+            free(block->block);
+        }
+        if (block->reg_cache)
+        {
+            free(block->reg_cache);
+        }
+        if (block->code)
+        {
+            free_exec(block->code);
+        }
+        if (block->jumps_table)
+        {
+            free(block->jumps_table);
+        }
+        free(block);
+        block = NULL;
+    }
+    allocated_blocks.clear();
+}
+
 void init_blocks()
 {
-    int32_t i;
-    for (i = 0; i < 0x100000; i++)
-    {
-        invalid_code[i] = 1;
-        blocks[i] = NULL;
-    }
-    blocks[0xa4000000 >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-    invalid_code[0xa4000000 >> 12] = 1;
-    blocks[0xa4000000 >> 12]->code = NULL;
-    blocks[0xa4000000 >> 12]->block = NULL;
-    blocks[0xa4000000 >> 12]->jumps_table = NULL;
-    blocks[0xa4000000 >> 12]->start = 0xa4000000;
-    blocks[0xa4000000 >> 12]->end = 0xa4001000;
-    actual = blocks[0xa4000000 >> 12];
-    init_block((int32_t*)SP_DMEM, blocks[0xa4000000 >> 12]);
+    free_blocks();
+    memset(invalid_code, 1, sizeof(invalid_code));
+    perf_add(core_perf_code_cache_flushes);
+    actual = alloc_block(0xa4000000);
+    init_block((int32_t*)SP_DMEM, actual);
     PC = actual->block + (0x40 / 4);
 }
 
@@ -1661,6 +1690,7 @@ void print_stop_debug()
                                  (uint32_t)(lo >> 32),
                                  (uint32_t)lo));
     g_core->log_info(std::format(L"Executed {} ({:#08x}) instructions", debug_count, debug_count));
+    g_core->log_info(std::format(L"Idle loops skipped {} cycles", g_vr_idle_loop_skipped_cycles));
 }
 
 void core_start()
@@ -1898,6 +1928,17 @@ void core_start()
     init_interrupt();
     interpcore = 0;
 
+    g_vr_idle_loop_skipped_cycles = 0;
+    perf_sync_count();
+    {
+        // The name is trimmed when the rom is loaded, but isn't necessarily null-terminated
+        const auto nom = reinterpret_cast<const char*>(ROM_HEADER.nom);
+        const auto name = string_to_wstring(std::string(nom, strnlen(nom, sizeof(ROM_HEADER.nom))));
+        const auto it = g_core->cfg->idle_loop_detection_roms.find(name);
+        g_vr_idle_loop_detection = it != g_core->cfg->idle_loop_detection_roms.end() ? it->second == L"1" : (bool)g_core->cfg->idle_loop_detection;
+    }
+    g_core->log_info(std::format(L"idle loop detection: {}", g_vr_idle_loop_detection));
+
     if (!dynacore)
     {
         g_core->log_info(L"interpreter");
@@ -1910,6 +1951,13 @@ void core_start()
         {
             PC->ops();
             g_vr_beq_ignore_jmp = false;
+
+            // Ops never end in the middle of a branch, so the block can be swapped out under the PC here
+            if (g_vr_block_exit_requested.load(std::memory_order_relaxed))
+            {
+                g_vr_block_exit_requested = false;
+                core_vr_recompile(PC->addr & ~0xFFF);
+            }
         }
     }
     else if (dynacore == 2)
@@ -1932,110 +1980,94 @@ void core_start()
     }
     debug_count += core_Count;
     print_stop_debug();
-    for (i = 0; i < 0x100000; i++)
-    {
-        if (blocks[i] != NULL)
-        {
-            if (blocks[i]->block)
-            {
-                free(blocks[i]->block);
-                blocks[i]->block = NULL;
-            }
-            if (blocks[i]->code)
-            {
-                free_exec(blocks[i]->code);
-                blocks[i]->code = NULL;
-            }
-            if (blocks[i]->jumps_table)
-            {
-                free(blocks[i]->jumps_table);
-                blocks[i]->jumps_table = NULL;
-            }
-            free(blocks[i]);
-            blocks[i] = NULL;
-        }
-    }
+    const auto block_count = allocated_blocks.size();
+    const auto free_start_time = std::chrono::high_resolution_clock::now();
+    free_blocks();
+    g_core->log_info(std::format(L"[Core] Freed {} blocks in {}us", block_count, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - free_start_time).count()));
     if (!dynacore && interpcore)
         free(PC);
     core_executing = false;
     g_core->callbacks.core_executing_changed(core_executing);
 }
 
-bool open_core_file_stream(const std::filesystem::path& path, FILE** file)
+/**
+ * \brief Gets whether the audio thread should park, as the audio plugin doesn't need to be ticked while emulation is paused, seeking or silently fast-forwarding.
+ */
+static bool audio_pump_should_park()
 {
-    g_core->log_info(std::format(L"[Core] Opening core stream from {}...", path.wstring()));
-
-    if (!exists(path))
-    {
-        FILE* f = fopen(path.string().c_str(), "w");
-        if (!f)
-        {
-            return false;
-        }
-        fflush(f);
-        fclose(f);
-    }
-    *file = fopen(path.string().c_str(), "rb+");
-    return *file != nullptr;
+    return emu_paused || core_vcr_is_seeking() || bf_is_active() || (g_vr_fast_forward && g_core->cfg->fastforward_silent);
 }
 
-
-void clear_save_data()
+/**
+ * \brief Gets the playback time of the current AI buffer, which is derived from its length and the DAC rate.
+ */
+static std::chrono::microseconds audio_pump_get_buffer_duration()
 {
-    open_core_file_stream(get_eeprom_path(), &g_eeprom_file);
-    open_core_file_stream(get_sram_path(), &g_sram_file);
-    open_core_file_stream(get_flashram_path(), &g_fram_file);
-    open_core_file_stream(get_mempak_path(), &g_mpak_file);
+    const uint64_t clock = g_sys_type == sys_pal ? 49656530 : 48681812;
+    const uint64_t frequency = clock / (ai_register.ai_dacrate + 1);
+
+    // The AI plays 16-bit stereo samples
+    const uint64_t samples = ai_register.current_len / 4;
 
+    if (frequency == 0 || samples == 0)
     {
-        memset(sram, 0, sizeof(sram));
-        fseek(g_sram_file, 0, SEEK_SET);
-        fwrite(sram, 1, 0x8000, g_sram_file);
+        return AUDIO_PUMP_MAX_INTERVAL;
     }
+
+    return std::chrono::microseconds(samples * 1000000 / frequency);
+}
+
+void audio_pump_notify()
+{
+    if (audio_pump_should_park())
     {
-        memset(eeprom, 0, sizeof(eeprom));
-        fseek(g_eeprom_file, 0, SEEK_SET);
-        fwrite(eeprom, 1, 0x800, g_eeprom_file);
+        return;
     }
+
     {
-        fseek(g_mpak_file, 0, SEEK_SET);
-        for (auto buf : mempack)
-        {
-            memset(buf, 0, sizeof(mempack) / 4);
-            fwrite(buf, 1, 0x800, g_mpak_file);
-        }
+        std::lock_guard lock(audio_pump_mutex);
+        audio_pump_signaled = true;
     }
-
-    fclose(g_eeprom_file);
-    fclose(g_sram_file);
-    fclose(g_fram_file);
-    fclose(g_mpak_file);
+    audio_pump_cv.notify_one();
 }
 
 void audio_thread()
 {
     g_core->log_info(L"Sound thread entering...");
-    while (true)
+
+    const auto is_signaled = [] {
+        return audio_pump_signaled || audio_thread_stop_requested;
+    };
+
+    std::unique_lock lock(audio_pump_mutex);
+    auto active_until = std::chrono::steady_clock::time_point::min();
+
+    while (!audio_thread_stop_requested)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const auto now = std::chrono::steady_clock::now();
+        const auto buffer_duration = audio_pump_get_buffer_duration();
 
-        if (audio_thread_stop_requested == true)
+        if (audio_pump_signaled)
         {
-            break;
+            audio_pump_signaled = false;
+            active_until = now + buffer_duration * AUDIO_PUMP_LINGER_BUFFERS;
         }
 
-        if (g_vr_fast_forward && g_core->cfg->fastforward_silent)
+        if (now >= active_until || audio_pump_should_park())
         {
+            // Nothing is left to play out, so we park until the emulation thread feeds the AI again
+            audio_pump_cv.wait(lock, is_signaled);
             continue;
         }
 
-        if (core_vcr_is_seeking())
-        {
-            continue;
-        }
+        lock.unlock();
+        perf_call(core_perf_calls_audio_ai_update, g_core->plugin_funcs.audio_ai_update, 0);
+        lock.lock();
 
-        g_core->plugin_funcs.audio_ai_update(0);
+        const auto interval = std::clamp<std::chrono::microseconds>(buffer_duration / 4, AUDIO_PUMP_MIN_INTERVAL, AUDIO_PUMP_MAX_INTERVAL);
+        audio_pump_cv.wait_until(lock, now + interval, is_signaled);
     }
+
     g_core->log_info(L"Sound thread exiting...");
 }
 
@@ -2062,6 +2094,7 @@ void emu_thread()
     g_core->log_info(std::format(L"[Core] Emu thread entry took {}ms", static_cast<int32_t>((std::chrono::high_resolution_clock::now() - start_time).count() / 1'000'000)));
     core_start();
 
+    bf_on_core_stop();
     st_on_core_stop();
 
     g_core->plugin_funcs.video_rom_closed();
@@ -2092,7 +2125,11 @@ core_result vr_close_rom_impl(bool stop_vcr)
 
     core_vr_resume_emu();
 
-    audio_thread_stop_requested = true;
+    {
+        std::lock_guard lock(audio_pump_mutex);
+        audio_thread_stop_requested = true;
+    }
+    audio_pump_cv.notify_one();
     audio_thread_handle.join();
     audio_thread_stop_requested = false;
 
@@ -2110,14 +2147,8 @@ core_result vr_close_rom_impl(bool stop_vcr)
 
     emu_thread_handle.join();
 
-    fflush(g_eeprom_file);
-    fflush(g_sram_file);
-    fflush(g_fram_file);
-    fflush(g_mpak_file);
-    fclose(g_eeprom_file);
-    fclose(g_sram_file);
-    fclose(g_fram_file);
-    fclose(g_mpak_file);
+    savedata_close();
+    close_summercart();
 
     return Res_Ok;
 }
@@ -2178,8 +2209,7 @@ core_result vr_start_rom_impl(std::filesystem::path path)
         return VR_RomInvalid;
     }
 
-    // Open all the save file streams
-    if (!open_core_file_stream(get_eeprom_path(), &g_eeprom_file) || !open_core_file_stream(get_sram_path(), &g_sram_file) || !open_core_file_stream(get_flashram_path(), &g_fram_file) || !open_core_file_stream(get_mempak_path(), &g_mpak_file))
+    if (!savedata_open())
     {
         g_core->callbacks.emu_starting_changed(false);
         return VR_FileOpenFailed;
@@ -2246,7 +2276,7 @@ core_result vr_reset_rom_impl(bool reset_save_data, bool stop_vcr, bool skip_res
 
     if (reset_save_data)
     {
-        clear_save_data();
+        savedata_clear();
     }
 
     result = core_vr_start_rom(rom_path);
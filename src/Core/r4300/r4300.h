@@ -25,6 +25,14 @@ extern precomp_block *blocks[0x100000], *actual;
 extern void (*interp_ops[64])(void);
 extern int32_t fast_memory;
 extern bool g_vr_beq_ignore_jmp;
+
+/**
+ * \brief Makes the cached interpreter recompile the block it's running before the next instruction.
+ * \remarks Invalidated blocks are otherwise only recompiled when they're jumped to, which a block looping on itself never does.
+ */
+extern std::atomic<bool> g_vr_block_exit_requested;
+extern bool g_vr_idle_loop_detection;
+extern uint64_t g_vr_idle_loop_skipped_cycles;
 extern volatile bool emu_launched;
 extern volatile bool emu_paused;
 extern volatile bool core_executing;
@@ -58,16 +66,32 @@ extern bool g_vr_fast_forward;
 extern bool g_vr_frame_skipped;
 extern core_system_type g_sys_type;
 
-extern FILE* g_eeprom_file;
-extern FILE* g_sram_file;
-extern FILE* g_fram_file;
-extern FILE* g_mpak_file;
-
 extern bool g_vr_benchmark_enabled;
 
+/**
+ * \brief Gets the block of the page containing the specified address, allocating an empty one if the page has none yet.
+ */
+precomp_block* alloc_block(uint32_t addr);
+
+/**
+ * \brief Frees all allocated blocks.
+ */
+void free_blocks();
+
+/**
+ * \brief Wakes the audio thread after the AI was fed. The audio thread otherwise only wakes on deadlines derived from the current buffer's playback time, and parks once it has been played out.
+ */
+void audio_pump_notify();
+
 void pure_interpreter();
 extern void jump_to_func();
 void update_count();
+
+/**
+ * \brief Advances the count register without executing any instructions, e.g.: to fast-forward an idle loop to the next interrupt.
+ * The cycles are accumulated in g_vr_idle_loop_skipped_cycles, so they aren't counted as executed instructions.
+ */
+void skip_count(uint32_t cycles);
 int32_t check_cop1_unusable();
 void terminate_emu();
 
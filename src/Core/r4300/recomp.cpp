@@ -9,12 +9,14 @@
 #include <memory/memory.h>
 #include <r4300/macros.h>
 #include <r4300/ops.h>
+#include <r4300/debugger.h>
 #include <r4300/r4300.h>
 #include <r4300/recomp.h>
 #include <r4300/recomph.h>
 #include <r4300/rom.h>
 #include <r4300/tracelog.h>
 #include <r4300/x86/regcache.h>
+#include <perf.h>
 
 // global variables :
 precomp_instr* dst; // destination structure for the recompiled instruction
@@ -2531,6 +2533,13 @@ void init_block(int32_t* source, precomp_block* block)
         block->block = (precomp_instr*)malloc(((length + 1) + (length >> 2)) * sizeof(precomp_instr));
         already_exist = 0;
     }
+    if (dynacore && !block->reg_cache)
+    {
+        // The register cache is only needed by the dynarec, so the interpreters don't pay for it in every entry
+        block->reg_cache = (reg_cache_struct*)malloc(((length + 1) + (length >> 2)) * sizeof(reg_cache_struct));
+        for (i = 0; i < (length + 1) + (length >> 2); i++)
+            block->block[i].reg_cache_infos = block->reg_cache + i;
+    }
     if (dynacore)
     {
         if (!block->code)
@@ -2558,7 +2567,8 @@ void init_block(int32_t* source, precomp_block* block)
         {
             dst = block->block + i;
             dst->addr = block->start + i * 4;
-            dst->reg_cache_infos.need_map = 0;
+            if (dynacore)
+                dst->reg_cache_infos->need_map = 0;
             dst->local_addr = code_length;
 #ifdef EMU64_DEBUG
             if (dynacore)
@@ -2570,11 +2580,15 @@ void init_block(int32_t* source, precomp_block* block)
     }
     else
     {
+        // The page was compiled before and has been invalidated since
+        perf_add(core_perf_pages_invalidated);
+
         code_length = init_length;
         for (i = 0; i < length; i++)
         {
             dst = block->block + i;
-            dst->reg_cache_infos.need_map = 0;
+            if (dynacore)
+                dst->reg_cache_infos->need_map = 0;
             dst->local_addr = i * (code_length / length);
             dst->ops = NOTCOMPILED;
         }
@@ -2599,63 +2613,385 @@ void init_block(int32_t* source, precomp_block* block)
 
         paddr = virtual_to_physical_address(block->start, 2);
         invalid_code[paddr >> 12] = 0;
-        if (!blocks[paddr >> 12])
-        {
-            blocks[paddr >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-            blocks[paddr >> 12]->code = NULL;
-            blocks[paddr >> 12]->block = NULL;
-            blocks[paddr >> 12]->jumps_table = NULL;
-            blocks[paddr >> 12]->start = paddr & ~0xFFF;
-            blocks[paddr >> 12]->end = (paddr & ~0xFFF) + 0x1000;
-        }
-        init_block(0, blocks[paddr >> 12]);
+        init_block(0, alloc_block(paddr));
 
         paddr += block->end - block->start - 4;
         invalid_code[paddr >> 12] = 0;
-        if (!blocks[paddr >> 12])
-        {
-            blocks[paddr >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-            blocks[paddr >> 12]->code = NULL;
-            blocks[paddr >> 12]->block = NULL;
-            blocks[paddr >> 12]->jumps_table = NULL;
-            blocks[paddr >> 12]->start = paddr & ~0xFFF;
-            blocks[paddr >> 12]->end = (paddr & ~0xFFF) + 0x1000;
-        }
-        init_block(0, blocks[paddr >> 12]);
+        init_block(0, alloc_block(paddr));
     }
     else
     {
         if (block->start >= 0x80000000 && block->end < 0xa0000000 &&
             invalid_code[(block->start + 0x20000000) >> 12])
         {
-            if (!blocks[(block->start + 0x20000000) >> 12])
-            {
-                blocks[(block->start + 0x20000000) >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-                blocks[(block->start + 0x20000000) >> 12]->code = NULL;
-                blocks[(block->start + 0x20000000) >> 12]->block = NULL;
-                blocks[(block->start + 0x20000000) >> 12]->jumps_table = NULL;
-                blocks[(block->start + 0x20000000) >> 12]->start = (block->start + 0x20000000) & ~0xFFF;
-                blocks[(block->start + 0x20000000) >> 12]->end = ((block->start + 0x20000000) & ~0xFFF) + 0x1000;
-            }
-            init_block(0, blocks[(block->start + 0x20000000) >> 12]);
+            init_block(0, alloc_block(block->start + 0x20000000));
         }
         if (block->start >= 0xa0000000 && block->end < 0xc0000000 &&
             invalid_code[(block->start - 0x20000000) >> 12])
         {
-            if (!blocks[(block->start - 0x20000000) >> 12])
-            {
-                blocks[(block->start - 0x20000000) >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
-                blocks[(block->start - 0x20000000) >> 12]->code = NULL;
-                blocks[(block->start - 0x20000000) >> 12]->block = NULL;
-                blocks[(block->start - 0x20000000) >> 12]->jumps_table = NULL;
-                blocks[(block->start - 0x20000000) >> 12]->start = (block->start - 0x20000000) & ~0xFFF;
-                blocks[(block->start - 0x20000000) >> 12]->end = ((block->start - 0x20000000) & ~0xFFF) + 0x1000;
-            }
-            init_block(0, blocks[(block->start - 0x20000000) >> 12]);
+            init_block(0, alloc_block(block->start - 0x20000000));
         }
     }
 }
 
+/**********************************************************************
+ ********************** generalized idle loops ************************
+ **********************************************************************/
+
+// Maximum amount of instructions in a loop body considered by the idle loop detector
+constexpr int32_t IDLE_LOOP_MAX_LENGTH = 16;
+
+/**
+ * \brief Gets the GPRs read and written by an instruction, provided that the instruction is allowed inside an idle loop.
+ * \param op The instruction.
+ * \param reads The bitmask of read registers.
+ * \param writes The bitmask of written registers.
+ * \return Whether the instruction is free of side effects besides register writes.
+ */
+static bool get_idle_loop_op_usage(uint32_t op, uint32_t& reads, uint32_t& writes)
+{
+    const uint32_t rs = (op >> 21) & 0x1F;
+    const uint32_t rt = (op >> 16) & 0x1F;
+    const uint32_t rd = (op >> 11) & 0x1F;
+
+    reads = 0;
+    writes = 0;
+
+    switch (op >> 26)
+    {
+    case 0x00: // SPECIAL
+        switch (op & 0x3F)
+        {
+        case 0x00: // SLL
+        case 0x02: // SRL
+        case 0x03: // SRA
+        case 0x04: // SLLV
+        case 0x06: // SRLV
+        case 0x07: // SRAV
+        case 0x21: // ADDU
+        case 0x23: // SUBU
+        case 0x24: // AND
+        case 0x25: // OR
+        case 0x26: // XOR
+        case 0x27: // NOR
+        case 0x2A: // SLT
+        case 0x2B: // SLTU
+            reads = (1 << rs) | (1 << rt);
+            writes = 1 << rd;
+            return true;
+        default:
+            return false;
+        }
+    case 0x09: // ADDIU
+    case 0x0A: // SLTI
+    case 0x0B: // SLTIU
+    case 0x0C: // ANDI
+    case 0x0D: // ORI
+    case 0x0E: // XORI
+    case 0x20: // LB
+    case 0x21: // LH
+    case 0x23: // LW
+    case 0x24: // LBU
+    case 0x25: // LHU
+    case 0x27: // LWU
+    case 0x37: // LD
+        reads = 1 << rs;
+        writes = 1 << rt;
+        return true;
+    case 0x0F: // LUI
+        writes = 1 << rt;
+        return true;
+    case 0x10: // COP0
+        // Only MFC0 from Count, which is what we're fast-forwarding anyway
+        if (rs != 0 || rd != 9)
+            return false;
+        writes = 1 << rt;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * \brief Determines whether the loop formed by a backwards branch is an idle loop.
+ * An idle loop has no side effects besides register writes and every iteration computes the same register state as the previous one, so it can only be exited by an interrupt or a memory change caused by one.
+ * \param source The block's source instructions.
+ * \param branch_index The index of the branch instruction in the block.
+ * \param target_index The index of the branch target in the block.
+ * \param length The amount of instructions in the block.
+ */
+static bool is_idle_loop(const int32_t* source, int32_t branch_index, int32_t target_index, int32_t length)
+{
+    if (target_index < 0 || target_index > branch_index || branch_index - target_index >= IDLE_LOOP_MAX_LENGTH)
+        return false;
+
+    // The delay slot must be part of the block to be analyzed
+    if (branch_index + 1 >= length)
+        return false;
+
+    uint32_t reads, writes;
+    uint32_t written = 0;
+    uint32_t read_before_write = 0;
+
+    const auto visit = [&](uint32_t op_reads, uint32_t op_writes) {
+        read_before_write |= op_reads & ~written;
+        written |= op_writes;
+    };
+
+    for (int32_t i = target_index; i < branch_index; i++)
+    {
+        if (!get_idle_loop_op_usage(source[i], reads, writes))
+            return false;
+        visit(reads, writes);
+    }
+
+    // The branch operands are sampled before the delay slot executes
+    const uint32_t branch = source[branch_index];
+    reads = 1 << ((branch >> 21) & 0x1F);
+    if ((branch >> 26) == 0x04 || (branch >> 26) == 0x05 || (branch >> 26) == 0x14 || (branch >> 26) == 0x15)
+        reads |= 1 << ((branch >> 16) & 0x1F);
+    visit(reads, 0);
+
+    if (!get_idle_loop_op_usage(source[branch_index + 1], reads, writes))
+        return false;
+    visit(reads, writes);
+
+    // A register carried over from the previous iteration and modified in this one (e.g.: a counter) makes the loop non-idle
+    return ((read_before_write & written) & ~1u) == 0;
+}
+
+/**
+ * \brief Wraps a branch closing an idle loop, fast-forwarding the count register to the next interrupt whenever the loop is taken.
+ */
+template <void (*Branch)()>
+static void IDLE_LOOP()
+{
+    const precomp_instr* target = PC + PC->f.i.immediate + 1;
+
+    Branch();
+
+    if (PC != target)
+        return;
+
+    const int32_t skip = next_interrupt - core_Count;
+    if (skip > 3)
+    {
+        skip_count(skip & 0xFFFFFFFC);
+    }
+}
+
+/**
+ * \brief Replaces the current in-block branch with an idle loop wrapper if it closes an idle loop.
+ */
+static void recompile_idle_loop(const int32_t* source, int32_t index, int32_t length)
+{
+    void (*ops)() = nullptr;
+
+#define IDLE_LOOP_CASE(x) \
+    if (dst->ops == x)    \
+        ops = IDLE_LOOP<x>;
+    IDLE_LOOP_CASE(BEQ)
+    IDLE_LOOP_CASE(BNE)
+    IDLE_LOOP_CASE(BLEZ)
+    IDLE_LOOP_CASE(BGTZ)
+    IDLE_LOOP_CASE(BEQL)
+    IDLE_LOOP_CASE(BNEL)
+    IDLE_LOOP_CASE(BLEZL)
+    IDLE_LOOP_CASE(BGTZL)
+    IDLE_LOOP_CASE(BLTZ)
+    IDLE_LOOP_CASE(BGEZ)
+    IDLE_LOOP_CASE(BLTZL)
+    IDLE_LOOP_CASE(BGEZL)
+#undef IDLE_LOOP_CASE
+
+    if (!ops)
+        return;
+
+    if (!is_idle_loop(source, index, index + dst->f.i.immediate + 1, length))
+        return;
+
+    dst->ops = ops;
+}
+
+/**********************************************************************
+ ********************** superinstruction fusion ***********************
+ **********************************************************************/
+
+/**
+ * \brief Executes a sequence of cached interpreter ops with a single dispatch.
+ * \remarks Every op except the last one must advance PC by exactly one instruction and never raise an exception.
+ */
+template <void (*... Ops)()>
+static void FUSED()
+{
+    (Ops(), ...);
+}
+
+/**
+ * \brief Gets whether an instruction transfers control, meaning that the following instruction is its delay slot.
+ */
+static bool is_branch_op(uint32_t op)
+{
+    switch (op >> 26)
+    {
+    case 0x00: // SPECIAL
+        return (op & 0x3F) == 0x08 || (op & 0x3F) == 0x09; // JR, JALR
+    case 0x01: // REGIMM
+    case 0x02: // J
+    case 0x03: // JAL
+    case 0x04: // BEQ
+    case 0x05: // BNE
+    case 0x06: // BLEZ
+    case 0x07: // BGTZ
+    case 0x14: // BEQL
+    case 0x15: // BNEL
+    case 0x16: // BLEZL
+    case 0x17: // BGTZL
+        return true;
+    case 0x11: // COP1
+        return ((op >> 21) & 0x1F) == 0x08; // BC
+    default:
+        return false;
+    }
+}
+
+#define FUSE_MEMORY_OPS(fuse) \
+    fuse(LB)                  \
+    fuse(LBU)                 \
+    fuse(LH)                  \
+    fuse(LHU)                 \
+    fuse(LW)                  \
+    fuse(LWU)                 \
+    fuse(LD)                  \
+    fuse(LWC1)                \
+    fuse(LDC1)                \
+    fuse(SB)                  \
+    fuse(SH)                  \
+    fuse(SW)                  \
+    fuse(SD)                  \
+    fuse(SWC1)                \
+    fuse(SDC1)
+
+#define FUSE_BRANCH_OPS(fuse) \
+    fuse(BEQ)                 \
+    fuse(BNE)                 \
+    fuse(BEQ_OUT)             \
+    fuse(BNE_OUT)
+
+/**
+ * \brief Gets the fused op for a pair of ops, or nullptr if the pair isn't fusable.
+ */
+static void (*get_fused_pair(void (*a)(), void (*b)()))()
+{
+#define FUSE(x, y)        \
+    if (a == x && b == y) \
+        return FUSED<x, y>;
+#define FUSE_LUI(y) FUSE(LUI, y)
+#define FUSE_SLT(y) FUSE(SLT, y)
+#define FUSE_SLTU(y) FUSE(SLTU, y)
+#define FUSE_SLTI(y) FUSE(SLTI, y)
+#define FUSE_SLTIU(y) FUSE(SLTIU, y)
+
+    FUSE(LUI, ADDIU)
+    FUSE(LUI, ORI)
+    FUSE_MEMORY_OPS(FUSE_LUI)
+    FUSE_BRANCH_OPS(FUSE_SLT)
+    FUSE_BRANCH_OPS(FUSE_SLTU)
+    FUSE_BRANCH_OPS(FUSE_SLTI)
+    FUSE_BRANCH_OPS(FUSE_SLTIU)
+
+#undef FUSE_SLTIU
+#undef FUSE_SLTI
+#undef FUSE_SLTU
+#undef FUSE_SLT
+#undef FUSE_LUI
+#undef FUSE
+    return nullptr;
+}
+
+/**
+ * \brief Gets the fused op for a triple of ops, or nullptr if the triple isn't fusable.
+ * \param ab The fused op of the first two ops.
+ */
+static void (*get_fused_triple(void (*ab)(), void (*c)()))()
+{
+#define FUSE(x, y, z)                \
+    if (ab == FUSED<x, y> && c == z) \
+        return FUSED<x, y, z>;
+#define FUSE_LUI_ADDIU(z) FUSE(LUI, ADDIU, z)
+#define FUSE_LUI_ORI(z) FUSE(LUI, ORI, z)
+
+    FUSE_MEMORY_OPS(FUSE_LUI_ADDIU)
+    FUSE_MEMORY_OPS(FUSE_LUI_ORI)
+
+#undef FUSE_LUI_ORI
+#undef FUSE_LUI_ADDIU
+#undef FUSE
+    return nullptr;
+}
+
+#undef FUSE_MEMORY_OPS
+#undef FUSE_BRANCH_OPS
+
+/**
+ * \brief Fuses the current instruction with its compiled predecessors if they form a known sequence.
+ * \remarks The member instructions keep their own ops, so jumps into the middle of a sequence still work.
+ */
+static void recompile_fused(const int32_t* source, precomp_block* block, int32_t index)
+{
+    const int32_t length = (block->end - block->start) / 4;
+
+    if (index >= length)
+        return;
+
+    // Triple: the first two ops have already been fused when the second one was compiled
+    if (index >= 3 && !is_branch_op(source[index - 3]))
+    {
+        if (const auto ops = get_fused_triple(block->block[index - 2].ops, dst->ops))
+        {
+            block->block[index - 2].ops = ops;
+            return;
+        }
+    }
+
+    // A sequence mustn't begin in a delay slot, as the branch only expects a single instruction to be executed
+    if (index >= 2 && !is_branch_op(source[index - 2]))
+    {
+        if (const auto ops = get_fused_pair(block->block[index - 1].ops, dst->ops))
+        {
+            block->block[index - 1].ops = ops;
+        }
+    }
+}
+
+/**
+ * \brief Runs the wrapped op while reporting the instruction to the tracelog and the debugger.
+ * \remarks Only swapped in while either of them is active, so the cached interpreter runs uninstrumented otherwise.
+ */
+static void INSTRUMENTED()
+{
+    const precomp_instr* instr = PC;
+
+    if (core_vr_is_tracelog_active())
+    {
+        tracelog_log_interp_ops();
+    }
+
+    // A branch runs its delay slot from within its op, so it's reported before running it to keep the branch ahead of its delay slot, like in the pure interpreter
+    const bool report_before = !dynacore && is_branch_op(instr->src);
+    if (report_before)
+    {
+        Debugger::on_late_cycle(instr->src, instr->addr + 4);
+    }
+
+    instr->s_ops();
+
+    if (!dynacore && !report_before)
+    {
+        Debugger::on_late_cycle(instr->src, PC->addr);
+    }
+}
+
 /**********************************************************************
  ********************* recompile a block of code **********************
  **********************************************************************/
@@ -2667,6 +3003,11 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
 
     block->hash = 0;
 
+    perf_add(core_perf_blocks_compiled);
+
+    // Decided once per block so a block is never half instrumented
+    const bool instrumented = core_vr_is_tracelog_active() || (!dynacore && Debugger::is_active());
+
     if (dynacore)
     {
         code_length = block->code_length;
@@ -2694,13 +3035,22 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
             check_nop = 0;
         dst = block->block + i;
         dst->addr = block->start + i * 4;
-        dst->reg_cache_infos.need_map = 0;
+        if (dynacore)
+            dst->reg_cache_infos->need_map = 0;
         dst->local_addr = code_length;
         recomp_ops[((src >> 26) & 0x3F)]();
-        if (core_vr_is_tracelog_active())
+        if (!dynacore && g_vr_idle_loop_detection)
+        {
+            recompile_idle_loop(source, i, length);
+        }
+        if (!dynacore && !instrumented)
+        {
+            recompile_fused(source, block, i);
+        }
+        if (instrumented)
         {
             dst->s_ops = dst->ops;
-            dst->ops = tracelog_log_interp_ops;
+            dst->ops = INSTRUMENTED;
             dst->src = src;
         }
         dst = block->block + i;
@@ -2720,10 +3070,11 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
             finished = 2;
         if (i >= (length - 1) && (block->start == 0xa4000000 || block->start >= 0xc0000000 || block->end < 0x80000000))
             finished = 2;
-        if (dst->ops == ERET || finished == 1)
+        const auto ops = instrumented ? dst->s_ops : dst->ops;
+        if (ops == ERET || finished == 1)
             finished = 2;
         if (/*i >= length &&*/
-            (dst->ops == J || dst->ops == J_OUT || dst->ops == JR) &&
+            (ops == J || ops == J_OUT || ops == JR) &&
             !(i >= (length - 1) && (block->start >= 0xc0000000 || block->end < 0x80000000)))
             finished = 1;
     }
@@ -2731,7 +3082,8 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
     {
         dst = block->block + i;
         dst->addr = block->start + i * 4;
-        dst->reg_cache_infos.need_map = 0;
+        if (dynacore)
+            dst->reg_cache_infos->need_map = 0;
         dst->local_addr = code_length;
 #ifdef EMU64_DEBUG
         if (dynacore)
@@ -2743,7 +3095,8 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
         {
             dst = block->block + i;
             dst->addr = block->start + i * 4;
-            dst->reg_cache_infos.need_map = 0;
+            if (dynacore)
+                dst->reg_cache_infos->need_map = 0;
             dst->local_addr = code_length;
 #ifdef EMU64_DEBUG
             if (dynacore)
@@ -2859,7 +3212,7 @@ void recompile_opcode()
     src = *SRC;
     dst++;
     dst->addr = (dst - 1)->addr + 4;
-    dst->reg_cache_infos.need_map = 0;
+    dst->reg_cache_infos->need_map = 0;
     if (!is_jump())
         recomp_ops[((src >> 26) & 0x3F)]();
     else
@@ -2895,6 +3248,8 @@ void core_vr_recompile(uint32_t addr)
     {
         g_core->log_info(L"core_vr_recompile all blocks");
         memset(invalid_code, 1, 0x100000);
+        perf_add(core_perf_code_cache_flushes);
+        g_vr_block_exit_requested = true;
         return;
     }
 
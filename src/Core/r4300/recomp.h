@@ -53,13 +53,16 @@ typedef struct _precomp_instr {
 
     uint32_t addr;
     uint32_t local_addr;
-    reg_cache_struct reg_cache_infos;
     void (*s_ops)();
     uint32_t src;
+
+    // Only used by the dynarec, points into the owning block's reg_cache and is left unset under the interpreters
+    reg_cache_struct* reg_cache_infos;
 } precomp_instr;
 
 typedef struct _precomp_block {
     precomp_instr* block;
+    reg_cache_struct* reg_cache;
     uint32_t start;
     uint32_t end;
     unsigned char* code;
@@ -50,7 +50,7 @@ void BLTZ_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLTZ();
     }
@@ -97,7 +97,7 @@ void BGEZ_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGEZ();
     }
@@ -152,7 +152,7 @@ void BLTZL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLTZL();
     }
@@ -207,7 +207,7 @@ void BGEZL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGEZL();
     }
@@ -266,7 +266,7 @@ void BLTZAL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLTZAL();
     }
@@ -325,7 +325,7 @@ void BGEZAL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGEZAL();
     }
@@ -394,7 +394,7 @@ void BLTZALL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BLTZALL();
     }
@@ -463,7 +463,7 @@ void BGEZALL_IDLE()
         update_count();
         skip = next_interrupt - core_Count;
         if (skip > 3)
-            core_Count += (skip & 0xFFFFFFFC);
+            skip_count(skip & 0xFFFFFFFC);
         else
             BGEZALL();
     }
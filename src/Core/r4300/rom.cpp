@@ -11,10 +11,12 @@
 #include <memory/memory.h>
 #include <r4300/r4300.h>
 #include <r4300/rom.h>
-
-std::unordered_map<std::filesystem::path, std::pair<uint8_t*, size_t>> rom_cache;
+#include <immintrin.h>
+#include <Windows.h>
 
 uint8_t* rom;
+// Keeps the buffer behind rom alive, which may be shared with a rom cache entry
+static std::shared_ptr<uint8_t[]> rom_owner;
 size_t rom_size;
 char rom_md5[33];
 
@@ -107,124 +109,430 @@ uint32_t core_vr_get_vis_per_second(uint16_t country_code)
     }
 }
 
-void core_vr_byteswap(uint8_t* rom)
-{
-    uint8_t tmp = 0;
+/**
+ * \brief A byte permutation applied to every 32-bit word of a rom image.
+ */
+typedef enum {
+    swap_none,
+    // Swaps the bytes within each halfword
+    swap_bytes,
+    // Swaps the halfwords within each word
+    swap_halves,
+    // Reverses the bytes within each word
+    swap_word,
+} swap_kind;
 
-    if (rom[0] == 0x37)
+/**
+ * \brief Copies a buffer while permuting the bytes of every 32-bit word.
+ * \param dst The destination buffer. May be the same as src.
+ * \param src The source buffer.
+ * \param size The buffer size in bytes. Trailing bytes which don't form a whole word are copied as-is.
+ * \param kind The permutation.
+ */
+static void swap_words(uint8_t* dst, const uint8_t* src, size_t size, swap_kind kind)
+{
+    if (kind == swap_none)
     {
-        for (size_t i = 0; i < (0x40 / 2); i++)
+        if (dst != src)
         {
-            tmp = rom[i * 2];
-            rom[i * 2] = rom[i * 2 + 1];
-            rom[i * 2 + 1] = tmp;
+            memcpy(dst, src, size);
         }
+        return;
     }
-    if (rom[0] == 0x40)
+
+    static constexpr uint8_t orders[][4] = {
+    {0, 1, 2, 3},
+    {1, 0, 3, 2},
+    {2, 3, 0, 1},
+    {3, 2, 1, 0},
+    };
+    const auto order = orders[kind];
+
+    size_t i = 0;
+
+#ifdef __AVX2__
+    alignas(32) uint8_t mask_bytes[32];
+    for (size_t j = 0; j < sizeof(mask_bytes); ++j)
     {
-        for (size_t i = 0; i < (0x40 / 4); i++)
+        mask_bytes[j] = (j & 0xC) + order[j & 3];
+    }
+    const __m256i mask = _mm256_load_si256((const __m256i*)mask_bytes);
+
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(v, mask));
+    }
+#else
+    // SSE2 has no byte shuffle, so the permutations are composed of a halfword byte swap and a halfword shuffle
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        if (kind != swap_halves)
         {
-            tmp = rom[i * 4];
-            rom[i * 4] = rom[i * 4 + 3];
-            rom[i * 4 + 3] = tmp;
-            tmp = rom[i * 4 + 1];
-            rom[i * 4 + 1] = rom[i * 4 + 2];
-            rom[i * 4 + 2] = tmp;
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
         }
+        if (kind != swap_bytes)
+        {
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+#endif
+
+    for (; i + 4 <= size; i += 4)
+    {
+        const uint8_t word[4] = {src[i], src[i + 1], src[i + 2], src[i + 3]};
+        dst[i] = word[order[0]];
+        dst[i + 1] = word[order[1]];
+        dst[i + 2] = word[order[2]];
+        dst[i + 3] = word[order[3]];
+    }
+
+    if (dst != src)
+    {
+        memcpy(dst + i, src + i, size - i);
     }
 }
 
-bool rom_load(std::filesystem::path path)
+void core_vr_byteswap(uint8_t* rom)
 {
-    if (rom)
+    if (rom[0] == 0x37)
     {
-        free(rom);
-        g_core->rom = rom = nullptr;
+        swap_words(rom, rom, 0x40, swap_bytes);
     }
-
-    if (rom_cache.contains(path))
+    if (rom[0] == 0x40)
     {
-        g_core->log_info(L"[Core] Loading cached ROM...");
-        g_core->rom = rom = (unsigned char*)malloc(rom_cache[path].second);
-        memcpy(rom, rom_cache[path].first, rom_cache[path].second);
-        return true;
+        swap_words(rom, rom, 0x40, swap_word);
     }
+}
+
+/**
+ * \brief A read-only view of a file mapped into memory.
+ */
+struct mapped_file {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    explicit mapped_file(const std::filesystem::path& path)
+    {
+        file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || (uint64_t)file_size.QuadPart > SIZE_MAX)
+        {
+            return;
+        }
+
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            return;
+        }
 
-    auto rom_buf = read_file_buffer(path);
-    auto decompressed_rom = auto_decompress(rom_buf);
+        data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data)
+        {
+            size = (size_t)file_size.QuadPart;
+        }
+    }
 
-    if (decompressed_rom.empty())
+    ~mapped_file()
     {
-        return false;
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
     }
 
-    rom_size = decompressed_rom.size();
-    uint32_t taille = rom_size;
-    if (g_core->cfg->use_summercart && taille < 0x4000000)
-        taille = 0x4000000;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+};
 
-    g_core->rom = rom = (unsigned char*)malloc(taille);
-    memcpy(rom, decompressed_rom.data(), rom_size);
+struct rom_digest {
+    uint64_t size;
+    int64_t mtime;
+    std::string md5;
+};
 
-    uint8_t tmp;
-    if (rom[0] == 0x37)
+// MD5s of previously loaded rom files, keyed by path and validated by file size and modification time
+static std::unordered_map<std::wstring, rom_digest> digest_cache;
+static bool digest_cache_loaded = false;
+
+static std::filesystem::path get_digest_cache_path()
+{
+    return g_core->get_saves_directory() / L"rom_digests.cache";
+}
+
+static void load_digest_cache()
+{
+    digest_cache_loaded = true;
+
+    std::ifstream file(get_digest_cache_path());
+    if (!file)
     {
-        for (size_t i = 0; i < (rom_size / 2); i++)
+        return;
+    }
+
+    // Each line is "<md5> <size> <mtime> <utf-8 path>"
+    std::string md5;
+    rom_digest digest;
+    while (file >> md5 >> digest.size >> digest.mtime)
+    {
+        std::string path;
+        std::getline(file >> std::ws, path);
+        if (md5.size() != 32 || path.empty())
         {
-            tmp = rom[i * 2];
-            rom[i * 2] = rom[i * 2 + 1];
-            rom[i * 2 + 1] = (unsigned char)tmp;
+            continue;
         }
+        digest.md5 = md5;
+        digest_cache[string_to_wstring(path)] = digest;
     }
-    if (rom[0] == 0x40)
+}
+
+static void save_digest_cache()
+{
+    std::ofstream file(get_digest_cache_path(), std::ios::trunc);
+    if (!file)
+    {
+        g_core->log_warn(L"[Core] Failed to save the rom digest cache");
+        return;
+    }
+
+    for (const auto& [path, digest] : digest_cache)
     {
-        for (size_t i = 0; i < (rom_size / 4); i++)
+        file << digest.md5 << ' ' << digest.size << ' ' << digest.mtime << ' ' << wstring_to_string(path) << '\n';
+    }
+}
+
+/**
+ * \brief Computes the MD5 of a rom image as it would appear in big-endian (z64) byte order.
+ * \param image The rom image.
+ * \param kind The permutation which brings the image into big-endian byte order.
+ * \param md5 The buffer receiving the uppercase hex digest.
+ */
+static void compute_rom_md5(std::span<const uint8_t> image, swap_kind kind, char (&md5)[33])
+{
+    md5_state_t state;
+    md5_byte_t digest[16];
+    md5_init(&state);
+
+    if (kind == swap_none)
+    {
+        md5_append(&state, image.data(), image.size());
+    }
+    else
+    {
+        // Converted in chunks which stay in cache instead of materializing a big-endian copy of the whole rom
+        std::vector<uint8_t> chunk(0x10000);
+        for (size_t offset = 0; offset < image.size(); offset += chunk.size())
         {
-            tmp = rom[i * 4];
-            rom[i * 4] = rom[i * 4 + 3];
-            rom[i * 4 + 3] = (unsigned char)tmp;
-            tmp = rom[i * 4 + 1];
-            rom[i * 4 + 1] = rom[i * 4 + 2];
-            rom[i * 4 + 2] = (unsigned char)tmp;
+            const size_t length = std::min(chunk.size(), image.size() - offset);
+            swap_words(chunk.data(), image.data() + offset, length, kind);
+            md5_append(&state, chunk.data(), length);
         }
     }
-    else if ((rom[0] != 0x80) || (rom[1] != 0x37) || (rom[2] != 0x12) || (rom[3] != 0x40)
 
-    )
+    md5_finish(&state, digest);
+
+    for (size_t i = 0; i < 16; i++)
+        sprintf(md5 + i * 2, "%02X", digest[i]);
+}
+
+/**
+ * \brief A rom file's size and modification time, used to detect changes to the file.
+ */
+struct file_stamp {
+    uint64_t size;
+    int64_t mtime;
+
+    bool operator==(const file_stamp&) const = default;
+};
+
+static std::optional<file_stamp> get_file_stamp(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec)
     {
-        g_core->log_info(L"wrong file format !");
-        return false;
+        return std::nullopt;
+    }
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return std::nullopt;
+    }
+    return file_stamp{size, mtime.time_since_epoch().count()};
+}
+
+/**
+ * \brief Gets the MD5 of a rom file's image, either from the digest cache or by computing and caching it.
+ */
+static void get_rom_md5(const std::wstring& key, const std::optional<file_stamp>& stamp, std::span<const uint8_t> image, swap_kind kind, char (&md5)[33])
+{
+    if (!stamp)
+    {
+        compute_rom_md5(image, kind, md5);
+        return;
     }
 
-    g_core->log_info(L"rom loaded succesfully");
+    if (!digest_cache_loaded)
+    {
+        load_digest_cache();
+    }
 
-    memcpy(&ROM_HEADER, rom, sizeof(core_rom_header));
-    ROM_HEADER.unknown = 0;
-    // Clean up ROMs that accidentally set the unused bytes (ensuring previous fields are null terminated)
-    ROM_HEADER.Unknown[0] = 0;
-    ROM_HEADER.Unknown[1] = 0;
+    if (const auto it = digest_cache.find(key); it != digest_cache.end() && it->second.size == stamp->size && it->second.mtime == stamp->mtime)
+    {
+        strcpy(md5, it->second.md5.c_str());
+        return;
+    }
 
-    // trim header
-    strtrim((char*)ROM_HEADER.nom, sizeof(ROM_HEADER.nom));
+    compute_rom_md5(image, kind, md5);
+    digest_cache[key] = rom_digest{stamp->size, stamp->mtime, md5};
+    save_digest_cache();
+}
+
+/**
+ * \brief A fully processed rom image: converted to the core's word order, with its header parsed and MD5 known.
+ */
+struct rom_image {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+    core_rom_header header;
+    char md5[33];
+    core_system_type sys_type;
+    std::optional<file_stamp> stamp;
+};
+
+// Recently loaded rom images, most recently used first, bounded by the rom cache budget
+static std::list<std::pair<std::wstring, std::shared_ptr<rom_image>>> rom_cache;
+static size_t rom_cache_bytes;
+
+static size_t get_rom_cache_budget()
+{
+    return (size_t)std::max(0, g_core->cfg->rom_cache_budget) * 1024 * 1024;
+}
+
+/**
+ * \brief Gets a rom image from the cache, provided that its file hasn't changed since it was cached.
+ */
+static std::shared_ptr<rom_image> find_cached_rom(const std::wstring& key, const std::optional<file_stamp>& stamp)
+{
+    const auto it = std::ranges::find(rom_cache, key, [](const auto& entry) { return entry.first; });
+    if (it == rom_cache.end())
+    {
+        return nullptr;
+    }
+
+    if (!stamp || it->second->stamp != stamp)
+    {
+        rom_cache_bytes -= it->second->size;
+        rom_cache.erase(it);
+        return nullptr;
+    }
+
+    rom_cache.splice(rom_cache.begin(), rom_cache, it);
+    return it->second;
+}
+
+static void put_cached_rom(const std::wstring& key, const std::shared_ptr<rom_image>& image)
+{
+    const auto budget = get_rom_cache_budget();
+    if (image->size > budget)
+    {
+        return;
+    }
+
+    while (rom_cache_bytes + image->size > budget)
+    {
+        g_core->log_info(std::format(L"[Core] Evicting {} from the ROM cache", rom_cache.back().first));
+        rom_cache_bytes -= rom_cache.back().second->size;
+        rom_cache.pop_back();
+    }
+
+    rom_cache.emplace_front(key, image);
+    rom_cache_bytes += image->size;
+    g_core->log_info(std::format(L"[Core] Put ROM in cache ({}/{} MB used)", rom_cache_bytes / (1024 * 1024), budget / (1024 * 1024)));
+}
+
+/**
+ * \brief Reads and processes a rom file.
+ * \return The rom image, or nullptr if the file isn't a valid rom.
+ */
+static std::shared_ptr<rom_image> read_rom_image(const std::filesystem::path& path, const std::wstring& key, const std::optional<file_stamp>& stamp)
+{
+    // Uncompressed roms are read straight from the mapped file, so they're only copied once into the final buffer
+    const mapped_file file(path);
+    if (!file.data)
+    {
+        return nullptr;
+    }
 
+    std::span<const uint8_t> data(file.data, file.size);
+    std::vector<uint8_t> decompressed_rom;
+    if (data.size() >= 2 && data[0] == 0x1F && data[1] == 0x8B)
     {
-        md5_state_t state;
-        md5_byte_t digest[16];
-        md5_init(&state);
-        md5_append(&state, rom, rom_size);
-        md5_finish(&state, digest);
+        std::vector<uint8_t> rom_buf(data.begin(), data.end());
+        decompressed_rom = auto_decompress(rom_buf);
+        data = decompressed_rom;
+    }
 
-        char arg[256] = {0};
-        for (size_t i = 0; i < 16; i++)
-            sprintf(arg + i * 2, "%02X", digest[i]);
-        strcpy(rom_md5, arg);
+    if (data.size() < sizeof(core_rom_header))
+    {
+        return nullptr;
     }
 
-    auto roml = (uint32_t*)rom;
-    for (size_t i = 0; i < (rom_size / 4); i++)
-        roml[i] = sl(roml[i]);
+    // The permutations which bring the image into big-endian order and into the core's native word order
+    swap_kind to_big_endian;
+    swap_kind to_native;
+    if (data[0] == 0x37)
+    {
+        to_big_endian = swap_bytes;
+        to_native = swap_halves;
+    }
+    else if (data[0] == 0x40)
+    {
+        to_big_endian = swap_word;
+        to_native = swap_none;
+    }
+    else if (data[0] == 0x80 && data[1] == 0x37 && data[2] == 0x12 && data[3] == 0x40)
+    {
+        to_big_endian = swap_none;
+        to_native = swap_word;
+    }
+    else
+    {
+        g_core->log_info(L"wrong file format !");
+        return nullptr;
+    }
+
+    auto image = std::make_shared<rom_image>();
+    image->size = data.size();
+    image->stamp = stamp;
+    image->data = std::make_unique_for_overwrite<uint8_t[]>(image->size);
+    swap_words(image->data.get(), data.data(), image->size, to_native);
+
+    auto& header = image->header;
+    swap_words((uint8_t*)&header, data.data(), sizeof(core_rom_header), to_big_endian);
+    header.unknown = 0;
+    // Clean up ROMs that accidentally set the unused bytes (ensuring previous fields are null terminated)
+    header.Unknown[0] = 0;
+    header.Unknown[1] = 0;
 
-    switch (ROM_HEADER.Country_code & 0xFF)
+    // trim header
+    strtrim((char*)header.nom, sizeof(header.nom));
+
+    get_rom_md5(key, stamp, data, to_big_endian, image->md5);
+
+    switch (header.Country_code & 0xFF)
     {
     case 0x44:
     case 0x46:
@@ -234,26 +542,69 @@ bool rom_load(std::filesystem::path path)
     case 0x55:
     case 0x58:
     case 0x59:
-        g_sys_type = sys_pal;
+        image->sys_type = sys_pal;
         break;
     case 0x37:
     case 0x41:
     case 0x45:
     case 0x4a:
-        g_sys_type = sys_ntsc;
+        image->sys_type = sys_ntsc;
         break;
     default:
-        g_core->log_error(std::format(L"Unknown ccode: {:#06x}", ROM_HEADER.Country_code));
-        return false;
+        g_core->log_error(std::format(L"Unknown ccode: {:#06x}", header.Country_code));
+        return nullptr;
+    }
+
+    return image;
+}
+
+bool rom_load(std::filesystem::path path)
+{
+    rom_owner.reset();
+    g_core->rom = rom = nullptr;
+
+    std::error_code ec;
+    const auto key = std::filesystem::absolute(path, ec).wstring();
+    const auto stamp = get_file_stamp(path);
+
+    auto image = find_cached_rom(key, stamp);
+    if (image)
+    {
+        g_core->log_info(L"[Core] Loading cached ROM...");
     }
+    else
+    {
+        image = read_rom_image(path, key, stamp);
+        if (!image)
+        {
+            return false;
+        }
+        if (stamp)
+        {
+            put_cached_rom(key, image);
+        }
+    }
+
+    rom_size = image->size;
+    ROM_HEADER = image->header;
+    strcpy(rom_md5, image->md5);
+    g_sys_type = image->sys_type;
 
-    if (rom_cache.size() < g_core->cfg->rom_cache_size)
+    if (g_core->cfg->use_summercart)
     {
-        g_core->log_info(std::format(L"[Core] Putting ROM in cache... ({}/{} full)\n", rom_cache.size(), g_core->cfg->rom_cache_size));
-        auto data = (uint8_t*)malloc(taille);
-        memcpy(data, rom, taille);
-        rom_cache[path] = std::make_pair(data, taille);
+        // The summercart can write to the rom and needs room for its full address space, so it gets a private copy
+        const size_t taille = std::max(rom_size, (size_t)0x4000000);
+        rom_owner = std::make_shared_for_overwrite<uint8_t[]>(taille);
+        memcpy(rom_owner.get(), image->data.get(), rom_size);
     }
+    else
+    {
+        // Nothing else writes to the rom, so the image is shared with the cache entry
+        rom_owner = std::shared_ptr<uint8_t[]>(image, image->data.get());
+    }
+    g_core->rom = rom = rom_owner.get();
+
+    g_core->log_info(L"rom loaded succesfully");
 
     return true;
 }
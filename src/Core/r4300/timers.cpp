@@ -9,49 +9,161 @@
 #include <r4300/timers.h>
 #include <include/core_api.h>
 #include <memory/pif.h>
+#include <r4300/bruteforce.h>
 #include <r4300/r4300.h>
+#include <perf.h>
+#include <Windows.h>
+#include <immintrin.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 extern int32_t m_current_vi;
 extern int32_t m_current_sample;
 
-std::chrono::duration<double, std::milli> max_vi_s_ms;
+// How long before a deadline the pacer stops sleeping and starts spinning, depending on whether a high-resolution waitable timer is available
+constexpr auto SPIN_MARGIN_HIGH_RESOLUTION = std::chrono::microseconds(500);
+constexpr auto SPIN_MARGIN_LOW_RESOLUTION = std::chrono::microseconds(2000);
 
-size_t frame_deltas_ptr = 0;
-size_t vi_deltas_ptr = 0;
+// How far the pacer may fall behind its deadline before it gives up catching up and re-anchors to the current time
+constexpr auto MAX_LATENESS = std::chrono::milliseconds(100);
 
-time_point last_vi_time;
-time_point last_frame_time;
+/**
+ * \brief A ring of timer deltas which is written by the emulation thread and read by any thread without locking.
+ * \remarks Readers can observe a mix of old and new deltas while the ring is being written to, which is fine for statistics.
+ */
+struct t_delta_ring {
+    std::atomic<int64_t> deltas[core_timer_max_deltas];
+    std::atomic<size_t> count;
 
-void core_vr_on_speed_modifier_changed()
+    void push(core_timer_delta delta)
+    {
+        const auto n = count.load(std::memory_order_relaxed);
+        deltas[n % core_timer_max_deltas].store(delta.count(), std::memory_order_relaxed);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    void clear()
+    {
+        count.store(0, std::memory_order_release);
+    }
+};
+
+static t_delta_ring frame_deltas;
+static t_delta_ring vi_deltas;
+
+static core_timer_delta vi_interval;
+static time_point vi_deadline;
+
+static time_point last_vi_time;
+static time_point last_frame_time;
+
+/**
+ * \brief Waits until the specified deadline. Sleeps for most of the wait and spins for the remainder, since sleeps are only accurate to the scheduler's granularity.
+ */
+static void wait_until(time_point deadline)
 {
-    const double max_vi_s = core_vr_get_vis_per_second(ROM_HEADER.Country_code);
-    max_vi_s_ms = std::chrono::duration<double, std::milli>(
-    1000.0 / (max_vi_s * static_cast<double>(g_core->cfg->fps_modifier) / 100));
+    static HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    const auto spin_margin = timer ? SPIN_MARGIN_HIGH_RESOLUTION : SPIN_MARGIN_LOW_RESOLUTION;
 
-    last_frame_time = std::chrono::high_resolution_clock::now();
-    last_vi_time = std::chrono::high_resolution_clock::now();
+    // The due time is relative, but it's derived from the absolute deadline each time, so sleeping inaccuracies don't accumulate
+    const auto sleep_time = deadline - spin_margin - std::chrono::high_resolution_clock::now();
+    if (sleep_time > sleep_time.zero())
+    {
+        if (timer)
+        {
+            LARGE_INTEGER due_time;
+            due_time.QuadPart = -std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(sleep_time).count() / 100);
+            SetWaitableTimer(timer, &due_time, 0, nullptr, nullptr, FALSE);
+            WaitForSingleObject(timer, INFINITE);
+        }
+        else
+        {
+            std::this_thread::sleep_for(sleep_time);
+        }
+    }
+
+    while (std::chrono::high_resolution_clock::now() < deadline)
+    {
+        _mm_pause();
+    }
+}
+
+/**
+ * \brief Computes statistics over the deltas in a ring.
+ */
+static core_timer_stats get_stats(const t_delta_ring& ring)
+{
+    core_timer_stats stats{};
 
-    for (auto& delta : g_core->g_frame_deltas)
+    const auto count = std::min<size_t>(ring.count.load(std::memory_order_acquire), core_timer_max_deltas);
+    if (count == 0)
     {
-        delta = {};
+        return stats;
     }
-    for (auto& delta : g_core->g_vi_deltas)
+
+    double deltas[core_timer_max_deltas];
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i)
     {
-        delta = {};
+        deltas[i] = ring.deltas[i].load(std::memory_order_relaxed) / 1000000.0;
+        sum += deltas[i];
     }
 
-    frame_deltas_ptr = 0;
-    vi_deltas_ptr = 0;
+    const double mean = sum / count;
+    stats.rate = mean > 0.0 ? 1000.0 / mean : 0.0;
+
+    // Jitter is how far the deltas stray from the mean
+    double jitter[core_timer_max_deltas];
+    for (size_t i = 0; i < count; ++i)
+    {
+        jitter[i] = fabs(deltas[i] - mean);
+    }
+
+    const auto percentile = [count](double* values, double p) {
+        const auto nth = values + std::min(count - 1, static_cast<size_t>(p * count));
+        std::nth_element(values, nth, values + count);
+        return *nth;
+    };
+
+    stats.delta_p50_ms = percentile(deltas, 0.5);
+    stats.delta_p99_ms = percentile(deltas, 0.99);
+    stats.jitter_p50_ms = percentile(jitter, 0.5);
+    stats.jitter_p99_ms = percentile(jitter, 0.99);
+    return stats;
+}
+
+core_timer_stats core_vr_get_frame_stats()
+{
+    return get_stats(frame_deltas);
+}
+
+core_timer_stats core_vr_get_vi_stats()
+{
+    return get_stats(vi_deltas);
+}
+
+void core_vr_on_speed_modifier_changed()
+{
+    const double max_vi_s = core_vr_get_vis_per_second(ROM_HEADER.Country_code);
+    vi_interval = std::chrono::duration_cast<core_timer_delta>(std::chrono::duration<double>(
+    1.0 / (max_vi_s * static_cast<double>(g_core->cfg->fps_modifier) / 100)));
+
+    last_frame_time = std::chrono::high_resolution_clock::now();
+    last_vi_time = std::chrono::high_resolution_clock::now();
+    vi_deadline = last_vi_time;
+
+    frame_deltas.clear();
+    vi_deltas.clear();
 }
 
 void timer_new_frame()
 {
     const auto current_frame_time = std::chrono::high_resolution_clock::now();
 
-    g_core->g_frame_deltas_mutex.lock();
-    g_core->g_frame_deltas[frame_deltas_ptr] = current_frame_time - last_frame_time;
-    g_core->g_frame_deltas_mutex.unlock();
-    frame_deltas_ptr = (frame_deltas_ptr + 1) % core_timer_max_deltas;
+    frame_deltas.push(current_frame_time - last_frame_time);
+    perf_on_frame();
 
     g_core->callbacks.frame();
     last_frame_time = std::chrono::high_resolution_clock::now();
@@ -66,49 +178,27 @@ void timer_new_vi()
 
     auto current_vi_time = std::chrono::high_resolution_clock::now();
 
-    if (!g_vr_fast_forward && frame_advance_outstanding == 0)
+    if (!g_vr_fast_forward && !bf_is_active() && frame_advance_outstanding == 0)
     {
-        static std::chrono::duration<double, std::nano> last_sleep_error;
-        // if we're playing game normally with no frame advance or ff and overstepping max time between frames,
-        // we need to sleep to compensate the additional time
-        const auto vi_time_diff = current_vi_time - last_vi_time;
-        if (!frame_advance_outstanding && vi_time_diff < max_vi_s_ms)
+        // VIs are scheduled against absolute deadlines, so an early or late wakeup is made up for by the next one instead of accumulating as drift
+        vi_deadline += vi_interval;
+
+        if (current_vi_time - vi_deadline > MAX_LATENESS || vi_deadline - current_vi_time > vi_interval)
+        {
+            // We stalled (e.g.: paused or a slow host) or the interval changed. Catching up would fast-forward, so we re-anchor instead.
+            vi_deadline = current_vi_time;
+        }
+        else
         {
-            auto sleep_time = max_vi_s_ms - vi_time_diff;
-            if (sleep_time.count() > 0 && sleep_time < std::chrono::milliseconds(700))
-            {
-                // we try to sleep for the overstepped time, but must account for sleeping inaccuracies
-                const auto goal_sleep = max_vi_s_ms - vi_time_diff -
-                last_sleep_error;
-                const auto start_sleep =
-                std::chrono::high_resolution_clock::now();
-                std::this_thread::sleep_for(goal_sleep);
-                const auto end_sleep =
-                std::chrono::high_resolution_clock::now();
-
-                // sleeping inaccuracy is difference between actual time spent sleeping and the goal sleep
-                // this value isnt usually too large
-                last_sleep_error = end_sleep - start_sleep - goal_sleep;
-
-                // This value is used later to calculate the deltas so we need to reassign it here to cut out the sleep time from the current delta
-                current_vi_time = std::chrono::high_resolution_clock::now();
-            }
-            else
-            {
-                // sleep time is unreasonable, log it and reset related state
-                const auto casted = std::chrono::duration_cast<
-                                    std::chrono::milliseconds>(sleep_time)
-                                    .count();
-                g_core->log_info(std::format(L"Invalid timer: %lld ms", casted));
-                sleep_time = sleep_time.zero();
-            }
+            wait_until(vi_deadline);
+            current_vi_time = std::chrono::high_resolution_clock::now();
         }
     }
+    else
+    {
+        vi_deadline = current_vi_time;
+    }
 
-    g_core->g_vi_deltas_mutex.lock();
-    g_core->g_vi_deltas[vi_deltas_ptr] = current_vi_time - last_vi_time;
-    g_core->g_vi_deltas_mutex.unlock();
-    vi_deltas_ptr = (vi_deltas_ptr + 1) % core_timer_max_deltas;
-
-    last_vi_time = std::chrono::high_resolution_clock::now();
+    vi_deltas.push(current_vi_time - last_vi_time);
+    last_vi_time = current_vi_time;
 }
@@ -8,61 +8,111 @@
 #include "tracelog.h"
 #include "disasm.h"
 #include "r4300.h"
+#include <Core.h>
+#include <libdeflate.h>
 
-bool enabled = false;
-bool use_binary = false;
+/**
+ * The emulation thread only captures the raw state an instruction's log line needs into a fixed-size record and pushes it into a single-producer single-consumer ring.
+ * A writer thread pops the records, formats them and writes them to the log file, optionally compressing each output chunk into its own gzip member.
+ * In the raw format, the records are written as they are, and core_tl_decode turns them into a text or binary log later.
+ */
 
-FILE* log_file;
-char traceLoggingBuf[0x10000];
-char* traceLoggingPointer = traceLoggingBuf;
+// The ring's capacity in records. Must be a power of two.
+constexpr size_t RING_CAPACITY = 1 << 19;
 
-bool core_vr_is_tracelog_active()
-{
-    return enabled;
-}
+// The size of the formatted output chunks which are written (and compressed) at once
+constexpr size_t CHUNK_SIZE = 1 << 20;
 
-void flush_buf()
-{
-    fwrite(traceLoggingBuf, 1, traceLoggingPointer - traceLoggingBuf, log_file);
-    traceLoggingPointer = traceLoggingBuf;
-}
+// The maximum size of one formatted record
+constexpr size_t MAX_RECORD_SIZE = 512;
+
+// The number of records each thread formats at once when decoding a raw capture
+constexpr size_t DECODE_SLICE_RECORDS = 1 << 16;
+
+constexpr uint32_t TL_DELAY_SLOT = 1 << 0;
+
+constexpr char CAPTURE_MAGIC[8] = {'M', '6', '4', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+struct t_capture_header {
+    char magic[8];
+    uint32_t version;
+    // The size of one record, so captures can't be decoded with a mismatching record layout
+    uint32_t record_size;
+};
 
-void write_buf()
+struct t_trace_record {
+    uint32_t pc;
+    uint32_t op;
+    // The values of the GPRs selected by the rs, rt and rd fields
+    uint32_t gpr[3];
+    // The raw values of the FPRs selected by the fs and ft fields
+    uint32_t fpr[2];
+    uint32_t flags;
+};
+
+static std::atomic<bool> enabled = false;
+static core_tl_params params;
+
+// Set by the emulation thread while it's capturing a record. Stopping waits for it to clear, so starting can reset the capture state without racing the producer.
+static std::atomic<bool> producer_active;
+
+static std::unique_ptr<t_trace_record[]> ring;
+alignas(64) static std::atomic<size_t> ring_head;
+alignas(64) static std::atomic<size_t> ring_tail;
+static std::atomic<size_t> dropped_records;
+
+static FILE* log_file;
+static std::thread writer_thread;
+static std::atomic<bool> writer_stop_requested;
+
+// The instruction classes of each primary opcode
+static constexpr auto primary_classes = [] {
+    std::array<uint8_t, 64> classes{};
+    classes.fill(core_tl_class_alu);
+    for (const auto op : {1, 2, 3, 4, 5, 6, 7, 20, 21, 22, 23})
+        classes[op] = core_tl_class_branch;
+    for (const auto op : {26, 27, 32, 33, 34, 35, 36, 37, 38, 39, 48, 50, 52, 54, 55})
+        classes[op] = core_tl_class_load;
+    for (const auto op : {40, 41, 42, 43, 44, 45, 46, 56, 58, 60, 62, 63})
+        classes[op] = core_tl_class_store;
+    for (const auto op : {49, 53})
+        classes[op] = core_tl_class_load | core_tl_class_fpu;
+    for (const auto op : {57, 61})
+        classes[op] = core_tl_class_store | core_tl_class_fpu;
+    classes[16] = core_tl_class_cop0;
+    classes[17] = core_tl_class_fpu;
+    classes[47] = core_tl_class_cop0;
+    return classes;
+}();
+
+static uint32_t get_classes(uint32_t op)
 {
-    const char* const buflength = traceLoggingBuf + sizeof(traceLoggingBuf) -
-    512;
-    if (traceLoggingPointer >= buflength)
+    // JR and JALR are the only branches in the SPECIAL group
+    if ((op >> 26) == 0 && (op & 0x3E) == 0x08)
     {
-        flush_buf();
+        return core_tl_class_branch;
     }
+    return primary_classes[op >> 26];
 }
 
+bool core_vr_is_tracelog_active()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
 
-void log_bin(uint32_t pc, uint32_t w)
+static char* log_bin(const t_trace_record& r, char* p)
 {
-    char*& p = traceLoggingPointer;
     INSTDECODE decode;
     // little endian
 #define HEX8(n)        \
     *(uint32_t*)p = n; \
     p += 4
 
-    DecodeInstruction(w, &decode);
-    HEX8(pc);
-    HEX8(w);
+    DecodeInstruction(r.op, &decode);
+    HEX8(r.pc);
+    HEX8(r.op);
     INSTOPERAND& o = decode.operand;
-    // n�͌ォ��f�R�[�h����΂킩��
-#define REGCPU(n) \
-    HEX8(reg[n])
-#define REGCPU2(n, m) \
-    REGCPU(n);        \
-    REGCPU(m);
-    // 10�i��
-#define REGFPU(n) \
-    HEX8(*(uint32_t*)reg_cop1_simple[n])
-#define REGFPU2(n, m) \
-    REGFPU(n);        \
-    REGFPU(m)
 #define NONE           \
     *(uint32_t*)p = 0; \
     p += 4
@@ -86,71 +136,66 @@ void log_bin(uint32_t pc, uint32_t w)
     case INSTF_JR:
     case INSTF_ISIGN:
     case INSTF_IUNSIGN:
-        REGCPU(o.i.rs);
+        HEX8(r.gpr[0]);
         NONE;
         break;
     case INSTF_2BRANCH:
-        REGCPU2(o.i.rs, o.i.rt);
+        HEX8(r.gpr[0]);
+        HEX8(r.gpr[1]);
         break;
     case INSTF_ADDRW:
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
-        REGCPU(o.i.rt);
+        HEX8(r.gpr[0] + (int16_t)o.i.immediate);
+        HEX8(r.gpr[1]);
         break;
     case INSTF_ADDRR:
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
+        HEX8(r.gpr[0] + (int16_t)o.i.immediate);
         NONE;
         break;
     case INSTF_LFW:
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
-        REGFPU(o.lf.ft);
+        HEX8(r.gpr[0] + (int16_t)o.lf.offset);
+        HEX8(r.fpr[1]);
         break;
     case INSTF_LFR:
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
+        HEX8(r.gpr[0] + (int16_t)o.lf.offset);
         NONE;
         break;
     case INSTF_R1:
-        REGCPU(o.r.rd);
+        HEX8(r.gpr[2]);
         NONE;
         break;
     case INSTF_R2:
-        REGCPU2(o.i.rs, o.i.rt);
-        break;
     case INSTF_R3:
-        REGCPU2(o.i.rs, o.i.rt);
+        HEX8(r.gpr[0]);
+        HEX8(r.gpr[1]);
         break;
     case INSTF_MTC0:
     case INSTF_MTC1:
     case INSTF_SA:
-        REGCPU(o.r.rt);
+        HEX8(r.gpr[1]);
         NONE;
         break;
     case INSTF_R2F:
-        REGFPU(o.cf.fs);
+    case INSTF_MFC1:
+        HEX8(r.fpr[0]);
         NONE;
         break;
     case INSTF_R3F:
     case INSTF_C:
-        REGFPU2(o.cf.fs, o.cf.ft);
+        HEX8(r.fpr[0]);
+        HEX8(r.fpr[1]);
         break;
     case INSTF_MFC0:
         NONE2;
         break;
-    case INSTF_MFC1:
-        REGFPU(((uint8_t)o.r.rs));
-        NONE;
-        break;
     }
-    write_buf();
+    return p;
 #undef HEX8
-#undef REGCPU
-#undef REGFPU
-#undef REGCPU2
-#undef REGFPU2
+#undef NONE
+#undef NONE2
 }
 
-void log(uint32_t pc, uint32_t w)
+static char* log(const t_trace_record& r, char* p)
 {
-    char*& p = traceLoggingPointer;
     INSTDECODE decode;
     const char* const x = "0123456789abcdef";
 #define HEX8(n)                          \
@@ -164,14 +209,14 @@ void log(uint32_t pc, uint32_t w)
     p[7] = x[(uint32_t)(n) & 0xF];       \
     p += 8;
 
-    DecodeInstruction(w, &decode);
-    HEX8(pc);
+    DecodeInstruction(r.op, &decode);
+    HEX8(r.pc);
     *(p++) = ':';
     *(p++) = ' ';
-    HEX8(w);
+    HEX8(r.op);
     *(p++) = ' ';
     const char* ps = p;
-    if (w == 0x00000000)
+    if (r.op == 0x00000000)
     {
         *(p++) = 'n';
         *(p++) = 'o';
@@ -184,7 +229,7 @@ void log(uint32_t pc, uint32_t w)
             *(p++) = *q;
         }
         *(p++) = ' ';
-        p = GetOperandString(p, &decode, pc);
+        p = GetOperandString(p, &decode, r.pc);
     }
     for (int32_t i = p - ps + 3; i < 24; i += 4)
     {
@@ -192,7 +237,7 @@ void log(uint32_t pc, uint32_t w)
     }
     *(p++) = ';';
     INSTOPERAND& o = decode.operand;
-#define REGCPU(n)                                         \
+#define REGCPU(n, v)                                      \
     if ((n) != 0)                                         \
     {                                                     \
         for (const char* l = CPURegisterName[n]; *l; l++) \
@@ -200,32 +245,35 @@ void log(uint32_t pc, uint32_t w)
             *(p++) = *l;                                  \
         }                                                 \
         *(p++) = '=';                                     \
-        HEX8(reg[n]);                                     \
+        HEX8(v);                                          \
     }
 #define REGCPU2(n, m)           \
-    REGCPU(n);                  \
+    REGCPU(n, r.gpr[0]);        \
     if ((n) != (m) && (m) != 0) \
     {                           \
         C;                      \
-        REGCPU(m);              \
-    }
-    // 10�i��
-#define REGFPU(n)         \
-    *(p++) = 'f';         \
-    *(p++) = x[(n) / 10]; \
-    *(p++) = x[(n) % 10]; \
-    *(p++) = '=';         \
-    p += sprintf(p, "%f", *reg_cop1_simple[n])
-#define REGFPU2(n, m) \
-    REGFPU(n);        \
-    if ((n) != (m))   \
-    {                 \
-        C;            \
-        REGFPU(m);    \
+        REGCPU(m, r.gpr[1]);    \
+    }
+#define REGFPU(n, v)                            \
+    *(p++) = 'f';                               \
+    *(p++) = x[(n) / 10];                       \
+    *(p++) = x[(n) % 10];                       \
+    *(p++) = '=';                               \
+    {                                           \
+        float f;                                \
+        memcpy(&f, &(v), sizeof(f));            \
+        p += sprintf(p, "%f", f);               \
+    }
+#define REGFPU2(n, m)        \
+    REGFPU(n, r.fpr[0]);     \
+    if ((n) != (m))          \
+    {                        \
+        C;                   \
+        REGFPU(m, r.fpr[1]); \
     }
 #define C *(p++) = ','
 
-    if (delay_slot)
+    if (r.flags & TL_DELAY_SLOT)
     {
         *(p++) = '#';
     }
@@ -242,13 +290,13 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_JR:
     case INSTF_ISIGN:
     case INSTF_IUNSIGN:
-        REGCPU(o.i.rs);
+        REGCPU(o.i.rs, r.gpr[0]);
         break;
     case INSTF_2BRANCH:
         REGCPU2(o.i.rs, o.i.rt);
         break;
     case INSTF_ADDRW:
-        REGCPU(o.i.rt);
+        REGCPU(o.i.rt, r.gpr[1]);
         if (o.i.rt != 0)
         {
             C;
@@ -256,32 +304,30 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_ADDRR:
         *(p++) = '@';
         *(p++) = '=';
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
+        HEX8(r.gpr[0] + (int16_t)o.i.immediate);
         break;
     case INSTF_LFW:
-        REGFPU(o.lf.ft);
+        REGFPU(o.lf.ft, r.fpr[1]);
         C;
     case INSTF_LFR:
         *(p++) = '@';
         *(p++) = '=';
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
+        HEX8(r.gpr[0] + (int16_t)o.lf.offset);
         break;
     case INSTF_R1:
-        REGCPU(o.r.rd);
+        REGCPU(o.r.rd, r.gpr[2]);
         break;
     case INSTF_R2:
-        REGCPU2(o.i.rs, o.i.rt);
-        break;
     case INSTF_R3:
         REGCPU2(o.i.rs, o.i.rt);
         break;
     case INSTF_MTC0:
     case INSTF_MTC1:
     case INSTF_SA:
-        REGCPU(o.r.rt);
+        REGCPU(o.r.rt, r.gpr[1]);
         break;
     case INSTF_R2F:
-        REGFPU(o.cf.fs);
+        REGFPU(o.cf.fs, r.fpr[0]);
         break;
     case INSTF_R3F:
     case INSTF_C:
@@ -290,12 +336,11 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_MFC0:
         break;
     case INSTF_MFC1:
-        REGFPU(((uint8_t)o.r.rs));
+        REGFPU(o.r.rd, r.fpr[0]);
         break;
     }
     *(p++) = '\n';
-
-    write_buf();
+    return p;
 #undef HEX8
 #undef REGCPU
 #undef REGFPU
@@ -304,38 +349,203 @@ void log(uint32_t pc, uint32_t w)
 #undef C
 }
 
-void tracelog_log_pure()
+/**
+ * \brief Formats a record.
+ * \param format The output format.
+ * \param r The record.
+ * \param p The output buffer, which must have at least MAX_RECORD_SIZE bytes left.
+ * \return The end of the formatted record.
+ */
+static char* format_record(core_tl_format format, const t_trace_record& r, char* p)
 {
-    if (!use_binary)
+    switch (format)
     {
-        log(interp_addr, vr_op);
+    case core_tl_format_text:
+        return log(r, p);
+    case core_tl_format_binary:
+        return log_bin(r, p);
+    default:
+        memcpy(p, &r, sizeof(r));
+        return p + sizeof(r);
     }
-    else
+}
+
+/**
+ * \brief Writes a chunk of formatted output to the log file, compressing it into a gzip member if needed.
+ */
+static void write_chunk(const std::vector<char>& chunk, size_t size, libdeflate_compressor* compressor, std::vector<uint8_t>& compressed)
+{
+    if (size == 0)
     {
-        log_bin(interp_addr, vr_op);
+        return;
     }
+
+    if (!compressor)
+    {
+        fwrite(chunk.data(), 1, size, log_file);
+        return;
+    }
+
+    // Concatenated gzip members are a valid gzip stream
+    const size_t compressed_size = libdeflate_gzip_compress(compressor, chunk.data(), size, compressed.data(), compressed.size());
+    fwrite(compressed.data(), 1, compressed_size, log_file);
 }
 
-void tracelog_log_interp_ops()
+static void writer_thread_proc()
 {
-    if (enabled)
+    std::vector<char> chunk(CHUNK_SIZE);
+    size_t chunk_size = 0;
+
+    libdeflate_compressor* compressor = nullptr;
+    std::vector<uint8_t> compressed;
+    if (params.compress && params.format != core_tl_format_raw)
+    {
+        compressor = libdeflate_alloc_compressor(1);
+        compressed.resize(libdeflate_gzip_compress_bound(compressor, CHUNK_SIZE));
+    }
+
+    while (true)
     {
-        if (!use_binary)
+        // The stop request must be observed before the head, so the records pushed before stopping are drained
+        const bool stop_requested = writer_stop_requested.load(std::memory_order_acquire);
+        const size_t head = ring_head.load(std::memory_order_acquire);
+        size_t tail = ring_tail.load(std::memory_order_relaxed);
+
+        if (tail == head)
         {
-            log(PC->addr, PC->src);
+            if (stop_requested)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
         }
-        else
+
+        for (; tail != head; ++tail)
         {
-            log_bin(PC->addr, PC->src);
+            const auto& record = ring[tail & (RING_CAPACITY - 1)];
+            char* end = format_record(params.format, record, chunk.data() + chunk_size);
+            chunk_size = end - chunk.data();
+
+            if (chunk_size > CHUNK_SIZE - MAX_RECORD_SIZE)
+            {
+                write_chunk(chunk, chunk_size, compressor, compressed);
+                chunk_size = 0;
+            }
+
+            // Release the space in batches, so the producer isn't contending on the tail's cache line
+            if ((tail & 0xFFF) == 0)
+            {
+                ring_tail.store(tail + 1, std::memory_order_release);
+            }
         }
+        ring_tail.store(tail, std::memory_order_release);
+    }
+
+    write_chunk(chunk, chunk_size, compressor, compressed);
+
+    if (compressor)
+    {
+        libdeflate_free_compressor(compressor);
     }
-    PC->s_ops();
 }
 
-void core_tl_start(std::filesystem::path path, bool binary, bool append)
+/**
+ * \brief Captures an instruction into the ring.
+ * \param pc The instruction's address.
+ * \param op The instruction's opcode.
+ */
+static void capture(uint32_t pc, uint32_t op)
 {
-    use_binary = binary;
+    // The flag is raised before checking whether we're enabled, so core_tl_stop either sees us capturing or we see it having stopped
+    producer_active.store(true);
+    if (!enabled.load())
+    {
+        producer_active.store(false, std::memory_order_release);
+        return;
+    }
+
+    if (pc - params.pc_start > params.pc_end - params.pc_start || !(get_classes(op) & params.classes))
+    {
+        producer_active.store(false, std::memory_order_release);
+        return;
+    }
+
+    const size_t head = ring_head.load(std::memory_order_relaxed);
+    if (head - ring_tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+    {
+        if (params.overflow == core_tl_overflow_drop)
+        {
+            dropped_records.fetch_add(1, std::memory_order_relaxed);
+            producer_active.store(false, std::memory_order_release);
+            return;
+        }
+
+        while (head - ring_tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    auto& record = ring[head & (RING_CAPACITY - 1)];
+    record.pc = pc;
+    record.op = op;
+    record.gpr[0] = (uint32_t)reg[op >> 21 & 0x1F];
+    record.gpr[1] = (uint32_t)reg[op >> 16 & 0x1F];
+    record.gpr[2] = (uint32_t)reg[op >> 11 & 0x1F];
+    record.fpr[0] = *(uint32_t*)reg_cop1_simple[op >> 11 & 0x1F];
+    record.fpr[1] = *(uint32_t*)reg_cop1_simple[op >> 16 & 0x1F];
+    record.flags = delay_slot ? TL_DELAY_SLOT : 0;
+
+    ring_head.store(head + 1, std::memory_order_release);
+    producer_active.store(false, std::memory_order_release);
+}
+
+void tracelog_log_pure()
+{
+    capture(interp_addr, vr_op);
+}
+
+void tracelog_log_interp_ops()
+{
+    capture(PC->addr, PC->src);
+}
+
+void core_tl_start(std::filesystem::path path, const core_tl_params& tl_params)
+{
+    if (enabled)
+    {
+        return;
+    }
+
     log_file = _wfopen(path.wstring().c_str(), L"wb");
+    if (!log_file)
+    {
+        g_core->log_error(std::format(L"[Core] Couldn't open trace log file {}", path.wstring()));
+        return;
+    }
+
+    params = tl_params;
+
+    if (params.format == core_tl_format_raw)
+    {
+        t_capture_header header{};
+        memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = CAPTURE_VERSION;
+        header.record_size = sizeof(t_trace_record);
+        fwrite(&header, 1, sizeof(header), log_file);
+    }
+
+    // The producer is quiescent while we're disabled, so the capture state can be reset here. It only sees the new state once we're enabled.
+    if (!ring)
+    {
+        ring = std::make_unique<t_trace_record[]>(RING_CAPACITY);
+    }
+    ring_head = 0;
+    ring_tail = 0;
+    dropped_records = 0;
+    writer_stop_requested = false;
+    writer_thread = std::thread(writer_thread_proc);
 
     enabled = true;
     if (interpcore == 0)
@@ -346,7 +556,117 @@ void core_tl_start(std::filesystem::path path, bool binary, bool append)
 
 void core_tl_stop()
 {
+    if (!enabled)
+    {
+        return;
+    }
+
     enabled = false;
-    flush_buf();
+
+    // A record which is being captured right now is still drained by the writer. The producer can only be waiting on the writer here, so this can't deadlock.
+    while (producer_active.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+
+    writer_stop_requested.store(true, std::memory_order_release);
+    writer_thread.join();
     fclose(log_file);
+
+    if (dropped_records)
+    {
+        g_core->log_warn(std::format(L"[Core] Trace logger dropped {} records", dropped_records.load()));
+    }
+
+    // Drop the instrumented ops again so the cached interpreter stops paying for them
+    if (interpcore == 0)
+    {
+        core_vr_recompile(UINT32_MAX);
+    }
+}
+
+core_result core_tl_decode(const std::filesystem::path& capture_path, const std::filesystem::path& out_path, core_tl_format format, size_t threads)
+{
+    if (format == core_tl_format_raw)
+    {
+        return TL_InvalidFormat;
+    }
+
+    FILE* in = _wfopen(capture_path.wstring().c_str(), L"rb");
+    if (!in)
+    {
+        return TL_BadFile;
+    }
+
+    t_capture_header header{};
+    if (fread(&header, 1, sizeof(header), in) != sizeof(header) || memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) || header.version != CAPTURE_VERSION || header.record_size != sizeof(t_trace_record))
+    {
+        fclose(in);
+        return TL_InvalidFormat;
+    }
+
+    FILE* out = _wfopen(out_path.wstring().c_str(), L"wb");
+    if (!out)
+    {
+        fclose(in);
+        return TL_FileWriteError;
+    }
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The capture is processed in batches of one slice per thread. The slices are formatted in parallel and written in order.
+    std::vector<t_trace_record> records(threads * DECODE_SLICE_RECORDS);
+    std::vector<std::vector<char>> outputs(threads);
+    std::vector<std::thread> workers;
+    size_t total_records = 0;
+    bool write_failed = false;
+
+    while (!write_failed)
+    {
+        const size_t count = fread(records.data(), sizeof(t_trace_record), records.size(), in);
+        if (count == 0)
+        {
+            break;
+        }
+        total_records += count;
+
+        const size_t slice_count = (count + DECODE_SLICE_RECORDS - 1) / DECODE_SLICE_RECORDS;
+        for (size_t i = 0; i < slice_count; ++i)
+        {
+            workers.emplace_back([&, i] {
+                const size_t start = i * DECODE_SLICE_RECORDS;
+                const size_t end = std::min(start + DECODE_SLICE_RECORDS, count);
+                auto& output = outputs[i];
+                output.resize((end - start) * MAX_RECORD_SIZE);
+
+                char* p = output.data();
+                for (size_t j = start; j < end; ++j)
+                {
+                    p = format_record(format, records[j], p);
+                }
+                output.resize(p - output.data());
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        workers.clear();
+
+        for (size_t i = 0; i < slice_count; ++i)
+        {
+            write_failed |= fwrite(outputs[i].data(), 1, outputs[i].size(), out) != outputs[i].size();
+        }
+    }
+
+    fclose(in);
+    write_failed |= fclose(out) != 0;
+
+    g_core->log_info(std::format(L"[Core] Decoded {} trace records using {} threads", total_records, threads));
+
+    return write_failed ? TL_FileWriteError : Res_Ok;
 }
@@ -7,7 +7,7 @@
 #pragma once
 
 /**
- * \brief Logs a dynarec-generated instruction
+ * \brief Logs the cached interpreter instruction at PC
  */
 void tracelog_log_interp_ops();
 
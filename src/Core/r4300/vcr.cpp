@@ -11,10 +11,12 @@
 #include <include/core_api.h>
 #include <memory/pif.h>
 #include <memory/savestates.h>
+#include <r4300/bruteforce.h>
 #include <r4300/r4300.h>
 #include <r4300/rom.h>
 #include <r4300/timers.h>
 #include <r4300/vcr.h>
+#include <perf.h>
 
 // M64\0x1a
 enum {
@@ -643,7 +645,7 @@ void vcr_handle_recording(int32_t index, core_buttons* input)
         }
         else
         {
-            g_core->plugin_funcs.input_get_keys(index, input);
+            perf_call(core_perf_calls_input_get_keys, g_core->plugin_funcs.input_get_keys, index, input);
             g_core->callbacks.input(input, index);
         }
     }
@@ -701,7 +703,7 @@ void vcr_handle_playback(int32_t index, core_buttons* input)
         }
 
         g_core->plugin_funcs.input_set_keys(index, {0});
-        g_core->plugin_funcs.input_get_keys(index, input);
+        perf_call(core_perf_calls_input_get_keys, g_core->plugin_funcs.input_get_keys, index, input);
         return;
     }
 
@@ -816,7 +818,7 @@ void vcr_on_controller_poll(int32_t index, core_buttons* input)
 
     if (g_task == task_idle)
     {
-        g_core->plugin_funcs.input_get_keys(index, input);
+        perf_call(core_perf_calls_input_get_keys, g_core->plugin_funcs.input_get_keys, index, input);
         g_core->callbacks.input(input, index);
         return;
     }
@@ -1864,7 +1866,7 @@ void vcr_on_vi()
 
 bool is_frame_skipped()
 {
-    if (frame_advance_outstanding > 1)
+    if (frame_advance_outstanding > 1 || bf_is_active())
     {
         return true;
     }
@@ -62,9 +62,9 @@ void passe2(precomp_instr* dest, int32_t start, int32_t end, precomp_block* bloc
     for (i = 0; i < jumps_number; i++)
     {
         code_length = jumps_table[i].pc_addr;
-        if (dest[(jumps_table[i].mi_addr - dest[0].addr) / 4].reg_cache_infos.need_map)
+        if (dest[(jumps_table[i].mi_addr - dest[0].addr) / 4].reg_cache_infos->need_map)
         {
-            addr_dest = (uint32_t)dest[(jumps_table[i].mi_addr - dest[0].addr) / 4].reg_cache_infos.jump_wrapper;
+            addr_dest = (uint32_t)dest[(jumps_table[i].mi_addr - dest[0].addr) / 4].reg_cache_infos->jump_wrapper;
             put32(addr_dest - ((uint32_t)block->code + code_length) - 4);
         }
         else
@@ -558,6 +558,15 @@ void add_m32_imm8(void* _m32, unsigned char imm8)
     put8(imm8);
 }
 
+void adc_m32_imm8(void* _m32, unsigned char imm8)
+{
+    uint32_t* m32 = (uint32_t*)_m32;
+    put8(0x83);
+    put8(0x15);
+    put32((uint32_t)(m32));
+    put8(imm8);
+}
+
 void sub_m32_imm32(void* _m32, uint32_t imm32)
 {
     uint32_t* m32 = (uint32_t*)_m32;
@@ -153,6 +153,7 @@ void movsx_reg32_reg16(int32_t reg32, int32_t reg8);
 void movsx_reg32_m16(int32_t reg32, uint16_t* m16);
 void cmp_reg32_imm8(int32_t reg32, unsigned char imm8);
 void add_m32_imm8(void* _m32, unsigned char imm8);
+void adc_m32_imm8(void* _m32, unsigned char imm8);
 void mov_reg8_m8(int32_t reg8, unsigned char* m8);
 void mov_preg32preg32pimm32_reg8(int32_t reg1, int32_t reg2, uint32_t imm32,
                                  int32_t reg8);
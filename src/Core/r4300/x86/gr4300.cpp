@@ -492,11 +492,15 @@ void gentest_idle()
     mov_reg32_m32(reg, (uint32_t*)(&next_interrupt));
     sub_reg32_m32(reg, (uint32_t*)(&core_Count));
     cmp_reg32_imm8(reg, 3);
-    jbe_rj(12);
+    jbe_rj(25);
 
     and_reg32_imm32(reg, 0xFFFFFFFC); // 6
     add_m32_reg32((uint32_t*)(&core_Count), reg); // 6
 
+    // The skipped cycles are accumulated like in skip_count, so they aren't counted as executed instructions
+    add_m32_reg32((uint32_t*)(&g_vr_idle_loop_skipped_cycles), reg); // 6
+    adc_m32_imm8((uint32_t*)(&g_vr_idle_loop_skipped_cycles) + 1, 0); // 7
+
     temp2 = code_length;
     code_length = temp - 4;
     put32(temp2 - temp);
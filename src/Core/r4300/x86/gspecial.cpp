@@ -143,10 +143,10 @@ void genjr()
     static uint32_t precomp_instr_size = sizeof(precomp_instr);
     uint32_t diff =
     (uint32_t)(&dst->local_addr) - (uint32_t)(dst);
-    uint32_t diff_need =
-    (uint32_t)(&dst->reg_cache_infos.need_map) - (uint32_t)(dst);
-    uint32_t diff_wrap =
-    (uint32_t)(&dst->reg_cache_infos.jump_wrapper) - (uint32_t)(dst);
+    uint32_t diff_cache =
+    (uint32_t)(&dst->reg_cache_infos) - (uint32_t)(dst);
+    uint32_t diff_need = offsetof(reg_cache_struct, need_map);
+    uint32_t diff_wrap = offsetof(reg_cache_struct, jump_wrapper);
     uint32_t temp, temp2;
 
     if (((dst->addr & 0xFFF) == 0xFFC &&
@@ -191,12 +191,13 @@ void genjr()
     shr_reg32_imm8(EAX, 2);
     mul_m32((uint32_t*)(&precomp_instr_size));
 
-    mov_reg32_preg32pimm32(EBX, EAX, (uint32_t)(dst_block->block) + diff_need);
-    cmp_reg32_imm32(EBX, 1);
-    jne_rj(7);
+    // need_map is only ever 0 or 1, so comparing its low byte is enough
+    mov_reg32_preg32pimm32(EBX, EAX, (uint32_t)(dst_block->block) + diff_cache);
+    cmp_preg32pimm32_imm8(EBX, diff_need, 1);
+    jne_rj(8);
 
-    add_eax_imm32((uint32_t)(dst_block->block) + diff_wrap); // 5
-    jmp_reg32(EAX); // 2
+    add_reg32_imm32(EBX, diff_wrap); // 6
+    jmp_reg32(EBX); // 2
 
     mov_reg32_preg32pimm32(EAX, EAX, (uint32_t)(dst_block->block) + diff);
     add_reg32_m32(EAX, (uint32_t*)(&dst_block->code));
@@ -213,10 +214,10 @@ void genjalr()
     static uint32_t precomp_instr_size = sizeof(precomp_instr);
     uint32_t diff =
     (uint32_t)(&dst->local_addr) - (uint32_t)(dst);
-    uint32_t diff_need =
-    (uint32_t)(&dst->reg_cache_infos.need_map) - (uint32_t)(dst);
-    uint32_t diff_wrap =
-    (uint32_t)(&dst->reg_cache_infos.jump_wrapper) - (uint32_t)(dst);
+    uint32_t diff_cache =
+    (uint32_t)(&dst->reg_cache_infos) - (uint32_t)(dst);
+    uint32_t diff_need = offsetof(reg_cache_struct, need_map);
+    uint32_t diff_wrap = offsetof(reg_cache_struct, jump_wrapper);
     uint32_t temp, temp2;
 
     if (((dst->addr & 0xFFF) == 0xFFC &&
@@ -267,12 +268,13 @@ void genjalr()
     shr_reg32_imm8(EAX, 2);
     mul_m32((uint32_t*)(&precomp_instr_size));
 
-    mov_reg32_preg32pimm32(EBX, EAX, (uint32_t)(dst_block->block) + diff_need);
-    cmp_reg32_imm32(EBX, 1);
-    jne_rj(7);
+    // need_map is only ever 0 or 1, so comparing its low byte is enough
+    mov_reg32_preg32pimm32(EBX, EAX, (uint32_t)(dst_block->block) + diff_cache);
+    cmp_preg32pimm32_imm8(EBX, diff_need, 1);
+    jne_rj(8);
 
-    add_eax_imm32((uint32_t)(dst_block->block) + diff_wrap); // 5
-    jmp_reg32(EAX); // 2
+    add_reg32_imm32(EBX, diff_wrap); // 6
+    jmp_reg32(EBX); // 2
 
     mov_reg32_preg32pimm32(EAX, EAX, (uint32_t)(dst_block->block) + diff);
     add_reg32_m32(EAX, (uint32_t*)(&dst_block->code));
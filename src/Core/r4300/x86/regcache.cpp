@@ -39,7 +39,7 @@ void free_all_registers()
         {
             while (free_since[i] <= dst)
             {
-                free_since[i]->reg_cache_infos.needed_registers[i] = NULL;
+                free_since[i]->reg_cache_infos->needed_registers[i] = NULL;
                 free_since[i]++;
             }
         }
@@ -66,16 +66,16 @@ void free_register(int32_t reg)
     while (last <= dst)
     {
         if (last_access[reg] != NULL && dirty[reg])
-            last->reg_cache_infos.needed_registers[reg] = reg_content[reg];
+            last->reg_cache_infos->needed_registers[reg] = reg_content[reg];
         else
-            last->reg_cache_infos.needed_registers[reg] = NULL;
+            last->reg_cache_infos->needed_registers[reg] = NULL;
 
         if (last_access[reg] != NULL && r64[reg] != -1)
         {
             if (dirty[r64[reg]])
-                last->reg_cache_infos.needed_registers[r64[reg]] = reg_content[r64[reg]];
+                last->reg_cache_infos->needed_registers[r64[reg]] = reg_content[r64[reg]];
             else
-                last->reg_cache_infos.needed_registers[r64[reg]] = NULL;
+                last->reg_cache_infos->needed_registers[r64[reg]] = NULL;
         }
 
         last++;
@@ -156,7 +156,7 @@ int32_t allocate_register(uint32_t* addr)
 
                 while (last <= dst)
                 {
-                    last->reg_cache_infos.needed_registers[i] = reg_content[i];
+                    last->reg_cache_infos->needed_registers[i] = reg_content[i];
                     last++;
                 }
                 last_access[i] = dst;
@@ -166,7 +166,7 @@ int32_t allocate_register(uint32_t* addr)
 
                     while (last <= dst)
                     {
-                        last->reg_cache_infos.needed_registers[r64[i]] = reg_content[r64[i]];
+                        last->reg_cache_infos->needed_registers[r64[i]] = reg_content[r64[i]];
                         last++;
                     }
                     last_access[r64[i]] = dst;
@@ -193,7 +193,7 @@ int32_t allocate_register(uint32_t* addr)
     {
         while (free_since[reg] <= dst)
         {
-            free_since[reg]->reg_cache_infos.needed_registers[reg] = NULL;
+            free_since[reg]->reg_cache_infos->needed_registers[reg] = NULL;
             free_since[reg]++;
         }
     }
@@ -325,7 +325,7 @@ int32_t allocate_register_w(uint32_t* addr)
 
             while (last <= dst)
             {
-                last->reg_cache_infos.needed_registers[i] = NULL;
+                last->reg_cache_infos->needed_registers[i] = NULL;
                 last++;
             }
             last_access[i] = dst;
@@ -335,7 +335,7 @@ int32_t allocate_register_w(uint32_t* addr)
                 last = last_access[r64[i]] + 1;
                 while (last <= dst)
                 {
-                    last->reg_cache_infos.needed_registers[r64[i]] = NULL;
+                    last->reg_cache_infos->needed_registers[r64[i]] = NULL;
                     last++;
                 }
                 free_since[r64[i]] = dst + 1;
@@ -363,7 +363,7 @@ int32_t allocate_register_w(uint32_t* addr)
     {
         while (free_since[reg] <= dst)
         {
-            free_since[reg]->reg_cache_infos.needed_registers[reg] = NULL;
+            free_since[reg]->reg_cache_infos->needed_registers[reg] = NULL;
             free_since[reg]++;
         }
     }
@@ -420,7 +420,7 @@ int32_t allocate_64_register1_w(uint32_t* addr)
     {
         while (free_since[reg2] <= dst)
         {
-            free_since[reg2]->reg_cache_infos.needed_registers[reg2] = NULL;
+            free_since[reg2]->reg_cache_infos->needed_registers[reg2] = NULL;
             free_since[reg2]++;
         }
     }
@@ -477,7 +477,7 @@ int32_t allocate_64_register2_w(uint32_t* addr)
     {
         while (free_since[reg2] <= dst)
         {
-            free_since[reg2]->reg_cache_infos.needed_registers[reg2] = NULL;
+            free_since[reg2]->reg_cache_infos->needed_registers[reg2] = NULL;
             free_since[reg2]++;
         }
     }
@@ -531,14 +531,14 @@ void force_32(int32_t reg)
         while (last <= dst)
         {
             if (dirty[reg])
-                last->reg_cache_infos.needed_registers[reg] = reg_content[reg];
+                last->reg_cache_infos->needed_registers[reg] = reg_content[reg];
             else
-                last->reg_cache_infos.needed_registers[reg] = NULL;
+                last->reg_cache_infos->needed_registers[reg] = NULL;
 
             if (dirty[r64[reg]])
-                last->reg_cache_infos.needed_registers[r64[reg]] = reg_content[r64[reg]];
+                last->reg_cache_infos->needed_registers[r64[reg]] = reg_content[r64[reg]];
             else
-                last->reg_cache_infos.needed_registers[r64[reg]] = NULL;
+                last->reg_cache_infos->needed_registers[r64[reg]] = NULL;
 
             last++;
         }
@@ -565,7 +565,7 @@ void allocate_register_manually(int32_t reg, uint32_t* addr)
 
         while (last <= dst)
         {
-            last->reg_cache_infos.needed_registers[reg] = reg_content[reg];
+            last->reg_cache_infos->needed_registers[reg] = reg_content[reg];
             last++;
         }
         last_access[reg] = dst;
@@ -575,7 +575,7 @@ void allocate_register_manually(int32_t reg, uint32_t* addr)
 
             while (last <= dst)
             {
-                last->reg_cache_infos.needed_registers[r64[reg]] = reg_content[r64[reg]];
+                last->reg_cache_infos->needed_registers[r64[reg]] = reg_content[r64[reg]];
                 last++;
             }
             last_access[r64[reg]] = dst;
@@ -589,7 +589,7 @@ void allocate_register_manually(int32_t reg, uint32_t* addr)
     {
         while (free_since[reg] <= dst)
         {
-            free_since[reg]->reg_cache_infos.needed_registers[reg] = NULL;
+            free_since[reg]->reg_cache_infos->needed_registers[reg] = NULL;
             free_since[reg]++;
         }
     }
@@ -603,7 +603,7 @@ void allocate_register_manually(int32_t reg, uint32_t* addr)
 
             while (last <= dst)
             {
-                last->reg_cache_infos.needed_registers[i] = reg_content[i];
+                last->reg_cache_infos->needed_registers[i] = reg_content[i];
                 last++;
             }
             last_access[i] = dst;
@@ -613,7 +613,7 @@ void allocate_register_manually(int32_t reg, uint32_t* addr)
 
                 while (last <= dst)
                 {
-                    last->reg_cache_infos.needed_registers[r64[i]] = reg_content[r64[i]];
+                    last->reg_cache_infos->needed_registers[r64[i]] = reg_content[r64[i]];
                     last++;
                 }
                 last_access[r64[i]] = dst;
@@ -657,7 +657,7 @@ void allocate_register_manually_w(int32_t reg, uint32_t* addr, int32_t load)
 
         while (last <= dst)
         {
-            last->reg_cache_infos.needed_registers[reg] = reg_content[reg];
+            last->reg_cache_infos->needed_registers[reg] = reg_content[reg];
             last++;
         }
         last_access[reg] = dst;
@@ -668,7 +668,7 @@ void allocate_register_manually_w(int32_t reg, uint32_t* addr, int32_t load)
 
             while (last <= dst)
             {
-                last->reg_cache_infos.needed_registers[r64[reg]] = reg_content[r64[reg]];
+                last->reg_cache_infos->needed_registers[r64[reg]] = reg_content[r64[reg]];
                 last++;
             }
             last_access[r64[reg]] = NULL;
@@ -685,7 +685,7 @@ void allocate_register_manually_w(int32_t reg, uint32_t* addr, int32_t load)
     {
         while (free_since[reg] <= dst)
         {
-            free_since[reg]->reg_cache_infos.needed_registers[reg] = NULL;
+            free_since[reg]->reg_cache_infos->needed_registers[reg] = NULL;
             free_since[reg]++;
         }
     }
@@ -699,7 +699,7 @@ void allocate_register_manually_w(int32_t reg, uint32_t* addr, int32_t load)
 
             while (last <= dst)
             {
-                last->reg_cache_infos.needed_registers[i] = reg_content[i];
+                last->reg_cache_infos->needed_registers[i] = reg_content[i];
                 last++;
             }
             last_access[i] = dst;
@@ -708,7 +708,7 @@ void allocate_register_manually_w(int32_t reg, uint32_t* addr, int32_t load)
                 last = last_access[r64[i]] + 1;
                 while (last <= dst)
                 {
-                    last->reg_cache_infos.needed_registers[r64[i]] = NULL;
+                    last->reg_cache_infos->needed_registers[r64[i]] = NULL;
                     last++;
                 }
                 free_since[r64[i]] = dst + 1;
@@ -790,12 +790,12 @@ void build_wrapper(precomp_instr* instr, unsigned char* code, precomp_block* blo
 
     for (i = 0; i < 8; i++)
     {
-        if (instr->reg_cache_infos.needed_registers[i] != NULL)
+        if (instr->reg_cache_infos->needed_registers[i] != NULL)
         {
             code[j++] = 0x8B;
             code[j++] = (i << 3) | 5;
             *((uint32_t*)&code[j]) =
-            (uint32_t)instr->reg_cache_infos.needed_registers[i];
+            (uint32_t)instr->reg_cache_infos->needed_registers[i];
             j += 4;
         }
     }
@@ -809,13 +809,13 @@ void build_wrappers(precomp_instr* instr, int32_t start, int32_t end, precomp_bl
     ;
     for (i = start; i < end; i++)
     {
-        instr[i].reg_cache_infos.need_map = 0;
+        instr[i].reg_cache_infos->need_map = 0;
         for (reg = 0; reg < 8; reg++)
         {
-            if (instr[i].reg_cache_infos.needed_registers[reg] != NULL)
+            if (instr[i].reg_cache_infos->needed_registers[reg] != NULL)
             {
-                instr[i].reg_cache_infos.need_map = 1;
-                build_wrapper(&instr[i], instr[i].reg_cache_infos.jump_wrapper, block);
+                instr[i].reg_cache_infos->need_map = 1;
+                build_wrapper(&instr[i], instr[i].reg_cache_infos->jump_wrapper, block);
                 break;
             }
         }
@@ -827,5 +827,5 @@ void simplify_access()
     int32_t i;
     dst->local_addr = code_length;
     for (i = 0; i < 8; i++)
-        dst->reg_cache_infos.needed_registers[i] = NULL;
+        dst->reg_cache_infos->needed_registers[i] = NULL;
 }
@@ -14,8 +14,8 @@
 
 void dyna_jump()
 {
-    if (PC->reg_cache_infos.need_map)
-        *return_address = (uint32_t)(PC->reg_cache_infos.jump_wrapper);
+    if (PC->reg_cache_infos->need_map)
+        *return_address = (uint32_t)(PC->reg_cache_infos->jump_wrapper);
     else
         *return_address = (uint32_t)(actual->code + PC->local_addr);
 }
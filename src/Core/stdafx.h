@@ -40,5 +40,10 @@
 #include <any>
 #include <stack>
 #include <deque>
+#include <list>
+#include <unordered_map>
 #include <numeric>
+#include <array>
+#include <bit>
+#include <random>
 #include <IOHelpers.h>
@@ -802,7 +802,7 @@ mINI::INIStructure handle_config_ini(bool is_reading, mINI::INIStructure ini)
     HANDLE_P_VALUE(st_slot)
     HANDLE_P_VALUE(core.fastforward_silent)
     HANDLE_P_VALUE(core.skip_rendering_lag)
-    HANDLE_P_VALUE(core.rom_cache_size)
+    HANDLE_P_VALUE(core.rom_cache_budget)
     HANDLE_P_VALUE(core.st_screenshot)
     HANDLE_P_VALUE(core.is_movie_loop_enabled)
     HANDLE_P_VALUE(core.counter_factor)
@@ -829,15 +829,24 @@ mINI::INIStructure handle_config_ini(bool is_reading, mINI::INIStructure ini)
     HANDLE_P_VALUE(capture_mode)
     HANDLE_P_VALUE(presenter_type)
     HANDLE_P_VALUE(lazy_renderer_init)
+    HANDLE_P_VALUE(lua_synchronous_callbacks)
     HANDLE_P_VALUE(encoder_type)
     HANDLE_P_VALUE(capture_delay)
     HANDLE_VALUE(ffmpeg_final_options)
     HANDLE_VALUE(ffmpeg_path)
     HANDLE_P_VALUE(synchronization_mode)
+    HANDLE_P_VALUE(capture_drop_on_overflow)
+    HANDLE_P_VALUE(capture_pixel_format)
+    HANDLE_P_VALUE(capture_vfr)
     HANDLE_P_VALUE(keep_default_working_directory)
     HANDLE_P_VALUE(use_async_executor)
     HANDLE_P_VALUE(concurrency_fuzzing)
     HANDLE_P_VALUE(plugin_discovery_delayed)
+    HANDLE_P_VALUE(tracelog_raw)
+    HANDLE_P_VALUE(tracelog_compress)
+    HANDLE_P_VALUE(tracelog_drop_on_overflow)
+    HANDLE_VALUE(tracelog_pc_range)
+    HANDLE_VALUE(tracelog_classes)
     HANDLE_VALUE(lua_script_path)
     HANDLE_VALUE(recent_lua_script_paths)
     HANDLE_P_VALUE(is_recent_scripts_frozen)
@@ -882,6 +891,8 @@ mINI::INIStructure handle_config_ini(bool is_reading, mINI::INIStructure ini)
     HANDLE_VALUE(seeker_value)
     HANDLE_P_VALUE(multi_frame_advance_count)
     HANDLE_VALUE(silent_mode_dialog_choices)
+    HANDLE_P_VALUE(core.idle_loop_detection)
+    HANDLE_VALUE(core.idle_loop_detection_roms)
 
     return ini;
 }
@@ -98,6 +98,15 @@ typedef enum {
     ENCODER_FFMPEG
 } cfg_encoder_type;
 
+/**
+ * \brief The pixel format of the video frames passed to the FFmpeg encoder.
+ */
+typedef enum {
+    PIXEL_FORMAT_BGR24,
+    PIXEL_FORMAT_YUV420P,
+    PIXEL_FORMAT_NV12
+} cfg_pixel_format;
+
 /**
  * \brief The statusbar layout preset.
  */
@@ -345,6 +354,11 @@ typedef struct ViewCfg {
     /// </summary>
     int32_t lazy_renderer_init = 1;
 
+    /// <summary>
+    /// Whether the emulator waits for Lua callbacks to finish before continuing. Disabling this lets emulation run ahead of scripts, which see state from later frames in their callbacks.
+    /// </summary>
+    int32_t lua_synchronous_callbacks = 1;
+
     /// <summary>
     /// The encoder to use for capturing.
     /// </summary>
@@ -379,6 +393,25 @@ typedef struct ViewCfg {
     /// </summary>
     int32_t synchronization_mode = 1;
 
+    /// <summary>
+    /// Whether the FFmpeg encoder drops video frames when encoding can't keep up instead of slowing down emulation
+    /// </summary>
+    int32_t capture_drop_on_overflow;
+
+    /// <summary>
+    /// The pixel format of the video frames passed to the FFmpeg encoder. YUV frames are half the size of BGR24 ones, but are converted before being sent.
+    /// <para/>
+    /// The format is substituted for the <c>-pixel_format bgr24</c> option of the FFmpeg options. If the options don't contain it or the resolution is odd, BGR24 is used.
+    /// </summary>
+    int32_t capture_pixel_format = PIXEL_FORMAT_BGR24;
+
+    /// <summary>
+    /// Whether the FFmpeg encoder skips frames identical to the previous one and writes a variable frame rate video instead.
+    /// <para/>
+    /// Requires the FFmpeg options to contain the default rawvideo input and FFmpeg 5.1 or newer.
+    /// </summary>
+    int32_t capture_vfr;
+
     /// <summary>
     /// When enabled, mupen won't change the working directory to its current path at startup
     /// </summary>
@@ -399,6 +432,35 @@ typedef struct ViewCfg {
     /// </summary>
     int32_t plugin_discovery_delayed;
 
+    /// <summary>
+    /// Whether the trace logger writes raw captures, which are decoded into trace logs later with the --decode-trace commandline option
+    /// </summary>
+    int32_t tracelog_raw;
+
+    /// <summary>
+    /// Whether trace logs are gzip-compressed
+    /// </summary>
+    int32_t tracelog_compress;
+
+    /// <summary>
+    /// Whether the trace logger drops instructions when it can't keep up instead of slowing down emulation
+    /// </summary>
+    int32_t tracelog_drop_on_overflow;
+
+    /// <summary>
+    /// The inclusive hexadecimal address range of traced instructions, formatted as start-end
+    /// <para/>
+    /// Empty - All addresses
+    /// </summary>
+    std::wstring tracelog_pc_range;
+
+    /// <summary>
+    /// The comma-separated classes of traced instructions (alu, branch, load, store, cop0, fpu)
+    /// <para/>
+    /// Empty - All classes
+    /// </summary>
+    std::wstring tracelog_classes;
+
     /// <summary>
     /// The lua script path
     /// </summary>
@@ -10,109 +10,179 @@
 
 namespace Messenger
 {
-#ifdef _DEBUG
-#define ASSERT_NOT_CHANGING assert(!g_changing)
-#else
-#define ASSERT_NOT_CHANGING
-#endif
+    // Tracks the invocations of a subscriber, which is shared by all copies of it in the subscriber lists.
+    struct SubscriberState {
+        // Whether the subscriber was removed. Broadcasts don't start invoking removed subscribers.
+        std::atomic<bool> removed;
+
+        // The amount of invocations which are currently running or about to check the removed flag.
+        std::atomic<size_t> active;
+    };
 
     // Represents a subscriber to a message.
     struct Subscriber {
         // A unique identifier.
         size_t uid;
 
-        // The callback function.
+        std::shared_ptr<SubscriberState> state;
+
+        // The callback of subscribers which take the data as an std::any.
         t_user_callback cb;
-    };
 
-    std::vector<std::pair<Message, Subscriber>> g_subscribers;
+        // The callback of typed subscribers, which take a pointer to the data.
+        Detail::t_typed_callback typed_cb;
 
-    std::unordered_map<Message, std::vector<t_user_callback>> g_subscriber_cache;
+        // Gets a pointer to the data held by an std::any for typed subscribers, or nullptr if it holds another type.
+        Detail::t_unbox_func unbox;
+    };
 
-    // UID accumulator for generating unique subscriber IDs. Only write operation is increment.
-    size_t g_uid_accumulator;
+    using t_subscriber_list = std::vector<Subscriber>;
 
-    // Whether a message is currently being broadcasted. Used to wait when subscribing.
-    std::atomic g_broadcasting = 0;
+    // The subscribers of each message type.
+    // A published list is never modified. Subscribing and unsubscribing publish a modified copy instead, so broadcasts can iterate a list without locking.
+    std::array<std::atomic<std::shared_ptr<const t_subscriber_list>>, (size_t)Message::Count> g_subscribers;
 
-    // Whether a subscription is currently happening. Used to wait when broadcasting.
-    std::atomic g_subscribing = 0;
+    // Serializes modifications of the subscriber lists.
+    std::mutex g_subscribers_mutex;
 
-    void wait_for_broadcast_end()
-    {
-        while (g_broadcasting != 0)
-        {
-            g_view_logger->info("[Messenger] Waiting for broadcast end...");
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-    }
+    // UID accumulator for generating unique subscriber IDs. Only modified while holding g_subscribers_mutex.
+    size_t g_uid_accumulator;
 
-    void wait_for_subscribe_end()
-    {
-        while (g_subscribing != 0)
-        {
-            g_view_logger->info("[Messenger] Waiting for subscribe end...");
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-    }
+    // The states of the subscribers which are currently being invoked on this thread, innermost last.
+    thread_local std::vector<const SubscriberState*> t_invoking;
 
     void init()
     {
     }
 
     /**
-     * Rebuilds the subscriber cache from the current subscriber vector.
+     * \brief Invokes a subscriber unless it has been removed.
      */
-    void rebuild_subscriber_cache()
+    template <typename F>
+    static void invoke(const Subscriber& subscriber, F&& func)
     {
-        g_subscriber_cache.clear();
+        auto& state = *subscriber.state;
 
-        for (const auto& [key, func] : g_subscribers)
+        // The count is raised before checking the flag, so a removal either sees this invocation or this invocation sees the removal
+        ++state.active;
+        if (!state.removed)
         {
-            g_subscriber_cache[key].push_back(func.cb);
+            t_invoking.push_back(&state);
+            func();
+            t_invoking.pop_back();
         }
+        --state.active;
+        state.active.notify_all();
     }
 
-    void broadcast(const Message message, std::any data)
+    static void remove_subscriber(const Message message, const size_t uid)
     {
-        wait_for_subscribe_end();
+        std::shared_ptr<SubscriberState> state;
+        {
+            std::lock_guard lock(g_subscribers_mutex);
+
+            auto& slot = g_subscribers[(size_t)message];
+            auto list = std::make_shared<t_subscriber_list>(*slot.load());
+            const auto it = std::ranges::find(*list, uid, &Subscriber::uid);
+            if (it == list->end())
+            {
+                return;
+            }
+            state = it->state;
+            list->erase(it);
+            slot.store(std::move(list));
+        }
 
-        ++g_broadcasting;
+        state->removed = true;
 
-        for (const auto& subscriber : g_subscriber_cache[message])
+        // Invocations which started before the removal may still be running, so we wait for them to finish. Other subscribers and broadcasts aren't waited for.
+        // Invocations running on this thread can't finish before we return, so they're exempt, which allows unsubscribing from within a callback.
+        const auto own = (size_t)std::ranges::count(t_invoking, state.get());
+        for (size_t active = state->active; active > own; active = state->active)
         {
-            subscriber(data);
+            state->active.wait(active);
         }
-
-        --g_broadcasting;
     }
 
-    std::function<void()> subscribe(Message message, t_user_callback callback)
+    static std::function<void()> add_subscriber(const Message message, Subscriber subscriber)
     {
-        wait_for_broadcast_end();
-        wait_for_subscribe_end();
+        std::lock_guard lock(g_subscribers_mutex);
+
+        subscriber.uid = g_uid_accumulator++;
+        subscriber.state = std::make_shared<SubscriberState>();
 
-        ++g_subscribing;
+        auto& slot = g_subscribers[(size_t)message];
+        const auto current = slot.load();
+        auto list = current ? std::make_shared<t_subscriber_list>(*current) : std::make_shared<t_subscriber_list>();
+        list->push_back(subscriber);
+        slot.store(std::move(list));
 
-        Subscriber subscriber = {g_uid_accumulator++, callback};
+        return [message, uid = subscriber.uid] {
+            remove_subscriber(message, uid);
+        };
+    }
+
+    void broadcast(const Message message, std::any data)
+    {
+        const auto subscribers = g_subscribers[(size_t)message].load(std::memory_order_acquire);
+        if (!subscribers)
+        {
+            return;
+        }
 
-        g_subscribers.emplace_back(message, subscriber);
-        rebuild_subscriber_cache();
+        for (const auto& subscriber : *subscribers)
+        {
+            if (!subscriber.typed_cb)
+            {
+                invoke(subscriber, [&] { subscriber.cb(data); });
+                continue;
+            }
+
+            if (const auto value = subscriber.unbox(data))
+            {
+                invoke(subscriber, [&] { subscriber.typed_cb(value); });
+            }
+            else
+            {
+                g_view_logger->error("[Messenger] Data of message {} doesn't match its payload type", (int32_t)message);
+            }
+        }
+    }
 
-        --g_subscribing;
+    std::function<void()> subscribe(const Message message, t_user_callback callback)
+    {
+        return add_subscriber(message, Subscriber{.cb = std::move(callback)});
+    }
 
-        return [=] {
-            wait_for_broadcast_end();
-            wait_for_subscribe_end();
+    void Detail::broadcast_typed(const Message message, const void* data, const t_box_func box)
+    {
+        const auto subscribers = g_subscribers[(size_t)message].load(std::memory_order_acquire);
+        if (!subscribers)
+        {
+            return;
+        }
 
-            ++g_subscribing;
+        // The data is only boxed if there are subscribers which take an std::any
+        std::any boxed;
 
-            std::erase_if(g_subscribers, [=](const auto& pair) {
-                return pair.second.uid == subscriber.uid;
-            });
-            rebuild_subscriber_cache();
+        for (const auto& subscriber : *subscribers)
+        {
+            if (subscriber.typed_cb)
+            {
+                invoke(subscriber, [&] { subscriber.typed_cb(data); });
+                continue;
+            }
+
+            if (!boxed.has_value())
+            {
+                boxed = box(data);
+            }
+            invoke(subscriber, [&] { subscriber.cb(boxed); });
+        }
+    }
 
-            --g_subscribing;
-        };
+    std::function<void()> Detail::subscribe_typed(const Message message, t_typed_callback callback, const t_unbox_func unbox)
+    {
+        return add_subscriber(message, Subscriber{.typed_cb = std::move(callback), .unbox = unbox});
     }
 } // namespace Messenger
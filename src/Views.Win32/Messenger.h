@@ -13,7 +13,7 @@ namespace Messenger
      */
     enum class Message {
         /**
-         * \brief Debug message used for benchmarking which should not be subscribed to.
+         * \brief Debug message used for benchmarking which should only be subscribed to by the benchmarks.
          */
         None,
 
@@ -176,10 +176,58 @@ namespace Messenger
          * \brief The CPU resumed state has changed
          */
         DebuggerResumedChanged,
+
+        /**
+         * \brief The amount of message types. Not a message.
+         */
+        Count,
     };
 
     using t_user_callback = std::function<void(std::any)>;
 
+    /**
+     * \brief Maps a message type to the type of its data. Messages with a mapping can be broadcasted and subscribed to with their data type, which avoids boxing the data into an std::any.
+     * \remarks Subscribers taking an std::any still receive typed broadcasts and vice versa, so call sites can be migrated one by one.
+     */
+    template <Message M>
+    struct Payload;
+
+#define MESSENGER_PAYLOAD(message, type) \
+    template <>                          \
+    struct Payload<Message::message> {   \
+        using t = type;                  \
+    }
+
+    MESSENGER_PAYLOAD(None, int32_t);
+    MESSENGER_PAYLOAD(EmuLaunchedChanged, bool);
+    MESSENGER_PAYLOAD(CoreExecutingChanged, bool);
+    MESSENGER_PAYLOAD(EmuPausedChanged, bool);
+    MESSENGER_PAYLOAD(EmuStartingChanged, bool);
+    MESSENGER_PAYLOAD(SpeedModifierChanged, int32_t);
+    MESSENGER_PAYLOAD(WarpModifyStatusChanged, bool);
+    MESSENGER_PAYLOAD(CurrentSampleChanged, int32_t);
+    MESSENGER_PAYLOAD(TaskChanged, core_vcr_task);
+    MESSENGER_PAYLOAD(RerecordsChanged, uint64_t);
+    MESSENGER_PAYLOAD(SeekSavestateChanged, size_t);
+    MESSENGER_PAYLOAD(ReadonlyChanged, bool);
+    MESSENGER_PAYLOAD(DacrateChanged, core_system_type);
+    MESSENGER_PAYLOAD(DebuggerResumedChanged, bool);
+
+#undef MESSENGER_PAYLOAD
+
+    template <Message M>
+    using t_payload = typename Payload<M>::t;
+
+    namespace Detail
+    {
+        using t_typed_callback = std::function<void(const void*)>;
+        using t_box_func = std::any (*)(const void*);
+        using t_unbox_func = const void* (*)(const std::any&);
+
+        void broadcast_typed(Message message, const void* data, t_box_func box);
+        std::function<void()> subscribe_typed(Message message, t_typed_callback callback, t_unbox_func unbox);
+    } // namespace Detail
+
     /**
      * \brief Initializes the messenger
      */
@@ -201,4 +249,36 @@ namespace Messenger
      * \remark This method is thread-safe.
      */
     std::function<void()> subscribe(Message message, t_user_callback callback);
+
+    /**
+     * \brief Broadcasts a message to all listeners without boxing its data
+     * \param data The message data
+     * \remark This method is thread-safe.
+     */
+    template <Message M>
+    void broadcast(const t_payload<M>& data)
+    {
+        Detail::broadcast_typed(M, &data, [](const void* value) {
+            return std::any(*static_cast<const t_payload<M>*>(value));
+        });
+    }
+
+    /**
+     * \brief Subscribe to a message with a callback taking its data type
+     * \param callback The callback to be invoked upon receiving the specified message type
+     * \return A function which, when called, unsubscribes from the message
+     * \remark This method is thread-safe.
+     */
+    template <Message M>
+    std::function<void()> subscribe(std::function<void(const t_payload<M>&)> callback)
+    {
+        return Detail::subscribe_typed(
+        M,
+        [callback = std::move(callback)](const void* value) {
+            callback(*static_cast<const t_payload<M>*>(value));
+        },
+        [](const std::any& value) -> const void* {
+            return std::any_cast<t_payload<M>>(&value);
+        });
+    }
 } // namespace Messenger
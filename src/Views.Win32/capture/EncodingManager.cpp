@@ -41,6 +41,10 @@ namespace EncodingManager
     std::unique_ptr<Encoder> m_encoder;
     std::recursive_mutex m_mutex;
 
+    // The encoder statistics are snapshotted after every frame, so reading them doesn't have to wait for m_mutex while the emu thread is held back by the encoder
+    std::mutex m_stats_mutex;
+    Encoder::Stats m_stats{};
+
     HDC hy_main_dc = nullptr;
     HDC hy_dc = nullptr;
     HBITMAP hy_bmp = nullptr;
@@ -353,6 +357,11 @@ namespace EncodingManager
         m_audio_frame = 0.0;
         m_total_frames = 0;
 
+        {
+            std::lock_guard stats_lock(m_stats_mutex);
+            m_stats = {};
+        }
+
         free(m_video_buf);
         get_video_dimensions(&m_video_width, &m_video_height);
         m_video_buf = (uint8_t*)malloc(m_video_width * m_video_height * 3);
@@ -425,6 +434,9 @@ namespace EncodingManager
         if (m_encoder->append_video(m_video_buf))
         {
             m_total_frames++;
+
+            std::lock_guard stats_lock(m_stats_mutex);
+            m_stats = m_encoder->get_stats();
             return;
         }
 
@@ -463,14 +475,9 @@ namespace EncodingManager
 
     void ai_dacrate_changed(std::any data)
     {
-        auto type = std::any_cast<core_system_type>(data);
+        std::lock_guard lock(m_mutex);
 
-        if (m_capturing)
-        {
-            DialogService::show_dialog(L"Audio frequency changed during capture.\r\nThe capture will be stopped.", L"Capture", fsvc_error);
-            stop_capture();
-            return;
-        }
+        auto type = std::any_cast<core_system_type>(data);
 
         m_audio_bitrate = (int)g_core.ai_register->ai_bitrate + 1;
 
@@ -487,6 +494,12 @@ namespace EncodingManager
             break;
         }
         g_view_logger->info("[EncodingManager] m_audio_freq: {}", m_audio_freq);
+
+        // The encoders resample their audio, so the capture can continue at the new rate
+        if (m_capturing)
+        {
+            m_encoder->set_audio_rate((uint32_t)m_audio_freq);
+        }
     }
 
     size_t get_video_frame()
@@ -494,6 +507,12 @@ namespace EncodingManager
         return m_total_frames;
     }
 
+    Encoder::Stats get_stats()
+    {
+        std::lock_guard lock(m_stats_mutex);
+        return m_stats;
+    }
+
     std::filesystem::path get_current_path()
     {
         return m_current_path;
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <capture/encoders/Encoder.h>
 
 /**
  * Provides encoding functionality to the view.
@@ -76,6 +77,12 @@ namespace EncodingManager
      */
     size_t get_video_frame();
 
+    /**
+     * Gets the encoder's queue statistics as of the last captured frame.
+     * \remarks This method is thread-safe.
+     */
+    Encoder::Stats get_stats();
+
     /**
      * Gets the current output path.
      */
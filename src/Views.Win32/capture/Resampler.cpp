@@ -6,69 +6,116 @@
 
 #include "stdafx.h"
 #include "Resampler.h"
+#include <gui/Loggers.h>
 #include <speex/speex_resampler.h>
+#include <immintrin.h>
 
-SpeexResamplerState* speex_ctx = NULL;
-short in_samps[44100 * 2 * 2]; // big enough i guess?
-short out_samps[44100 * 2 * 2]; // big enough i guess?
-int err = 0;
+// The speex quality level, where 0 is the fastest and 10 the best
+constexpr int QUALITY = 6;
 
-int rates_changed(const int cur_in, const int cur_out)
+// The amount of samples the buffers initially hold, which covers the AI chunks of most games without growing
+constexpr size_t INITIAL_SAMPLES = 8192;
+
+/**
+ * \brief Copies interleaved stereo samples while swapping their channels.
+ * \param dst The destination samples.
+ * \param src The source samples.
+ * \param count The amount of stereo samples.
+ */
+static void swap_channels(int16_t* dst, const int16_t* src, size_t count)
+{
+    // A stereo sample is one 32-bit word, so swapping its channels is a rotation by 16 bits
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 2));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16)));
+    }
+    for (; i < count; ++i)
+    {
+        dst[i * 2] = src[i * 2 + 1];
+        dst[i * 2 + 1] = src[i * 2];
+    }
+}
+
+Resampler::Resampler(const uint32_t src_freq, const uint32_t dst_freq)
+    : m_src_freq(src_freq), m_dst_freq(dst_freq)
 {
-    static spx_uint32_t in;
-    static spx_uint32_t out;
-    speex_resampler_get_rate(speex_ctx, &in, &out);
-    return in != (unsigned int)cur_in || out != (unsigned int)cur_out;
+    m_in.resize(INITIAL_SAMPLES * 2);
+    m_out.resize(INITIAL_SAMPLES * 2);
 }
 
-int rsmp_get_resample_len(const int dst_freq, const int src_freq, const int src_bitrate, int src_len)
+Resampler::~Resampler()
 {
-    // convert bitrate to 16 bits
-    if (src_bitrate != 16)
+    if (m_ctx)
     {
-        if (src_bitrate != 4 && src_bitrate != 8)
-            return -1; // unknown result
-
-        src_len = src_len * (16 / src_bitrate);
+        speex_resampler_destroy(m_ctx);
     }
+}
 
-    const long double ratio = src_freq / (long double)dst_freq;
-    const int dst_len = src_len / ratio;
+void Resampler::set_src_freq(const uint32_t src_freq)
+{
+    if (src_freq == m_src_freq)
+    {
+        return;
+    }
 
-    return dst_len;
+    m_src_freq = src_freq;
+    if (m_ctx)
+    {
+        speex_resampler_set_rate(m_ctx, m_src_freq, m_dst_freq);
+    }
 }
 
-int rsmp_resample(short** dst, const int dst_freq,
-                  const short* src, const int src_freq, const int src_bitrate, const int src_len)
+std::span<const uint8_t> Resampler::process(const uint8_t* src, const size_t length)
 {
-    if (src_bitrate != 16)
+    const size_t count = length / 4;
+
+    if (m_in.size() < count * 2)
     {
-        puts("[VCR]: resample: Bitrate is not 16 bits");
-        return -1;
+        m_in.resize(count * 2);
     }
+    swap_channels(m_in.data(), (const int16_t*)src, count);
 
-    // for some reason channels are swapped in src (endianess weirdness?)
-    // fix it here
-    for (unsigned i = 0, samps = src_len >> 1; i < samps; i += 2)
+    // Once the resampler exists, it keeps being used even if the rates match again, so its filter state isn't cut off
+    if (!m_ctx && m_src_freq == m_dst_freq)
     {
-        in_samps[i + 1] = src[i + 0];
-        in_samps[i + 0] = src[i + 1];
+        return {(const uint8_t*)m_in.data(), count * 4};
     }
 
-    if (!speex_ctx)
+    if (!m_ctx)
     {
-        speex_ctx = speex_resampler_init(2, src_freq, dst_freq, 6, &err);
+        int err = 0;
+        m_ctx = speex_resampler_init(2, m_src_freq, m_dst_freq, QUALITY, &err);
+        if (!m_ctx)
+        {
+            g_view_logger->error("[Resampler] speex_resampler_init failed with error {}", err);
+            return {};
+        }
     }
 
-    if (rates_changed(src_freq, dst_freq))
+    // The output can be a few samples longer than the rate ratio suggests because of the samples buffered by the filter
+    const size_t max_out = count * m_dst_freq / m_src_freq + 16;
+    if (m_out.size() < max_out * 2)
     {
-        speex_resampler_set_rate(speex_ctx, src_freq, dst_freq);
+        m_out.resize(max_out * 2);
     }
 
-    spx_uint32_t in_pos = (spx_uint32_t)src_len / 4;
-    spx_uint32_t out_pos = sizeof(out_samps) / 4;
-    speex_resampler_process_interleaved_int(speex_ctx, in_samps, &in_pos, out_samps, &out_pos);
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+    while (in_pos < count)
+    {
+        spx_uint32_t in_len = (spx_uint32_t)(count - in_pos);
+        spx_uint32_t out_len = (spx_uint32_t)(m_out.size() / 2 - out_pos);
+        speex_resampler_process_interleaved_int(m_ctx, m_in.data() + in_pos * 2, &in_len, m_out.data() + out_pos * 2, &out_len);
+        in_pos += in_len;
+        out_pos += out_len;
+
+        if (in_pos < count)
+        {
+            m_out.resize(m_out.size() * 2);
+        }
+    }
 
-    *dst = out_samps;
-    return (int)out_pos * 4;
+    return {(const uint8_t*)m_out.data(), out_pos * 4};
 }
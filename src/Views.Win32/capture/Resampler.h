@@ -6,9 +6,46 @@
 
 #pragma once
 
-int rsmp_resample(short** dst, int dst_freq,
-                  const short* src, int src_freq, int src_bitrate, int src_len);
+struct SpeexResamplerState_;
 
+/**
+ * \brief Resamples the 16-bit stereo audio of one capture to a fixed output rate.
+ * The input is expected in the AI's RDRAM layout, where the channels of each sample are swapped, and the output is in regular left-right order.
+ * The buffers are reused between calls, so no allocations happen once they've grown to the largest chunk size.
+ */
+class Resampler {
+public:
+    /**
+     * \brief Creates a resampler.
+     * \param src_freq The input sample rate.
+     * \param dst_freq The output sample rate.
+     */
+    Resampler(uint32_t src_freq, uint32_t dst_freq);
+    ~Resampler();
+
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    /**
+     * \brief Changes the input sample rate. The filter state is kept, so the output stays continuous across the change.
+     */
+    void set_src_freq(uint32_t src_freq);
+
+    /**
+     * \brief Resamples a chunk of audio.
+     * \param src The audio data.
+     * \param length The audio length in bytes. Trailing bytes which don't form a whole sample are ignored.
+     * \return The resampled audio, which stays valid until the next call.
+     */
+    std::span<const uint8_t> process(const uint8_t* src, size_t length);
+
+private:
+    uint32_t m_src_freq;
+    uint32_t m_dst_freq;
+
+    // Created on the first chunk whose rate differs from the output rate, since chunks at the output rate are passed through
+    SpeexResamplerState_* m_ctx = nullptr;
 
-int rsmp_get_resample_len(int dst_freq, int src_freq, int src_bitrate,
-                          int src_len);
+    std::vector<int16_t> m_in;
+    std::vector<int16_t> m_out;
+};
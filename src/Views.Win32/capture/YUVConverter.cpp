@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * The conversion works on pairs of rows, since each chroma sample covers a 2x2 block of pixels.
+ * The SSSE3 path handles 16 pixels of both rows at once and leaves the remaining columns to the scalar path, which produces the same results.
+ */
+
+#include "stdafx.h"
+#include "YUVConverter.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+// The number of pixels handled by one step of the SSSE3 path
+constexpr int32_t SIMD_PIXELS = 16;
+
+static uint8_t get_y(int32_t b, int32_t g, int32_t r)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static uint8_t get_u(int32_t b, int32_t g, int32_t r)
+{
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static uint8_t get_v(int32_t b, int32_t g, int32_t r)
+{
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/**
+ * \brief Converts the columns [begin, end) of a pair of rows.
+ */
+static void convert_rows_scalar(const uint8_t* row0, const uint8_t* row1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, size_t chroma_step, int32_t begin, int32_t end)
+{
+    for (int32_t x = begin; x < end; x += 2)
+    {
+        const uint8_t* p[4] = {row0 + x * 3, row0 + x * 3 + 3, row1 + x * 3, row1 + x * 3 + 3};
+
+        y0[x] = get_y(p[0][0], p[0][1], p[0][2]);
+        y0[x + 1] = get_y(p[1][0], p[1][1], p[1][2]);
+        y1[x] = get_y(p[2][0], p[2][1], p[2][2]);
+        y1[x + 1] = get_y(p[3][0], p[3][1], p[3][2]);
+
+        const int32_t b = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+        const int32_t g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+        const int32_t r = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+
+        const size_t i = (size_t)(x / 2) * chroma_step;
+        u[i] = get_u(b, g, r);
+        v[i] = get_v(b, g, r);
+    }
+}
+
+/**
+ * \brief Builds the shuffle mask which gathers one channel of 16 BGR24 pixels from one of the three vectors they span.
+ */
+static __m128i make_channel_mask(int32_t channel, int32_t part)
+{
+    alignas(16) int8_t mask[16];
+    for (int32_t i = 0; i < 16; ++i)
+    {
+        const int32_t index = i * 3 + channel - part * 16;
+        mask[i] = index >= 0 && index < 16 ? (int8_t)index : (int8_t)0x80;
+    }
+    return _mm_load_si128((const __m128i*)mask);
+}
+
+struct t_channel_masks {
+    __m128i masks[3][3];
+
+    t_channel_masks()
+    {
+        for (int32_t channel = 0; channel < 3; ++channel)
+        {
+            for (int32_t part = 0; part < 3; ++part)
+            {
+                masks[channel][part] = make_channel_mask(channel, part);
+            }
+        }
+    }
+};
+
+/**
+ * \brief Splits 16 BGR24 pixels into their B, G and R channels.
+ */
+static void load_channels(const uint8_t* p, const t_channel_masks& m, __m128i& b, __m128i& g, __m128i& r)
+{
+    const __m128i v[3] = {
+    _mm_loadu_si128((const __m128i*)p),
+    _mm_loadu_si128((const __m128i*)(p + 16)),
+    _mm_loadu_si128((const __m128i*)(p + 32)),
+    };
+
+    __m128i* channels[3] = {&b, &g, &r};
+    for (int32_t channel = 0; channel < 3; ++channel)
+    {
+        *channels[channel] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], m.masks[channel][0]), _mm_shuffle_epi8(v[1], m.masks[channel][1])), _mm_shuffle_epi8(v[2], m.masks[channel][2]));
+    }
+}
+
+/**
+ * \brief Computes the luma of 8 pixels whose channels are widened to 16 bits.
+ */
+static __m128i get_y_epi16(__m128i b, __m128i g, __m128i r)
+{
+    // The weighted sum stays below 2^16, so it's computed in unsigned 16-bit lanes
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+static __m128i get_y_epi8(__m128i b, __m128i g, __m128i r)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = get_y_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero));
+    const __m128i hi = get_y_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+/**
+ * \brief Averages the 2x2 blocks of one channel of two rows of 16 pixels into 8 16-bit values.
+ */
+static __m128i average_blocks(__m128i row0, __m128i row1)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(row0, ones), _mm_maddubs_epi16(row1, ones));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+/**
+ * \brief Computes a chroma component of 8 averaged pixels. The weighted sum fits into signed 16-bit lanes.
+ */
+static __m128i get_chroma_epi16(__m128i b, __m128i g, __m128i r, int16_t cb, int16_t cg, int16_t cr)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+static void convert_rows_ssse3(const uint8_t* row0, const uint8_t* row1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, bool nv12, int32_t end)
+{
+    static const t_channel_masks masks;
+
+    for (int32_t x = 0; x < end; x += SIMD_PIXELS)
+    {
+        __m128i b0, g0, r0, b1, g1, r1;
+        load_channels(row0 + x * 3, masks, b0, g0, r0);
+        load_channels(row1 + x * 3, masks, b1, g1, r1);
+
+        _mm_storeu_si128((__m128i*)(y0 + x), get_y_epi8(b0, g0, r0));
+        _mm_storeu_si128((__m128i*)(y1 + x), get_y_epi8(b1, g1, r1));
+
+        const __m128i b = average_blocks(b0, b1);
+        const __m128i g = average_blocks(g0, g1);
+        const __m128i r = average_blocks(r0, r1);
+
+        const __m128i u8 = _mm_packus_epi16(get_chroma_epi16(b, g, r, 112, -74, -38), _mm_setzero_si128());
+        const __m128i v8 = _mm_packus_epi16(get_chroma_epi16(b, g, r, -18, -94, 112), _mm_setzero_si128());
+
+        if (nv12)
+        {
+            _mm_storeu_si128((__m128i*)(u + x), _mm_unpacklo_epi8(u8, v8));
+        }
+        else
+        {
+            _mm_storel_epi64((__m128i*)(u + x / 2), u8);
+            _mm_storel_epi64((__m128i*)(v + x / 2), v8);
+        }
+    }
+}
+
+static bool has_ssse3()
+{
+    int info[4]{};
+    __cpuid(info, 1);
+    return info[2] & (1 << 9);
+}
+
+size_t yuv_get_frame_size(int32_t width, int32_t height)
+{
+    return (size_t)width * height * 3 / 2;
+}
+
+void yuv_from_bgr24(const uint8_t* src, uint8_t* dst, int32_t width, int32_t height, bool nv12)
+{
+    static const bool ssse3 = has_ssse3();
+
+    const size_t stride = (size_t)width * 3;
+    const size_t luma_size = (size_t)width * height;
+    const size_t chroma_size = luma_size / 4;
+
+    // For NV12, V directly follows U in the interleaved plane
+    uint8_t* u_plane = dst + luma_size;
+    uint8_t* v_plane = nv12 ? u_plane + 1 : u_plane + chroma_size;
+    const size_t chroma_stride = nv12 ? width : width / 2;
+    const size_t chroma_step = nv12 ? 2 : 1;
+
+    const int32_t simd_end = ssse3 ? width / SIMD_PIXELS * SIMD_PIXELS : 0;
+
+    for (int32_t row = 0; row < height; row += 2)
+    {
+        const uint8_t* row0 = src + row * stride;
+        const uint8_t* row1 = row0 + stride;
+        uint8_t* y0 = dst + (size_t)row * width;
+        uint8_t* y1 = y0 + width;
+        uint8_t* u = u_plane + (size_t)(row / 2) * chroma_stride;
+        uint8_t* v = v_plane + (size_t)(row / 2) * chroma_stride;
+
+        if (simd_end > 0)
+        {
+            convert_rows_ssse3(row0, row1, y0, y1, u, v, nv12, simd_end);
+        }
+        convert_rows_scalar(row0, row1, y0, y1, u, v, chroma_step, simd_end, width);
+    }
+}
+
+void yuv_fill_black(uint8_t* dst, int32_t width, int32_t height)
+{
+    const size_t luma_size = (size_t)width * height;
+    memset(dst, 16, luma_size);
+    memset(dst + luma_size, 128, luma_size / 2);
+}
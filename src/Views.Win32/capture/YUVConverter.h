@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * \brief Gets the size of a 4:2:0 YUV frame, which is half the size of the same frame in BGR24.
+ * \param width The frame width. Must be even.
+ * \param height The frame height. Must be even.
+ */
+size_t yuv_get_frame_size(int32_t width, int32_t height);
+
+/**
+ * \brief Converts a packed BGR24 frame to 4:2:0 YUV with BT.601 limited range coefficients.
+ * \param src The BGR24 frame, whose rows are not padded.
+ * \param dst The YUV frame. Must be yuv_get_frame_size bytes large.
+ * \param width The frame width. Must be even.
+ * \param height The frame height. Must be even.
+ * \param nv12 Whether the chroma is stored as one interleaved UV plane (NV12) instead of separate U and V planes (YUV420P).
+ * \remarks The row order is preserved, so bottom-up frames stay bottom-up.
+ */
+void yuv_from_bgr24(const uint8_t* src, uint8_t* dst, int32_t width, int32_t height, bool nv12);
+
+/**
+ * \brief Fills a 4:2:0 YUV frame with black.
+ */
+void yuv_fill_black(uint8_t* dst, int32_t width, int32_t height);
@@ -9,7 +9,6 @@
 #include <DialogService.h>
 
 #include <capture/EncodingManager.h>
-#include <capture/Resampler.h>
 #include <capture/encoders/AVIEncoder.h>
 #include <gui/Loggers.h>
 #include <gui/Main.h>
@@ -20,6 +19,7 @@ std::wstring AVIEncoder::start(Params params)
     if (!m_splitting)
     {
         m_params = params;
+        m_resampler = std::make_unique<Resampler>(params.arate, RESAMPLED_FREQ);
     }
     m_avi_file_size = 0;
     m_frame = 0;
@@ -91,8 +91,8 @@ std::wstring AVIEncoder::start(Params params)
     m_sample = 0;
     m_sound_format.wFormatTag = WAVE_FORMAT_PCM;
     m_sound_format.nChannels = 2;
-    m_sound_format.nSamplesPerSec = 44100;
-    m_sound_format.nAvgBytesPerSec = 44100 * (2 * 16 / 8);
+    m_sound_format.nSamplesPerSec = RESAMPLED_FREQ;
+    m_sound_format.nAvgBytesPerSec = RESAMPLED_FREQ * (2 * 16 / 8);
     m_sound_format.nBlockAlign = 2 * 16 / 8;
     m_sound_format.wBitsPerSample = 16;
     m_sound_format.cbSize = 0;
@@ -273,26 +273,21 @@ bool AVIEncoder::write_sound(uint8_t* buf, int len, const int min_write_size, co
     if ((len <= 0 && !force) || len > max_write_size)
         return false;
 
-    if (sound_buf_pos + len > min_write_size || force)
+    if ((sound_buf_pos + len > min_write_size || force) && m_resampler)
     {
-        int len2 = rsmp_get_resample_len(RESAMPLED_FREQ, m_params.arate, bitrate, sound_buf_pos);
-        if ((len2 % 8) == 0 || len > max_write_size)
+        // The resampler keeps its filter state between chunks, so the buffer can be flushed at any length
+        if (bitrate != 16)
         {
-            static short* buf2 = nullptr;
-            len2 = rsmp_resample(&buf2, RESAMPLED_FREQ, reinterpret_cast<short*>(m_sound_buf), m_params.arate, bitrate, sound_buf_pos);
+            g_view_logger->error("[AVIEncoder] Dropping audio with unsupported bitrate {}", bitrate);
+        }
+        else if (sound_buf_pos > 0)
+        {
+            const auto resampled = m_resampler->process(m_sound_buf, sound_buf_pos);
+            const auto len2 = (LONG)resampled.size();
 
             if (len2 > 0)
             {
-                if ((len2 % 4) != 0)
-                {
-                    g_view_logger->info(
-                    "[EncodingManager]: Warning: Possible stereo sound error detected.\n");
-                    fprintf(
-                    stderr,
-                    "[EncodingManager]: Warning: Possible stereo sound error detected.\n");
-                }
-
-                const BOOL ok = (0 == AVIStreamWrite(m_sound_stream, m_sample, len2 / m_sound_format.nBlockAlign, buf2, len2, 0, NULL, NULL));
+                const BOOL ok = (0 == AVIStreamWrite(m_sound_stream, m_sample, len2 / m_sound_format.nBlockAlign, (LPVOID)resampled.data(), len2, 0, NULL, NULL));
                 m_sample += len2 / m_sound_format.nBlockAlign;
                 m_avi_file_size += len2;
 
@@ -302,8 +297,8 @@ bool AVIEncoder::write_sound(uint8_t* buf, int len, const int min_write_size, co
                     return false;
                 }
             }
-            sound_buf_pos = 0;
         }
+        sound_buf_pos = 0;
     }
 
     if (len <= 0)
@@ -332,6 +327,14 @@ bool AVIEncoder::write_sound(uint8_t* buf, int len, const int min_write_size, co
     return true;
 }
 
+void AVIEncoder::set_audio_rate(uint32_t arate)
+{
+    // The buffered audio is still at the previous rate, so it's flushed before switching
+    write_sound(nullptr, 0, m_params.arate, m_params.arate * 2, TRUE, 16);
+    m_params.arate = arate;
+    m_resampler->set_src_freq(arate);
+}
+
 bool AVIEncoder::append_video_impl(uint8_t* image)
 {
     LONG written_len;
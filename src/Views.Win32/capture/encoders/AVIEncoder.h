@@ -7,6 +7,7 @@
 #pragma once
 
 #include "Encoder.h"
+#include <capture/Resampler.h>
 
 #include <Vfw.h>
 
@@ -16,6 +17,7 @@ public:
     bool stop() override;
     bool append_video(uint8_t* image) override;
     bool append_audio(uint8_t* audio, size_t length, uint8_t bitrate) override;
+    void set_audio_rate(uint32_t arate) override;
 
 private:
     // 44100=1s sample, soundbuffer capable of holding 4s future data in circular buffer
@@ -29,6 +31,7 @@ private:
     bool load_options();
 
     Params m_params{};
+    std::unique_ptr<Resampler> m_resampler;
     AVICOMPRESSOPTIONS* m_avi_options = new AVICOMPRESSOPTIONS();
 
     bool m_splitting = false;
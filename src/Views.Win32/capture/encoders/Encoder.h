@@ -35,6 +35,37 @@ public:
         bool ask_for_encoding_settings;
     };
 
+    struct Stats {
+        /**
+         * \brief The amount of video frames waiting to be encoded
+         */
+        size_t video_queue_depth;
+        /**
+         * \brief The maximum amount of video frames which can wait to be encoded, or 0 if the encoder doesn't queue frames
+         */
+        size_t video_queue_capacity;
+        /**
+         * \brief The highest video queue depth since encoding started
+         */
+        size_t video_queue_peak;
+        /**
+         * \brief The amount of audio bytes waiting to be encoded
+         */
+        size_t audio_queue_depth;
+        /**
+         * \brief The amount of video frames which were dropped because the video queue was full
+         */
+        size_t dropped_frames;
+        /**
+         * \brief The amount of video frames which weren't encoded because they were identical to the previous one
+         */
+        size_t duplicate_frames;
+        /**
+         * \brief The amount of times emulation was slowed down because the video queue was full
+         */
+        size_t stalls;
+    };
+
     /**
      * \brief Destroys the encoder and cleans up its resources
      */
@@ -68,4 +99,19 @@ public:
      * \return Whether the operation succeeded
      */
     virtual bool append_audio(uint8_t* audio, size_t length, uint8_t bitrate) = 0;
+
+    /**
+     * \brief Notifies the encoder about the audio sample rate changing. The audio appended afterwards is at the new rate.
+     * \param arate The new audio sample rate
+     */
+    virtual void set_audio_rate(uint32_t arate) = 0;
+
+    /**
+     * \brief Gets the encoder's queue statistics
+     * \remarks This method is thread-safe.
+     */
+    virtual Stats get_stats()
+    {
+        return {};
+    }
 };
@@ -10,6 +10,226 @@
 #include <Config.h>
 #include <gui/Main.h>
 #include <gui/Loggers.h>
+#include <capture/YUVConverter.h>
+
+// The rawvideo input options of the default FFmpeg options, which are replaced by a Matroska input when capturing with a variable frame rate
+constexpr std::wstring_view RAWVIDEO_INPUT_OPTIONS = L"-f rawvideo -pixel_format bgr24 -video_size %dx%d -framerate %d -i %s";
+
+/**
+ * \brief Computes the XXH64 hash of a buffer.
+ * \remarks xxh64::hash recurses once per 32 bytes, which overflows the stack for buffers as large as a frame, so this is an iterative equivalent.
+ */
+static uint64_t hash_frame(const uint8_t* p, size_t len)
+{
+    constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+    constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+    constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+    constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+    constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+    const auto read64 = [](const uint8_t* p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    };
+    const auto round = [](uint64_t acc, uint64_t input) {
+        return std::rotl(acc + input * PRIME2, 31) * PRIME1;
+    };
+    const auto merge = [&](uint64_t acc, uint64_t value) {
+        return (acc ^ round(0, value)) * PRIME1 + PRIME4;
+    };
+
+    const uint8_t* end = p + len;
+    uint64_t h;
+    if (len >= 32)
+    {
+        uint64_t v1 = PRIME1 + PRIME2;
+        uint64_t v2 = PRIME2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - PRIME1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+    {
+        h = PRIME5;
+    }
+
+    h += len;
+    for (; end - p >= 8; p += 8)
+    {
+        h = std::rotl(h ^ round(0, read64(p)), 27) * PRIME1 + PRIME4;
+    }
+    if (end - p >= 4)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        h = std::rotl(h ^ value * PRIME1, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h = std::rotl(h ^ *p * PRIME5, 11) * PRIME1;
+    }
+
+    h = (h ^ (h >> 33)) * PRIME2;
+    h = (h ^ (h >> 29)) * PRIME3;
+    return h ^ (h >> 32);
+}
+
+/**
+ * Minimal Matroska writing for the variable frame rate video stream.
+ * All element sizes are written with 8 bytes, which keeps the per-frame headers at a fixed size.
+ */
+namespace Mkv
+{
+    constexpr uint32_t EBML = 0x1A45DFA3;
+    constexpr uint32_t EBML_VERSION = 0x4286;
+    constexpr uint32_t EBML_READ_VERSION = 0x42F7;
+    constexpr uint32_t EBML_MAX_ID_LENGTH = 0x42F2;
+    constexpr uint32_t EBML_MAX_SIZE_LENGTH = 0x42F3;
+    constexpr uint32_t DOC_TYPE = 0x4282;
+    constexpr uint32_t DOC_TYPE_VERSION = 0x4287;
+    constexpr uint32_t DOC_TYPE_READ_VERSION = 0x4285;
+    constexpr uint32_t SEGMENT = 0x18538067;
+    constexpr uint32_t INFO = 0x1549A966;
+    constexpr uint32_t TIMESTAMP_SCALE = 0x2AD7B1;
+    constexpr uint32_t MUXING_APP = 0x4D80;
+    constexpr uint32_t WRITING_APP = 0x5741;
+    constexpr uint32_t TRACKS = 0x1654AE6B;
+    constexpr uint32_t TRACK_ENTRY = 0xAE;
+    constexpr uint32_t TRACK_NUMBER = 0xD7;
+    constexpr uint32_t TRACK_UID = 0x73C5;
+    constexpr uint32_t TRACK_TYPE = 0x83;
+    constexpr uint32_t FLAG_LACING = 0x9C;
+    constexpr uint32_t CODEC_ID = 0x86;
+    constexpr uint32_t VIDEO = 0xE0;
+    constexpr uint32_t PIXEL_WIDTH = 0xB0;
+    constexpr uint32_t PIXEL_HEIGHT = 0xBA;
+    constexpr uint32_t COLOUR_SPACE = 0x2EB524;
+    constexpr uint32_t CLUSTER = 0x1F43B675;
+    constexpr uint32_t TIMESTAMP = 0xE7;
+    constexpr uint32_t SIMPLE_BLOCK = 0xA3;
+
+    // The size of a cluster's children before its frame data: the timestamp element and the simple block's header
+    constexpr size_t CLUSTER_BODY_HEADER_SIZE = (1 + 8 + 8) + (1 + 8 + 4);
+
+    // The timestamps are in microseconds
+    constexpr uint64_t TIMESTAMP_SCALE_NS = 1000;
+
+    static void put_id(std::vector<uint8_t>& out, uint32_t id)
+    {
+        for (int shift = (std::bit_width(id) - 1) / 8 * 8; shift >= 0; shift -= 8)
+        {
+            out.push_back((uint8_t)(id >> shift));
+        }
+    }
+
+    static void put_size(std::vector<uint8_t>& out, uint64_t size)
+    {
+        out.push_back(0x01);
+        for (int shift = 48; shift >= 0; shift -= 8)
+        {
+            out.push_back((uint8_t)(size >> shift));
+        }
+    }
+
+    static void put_uint(std::vector<uint8_t>& out, uint32_t id, uint64_t value)
+    {
+        put_id(out, id);
+        put_size(out, 8);
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            out.push_back((uint8_t)(value >> shift));
+        }
+    }
+
+    static void put_bytes(std::vector<uint8_t>& out, uint32_t id, std::string_view bytes)
+    {
+        put_id(out, id);
+        put_size(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    static void put_master(std::vector<uint8_t>& out, uint32_t id, const std::vector<uint8_t>& body)
+    {
+        put_id(out, id);
+        put_size(out, body.size());
+        out.insert(out.end(), body.begin(), body.end());
+    }
+
+    /**
+     * \brief Builds the EBML header and the start of a segment with one uncompressed video track.
+     * \param fourcc The video track's pixel format, in the fourcc notation ffmpeg uses for raw video.
+     */
+    static std::vector<uint8_t> make_header(uint32_t width, uint32_t height, std::string_view fourcc)
+    {
+        std::vector<uint8_t> ebml;
+        put_uint(ebml, EBML_VERSION, 1);
+        put_uint(ebml, EBML_READ_VERSION, 1);
+        put_uint(ebml, EBML_MAX_ID_LENGTH, 4);
+        put_uint(ebml, EBML_MAX_SIZE_LENGTH, 8);
+        put_bytes(ebml, DOC_TYPE, "matroska");
+        put_uint(ebml, DOC_TYPE_VERSION, 4);
+        put_uint(ebml, DOC_TYPE_READ_VERSION, 2);
+
+        std::vector<uint8_t> info;
+        put_uint(info, TIMESTAMP_SCALE, TIMESTAMP_SCALE_NS);
+        put_bytes(info, MUXING_APP, "mupen64");
+        put_bytes(info, WRITING_APP, "mupen64");
+
+        std::vector<uint8_t> video;
+        put_uint(video, PIXEL_WIDTH, width);
+        put_uint(video, PIXEL_HEIGHT, height);
+        put_bytes(video, COLOUR_SPACE, fourcc);
+
+        std::vector<uint8_t> track;
+        put_uint(track, TRACK_NUMBER, 1);
+        put_uint(track, TRACK_UID, 1);
+        put_uint(track, TRACK_TYPE, 1);
+        put_uint(track, FLAG_LACING, 0);
+        put_bytes(track, CODEC_ID, "V_UNCOMPRESSED");
+        put_master(track, VIDEO, video);
+
+        std::vector<uint8_t> tracks;
+        put_master(tracks, TRACK_ENTRY, track);
+
+        std::vector<uint8_t> out;
+        put_master(out, EBML, ebml);
+
+        // The segment is streamed, so its size is unknown
+        put_id(out, SEGMENT);
+        out.push_back(0x01);
+        out.insert(out.end(), 7, 0xFF);
+
+        put_master(out, INFO, info);
+        put_master(out, TRACKS, tracks);
+        return out;
+    }
+
+    /**
+     * \brief Builds the header of a cluster holding a single frame, which is directly followed by the frame data.
+     */
+    static void make_frame_header(std::vector<uint8_t>& out, uint64_t timestamp, size_t frame_size)
+    {
+        out.clear();
+        put_id(out, CLUSTER);
+        put_size(out, CLUSTER_BODY_HEADER_SIZE + frame_size);
+        put_uint(out, TIMESTAMP, timestamp);
+        put_id(out, SIMPLE_BLOCK);
+        put_size(out, 4 + frame_size);
+
+        // Track 1, no timestamp offset from the cluster, keyframe
+        out.insert(out.end(), {0x81, 0x00, 0x00, 0x80});
+    }
+} // namespace Mkv
 
 std::wstring FFmpegEncoder::start(Params params)
 {
@@ -20,11 +240,12 @@ std::wstring FFmpegEncoder::start(Params params)
 
     g_view_logger->info("[FFmpegEncoder] arate: {}, bufsize_video: {}, bufsize_audio: {}\n", m_params.arate, bufsize_video, bufsize_audio);
 
-#define VIDEO_PIPE_NAME L"\\\\.\\pipe\\mupenvideo"
-#define AUDIO_PIPE_NAME L"\\\\.\\pipe\\mupenaudio"
+    // The pipe names are unique per process, so multiple emulator instances can capture at the same time
+    const auto video_pipe_name = std::format(L"\\\\.\\pipe\\mupenvideo{}", GetCurrentProcessId());
+    const auto audio_pipe_name = std::format(L"\\\\.\\pipe\\mupenaudio{}", GetCurrentProcessId());
 
     m_video_pipe = CreateNamedPipe(
-    VIDEO_PIPE_NAME,
+    video_pipe_name.c_str(),
     PIPE_ACCESS_OUTBOUND,
     PIPE_TYPE_BYTE | PIPE_WAIT,
     PIPE_UNLIMITED_INSTANCES,
@@ -39,7 +260,7 @@ std::wstring FFmpegEncoder::start(Params params)
     }
 
     m_audio_pipe = CreateNamedPipe(
-    AUDIO_PIPE_NAME,
+    audio_pipe_name.c_str(),
     PIPE_ACCESS_OUTBOUND,
     PIPE_TYPE_BYTE | PIPE_WAIT,
     PIPE_UNLIMITED_INSTANCES,
@@ -54,18 +275,67 @@ std::wstring FFmpegEncoder::start(Params params)
         return L"Failed to create audio pipe.";
     }
 
+    m_pixel_format = (cfg_pixel_format)g_config.capture_pixel_format;
+    m_vfr = g_config.capture_vfr;
+    auto options_format = g_config.ffmpeg_final_options;
+
+    // With a variable frame rate, the video is sent as Matroska so each frame carries its own timestamp. The output has to be told not to fill the gaps with duplicates again.
+    if (m_vfr)
+    {
+        const auto pos = options_format.find(RAWVIDEO_INPUT_OPTIONS);
+        const auto output_pos = options_format.rfind(L"%s");
+        if (pos == std::wstring::npos || output_pos < pos + RAWVIDEO_INPUT_OPTIONS.size())
+        {
+            g_view_logger->warn("[FFmpegEncoder] The FFmpeg options don't contain the default rawvideo input, falling back to a constant frame rate");
+            m_vfr = false;
+        }
+        else
+        {
+            options_format.insert(output_pos, L"-fps_mode vfr ");
+            options_format.replace(pos, RAWVIDEO_INPUT_OPTIONS.size(), L"-f matroska -i %s");
+        }
+    }
+
+    // The pixel format is negotiated through the input options, so frames are only converted when ffmpeg can be told about it
+    if (m_pixel_format != PIXEL_FORMAT_BGR24)
+    {
+        constexpr std::wstring_view bgr24_option = L"-pixel_format bgr24";
+        const auto pos = options_format.find(bgr24_option);
+        if ((pos == std::wstring::npos && !m_vfr) || m_params.width % 2 != 0 || m_params.height % 2 != 0)
+        {
+            g_view_logger->warn("[FFmpegEncoder] Can't use a YUV pixel format with a {}x{} resolution and the current options, falling back to BGR24", m_params.width, m_params.height);
+            m_pixel_format = PIXEL_FORMAT_BGR24;
+        }
+        else if (!m_vfr)
+        {
+            options_format.replace(pos, bgr24_option.size(), m_pixel_format == PIXEL_FORMAT_NV12 ? L"-pixel_format nv12" : L"-pixel_format yuv420p");
+        }
+    }
+
     static wchar_t options[4096]{};
     memset(options, 0, sizeof(options));
 
-    wsprintf(options,
-             g_config.ffmpeg_final_options.data(),
-             m_params.width,
-             m_params.height,
-             m_params.fps,
-             VIDEO_PIPE_NAME,
-             m_params.arate,
-             AUDIO_PIPE_NAME,
-             m_params.path.wstring().data());
+    if (m_vfr)
+    {
+        wsprintf(options,
+                 options_format.data(),
+                 video_pipe_name.c_str(),
+                 m_params.arate,
+                 audio_pipe_name.c_str(),
+                 m_params.path.wstring().data());
+    }
+    else
+    {
+        wsprintf(options,
+                 options_format.data(),
+                 m_params.width,
+                 m_params.height,
+                 m_params.fps,
+                 video_pipe_name.c_str(),
+                 m_params.arate,
+                 audio_pipe_name.c_str(),
+                 m_params.path.wstring().data());
+    }
 
     g_view_logger->info(L"[FFmpegEncoder] Starting encode with commandline:");
     g_view_logger->info(L"[FFmpegEncoder] {}", options);
@@ -90,23 +360,75 @@ std::wstring FFmpegEncoder::start(Params params)
         return std::format(L"Failed to start ffmpeg process! Does ffmpeg exist on disk at '{}'?", g_config.ffmpeg_path);
     }
 
+    m_frame_size = m_pixel_format == PIXEL_FORMAT_BGR24 ? m_params.width * m_params.height * 3 : yuv_get_frame_size(m_params.width, m_params.height);
     m_silence_buffer = static_cast<uint8_t*>(calloc(params.arate, 1));
-    m_blank_buffer = static_cast<uint8_t*>(calloc(m_params.width * m_params.height * 3, 1));
+    m_blank_buffer = static_cast<uint8_t*>(calloc(m_frame_size, 1));
+    if (m_pixel_format != PIXEL_FORMAT_BGR24)
+    {
+        yuv_fill_black(m_blank_buffer, m_params.width, m_params.height);
+    }
+    m_drop_on_overflow = g_config.capture_drop_on_overflow;
+    m_video_queue_peak = 0;
     m_dropped_frames = 0;
+    m_stalls = 0;
+    m_video_timed_out = false;
+    m_video_frame_index = 0;
+    m_duplicate_frames = 0;
+    m_has_last_hash = false;
+    m_tail_pending = false;
+    if (m_vfr)
+    {
+        m_tail_frame = std::make_unique_for_overwrite<uint8_t[]>(m_params.width * m_params.height * 3);
+    }
+
+    m_resampler = std::make_unique<Resampler>(m_params.arate, m_params.arate);
+    m_audio_ring_size = m_params.arate * 4 * AUDIO_RING_SECONDS;
+    m_audio_ring = std::make_unique_for_overwrite<uint8_t[]>(m_audio_ring_size);
+    m_audio_read_pos = 0;
+    m_audio_write_pos = 0;
+    m_audio_stalls = 0;
+    m_dropped_audio_bytes = 0;
+    m_audio_timed_out = false;
+
+    const auto pool_frames = std::clamp(VIDEO_POOL_BYTES / m_frame_size, MIN_VIDEO_POOL_FRAMES, MAX_VIDEO_POOL_FRAMES);
+    m_video_pool.clear();
+    m_free_video_frames.clear();
+    for (size_t i = 0; i < pool_frames; ++i)
+    {
+        m_video_pool.push_back(std::make_unique_for_overwrite<uint8_t[]>(m_frame_size));
+        m_free_video_frames.push_back(m_video_pool.back().get());
+    }
+
+    g_view_logger->info("[FFmpegEncoder] Video pool: {} frames of {} bytes", pool_frames, m_frame_size);
 
+    m_pipe_failed = false;
+
+    // The writer threads wait for ffmpeg to connect to their pipe before writing anything
     m_video_thread = std::thread(&FFmpegEncoder::write_video_thread, this);
     m_audio_thread = std::thread(&FFmpegEncoder::write_audio_thread, this);
 
-    Sleep(500);
-
     return L"";
 }
 
 bool FFmpegEncoder::stop()
 {
+    // The last frame's timestamp only says when it starts, so a trailing run of duplicates needs one more frame to keep the video as long as the audio
+    if (m_tail_pending)
+    {
+        queue_frame(m_tail_frame.get(), m_tail_index);
+        m_tail_pending = false;
+    }
+
+    {
+        std::unique_lock lock(m_video_queue_mutex);
+        m_free_video_cv.wait_for(lock, STALL_TIMEOUT, [this] { return m_video_queue.empty() || m_pipe_failed; });
+    }
+
     m_stop_thread = true;
     m_video_cv.notify_all();
+    m_free_video_cv.notify_all();
     m_audio_cv.notify_all();
+    m_free_audio_cv.notify_all();
 
     // HACK: Give it some time to maybe accept the last writes...
     Sleep(500);
@@ -119,19 +441,37 @@ bool FFmpegEncoder::stop()
     WaitForSingleObject(m_pi.hProcess, INFINITE);
     CloseHandle(m_pi.hProcess);
     CloseHandle(m_pi.hThread);
+
+    // If ffmpeg exited without opening a pipe, its writer thread is still waiting for the connection
+    CancelSynchronousIo(m_audio_thread.native_handle());
+    CancelSynchronousIo(m_video_thread.native_handle());
     m_audio_thread.join();
     m_video_thread.join();
 
-    if (!this->m_video_queue.empty() || !this->m_audio_queue.empty())
+    const auto remaining_audio = m_audio_write_pos - m_audio_read_pos;
+    if (!this->m_video_queue.empty() || remaining_audio != 0)
     {
-        DialogService::show_dialog(std::format(L"Capture stopped with {} video, {} audio elements remaining in queue!\nThe capture might be corrupted.", this->m_video_queue.size(), this->m_audio_queue.size()).c_str(), L"FFmpeg");
+        DialogService::show_dialog(std::format(L"Capture stopped with {} video frames, {} audio bytes remaining in queue!\nThe capture might be corrupted.", this->m_video_queue.size(), remaining_audio).c_str(), L"FFmpeg");
+    }
+
+    g_view_logger->info("[FFmpegEncoder] Video queue peak: {}/{}, {} stalls, {} dropped frames", m_video_queue_peak, m_video_pool.size(), m_stalls, m_dropped_frames);
+    g_view_logger->info("[FFmpegEncoder] Audio: {} stalls, {} dropped bytes", m_audio_stalls, m_dropped_audio_bytes);
+    if (m_vfr)
+    {
+        g_view_logger->info("[FFmpegEncoder] {} of {} frames were duplicates and weren't sent", m_duplicate_frames, m_video_frame_index);
     }
 
     if (m_dropped_frames > 0)
     {
-        DialogService::show_dialog(std::format(L"{} frames were dropped during capture to avoid out-of-memory errors.\nThe capture might contain empty frames.", m_dropped_frames).c_str(), L"FFmpeg");
+        DialogService::show_dialog(std::format(L"{} frames were dropped during capture because encoding couldn't keep up.\nThe capture contains empty frames in their place.", m_dropped_frames).c_str(), L"FFmpeg");
     }
 
+    m_video_queue = {};
+    m_free_video_frames.clear();
+    m_video_pool.clear();
+    m_audio_ring.reset();
+    m_resampler.reset();
+    m_tail_frame.reset();
     free(m_silence_buffer);
     free(m_blank_buffer);
     return true;
@@ -150,20 +490,60 @@ static bool write_pipe_checked(const HANDLE pipe, const char* buffer, const unsi
     return true;
 }
 
-bool FFmpegEncoder::append_audio_impl(uint8_t* audio, size_t length)
+/**
+ * \brief Waits for ffmpeg to open a pipe.
+ * \return Whether the pipe is connected
+ */
+static bool connect_pipe(const HANDLE pipe, const bool is_video)
 {
-    uint8_t* buf = m_silence_buffer;
-    if (audio != m_silence_buffer)
+    if (ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED)
     {
-        buf = static_cast<uint8_t*>(malloc(length));
-        memcpy(buf, audio, length);
+        return true;
+    }
+    g_view_logger->error("[FFmpegEncoder] Failed to connect {} pipe, error code {}", is_video ? "video" : "audio", GetLastError());
+    return false;
+}
+
+bool FFmpegEncoder::append_audio_impl(const uint8_t* audio, size_t length)
+{
+    if (m_pipe_failed)
+    {
+        return false;
     }
 
     m_last_write_was_video = false;
 
     {
-        std::lock_guard lock(m_audio_queue_mutex);
-        this->m_audio_queue.emplace(buf, length);
+        std::unique_lock lock(m_audio_queue_mutex);
+
+        const auto has_space = [&] {
+            return m_audio_ring_size - (m_audio_write_pos - m_audio_read_pos) >= length;
+        };
+
+        // Like with video, emulation is held back while ffmpeg catches up
+        if (!has_space() && !m_audio_timed_out)
+        {
+            ++m_audio_stalls;
+            if (!m_free_audio_cv.wait_for(lock, STALL_TIMEOUT, [&] { return has_space() || m_stop_thread || m_pipe_failed; }))
+            {
+                g_view_logger->warn("[FFmpegEncoder] Timed out waiting for audio space, dropping audio until ffmpeg catches up");
+                m_audio_timed_out = true;
+            }
+        }
+
+        if (!has_space())
+        {
+            m_dropped_audio_bytes += length;
+            return true;
+        }
+        m_audio_timed_out = false;
+
+        // The producer only writes to the free part of the ring, so the writer thread can read the queued part without holding the lock
+        const size_t pos = m_audio_write_pos % m_audio_ring_size;
+        const size_t first = std::min(length, m_audio_ring_size - pos);
+        memcpy(m_audio_ring.get() + pos, audio, first);
+        memcpy(m_audio_ring.get(), audio + first, length - first);
+        m_audio_write_pos += length;
     }
     m_audio_cv.notify_one();
 
@@ -172,6 +552,11 @@ bool FFmpegEncoder::append_audio_impl(uint8_t* audio, size_t length)
 
 bool FFmpegEncoder::append_video(uint8_t* image)
 {
+    if (m_pipe_failed)
+    {
+        return false;
+    }
+
     if (g_config.synchronization_mode == 1)
     {
         if (m_last_write_was_video)
@@ -190,28 +575,82 @@ bool FFmpegEncoder::append_video(uint8_t* image)
 
     m_last_write_was_video = true;
 
-    auto buf = static_cast<uint8_t*>(malloc(m_params.width * m_params.height * 3));
+    // The frame index advances for duplicates as well, so every unique frame keeps the timestamp it would have at a constant frame rate
+    const size_t index = m_video_frame_index++;
 
-    // HACK: If we run out of memory, we start writing empty video frames
-    // This can happen when encoding at high resolutions, as ffmpeg might not start processing the pipe writes in time
-    if (!buf)
+    if (m_vfr)
     {
-        g_view_logger->error("[FFmpegEncoder] Out of memory, writing blank video frame");
-        ++m_dropped_frames;
-
+        const auto hash = hash_frame(image, (size_t)m_params.width * m_params.height * 3);
+        if (m_has_last_hash && hash == m_last_hash)
         {
+            if (!m_tail_pending)
+            {
+                memcpy(m_tail_frame.get(), image, (size_t)m_params.width * m_params.height * 3);
+                m_tail_pending = true;
+            }
+            m_tail_index = index;
+
             std::lock_guard lock(m_video_queue_mutex);
-            m_video_queue.emplace(m_blank_buffer, false);
+            ++m_duplicate_frames;
+            return true;
         }
-        m_video_cv.notify_one();
-        return true;
+        m_last_hash = hash;
+        m_has_last_hash = true;
+        m_tail_pending = false;
     }
 
-    memcpy(buf, image, m_params.width * m_params.height * 3);
+    return queue_frame(image, index);
+}
+
+bool FFmpegEncoder::queue_frame(uint8_t* image, size_t index)
+{
+    uint8_t* buf;
+    {
+        std::unique_lock lock(m_video_queue_mutex);
+
+        // When all frames are queued, ffmpeg has fallen behind. We hold emulation back until a frame is written instead of letting the queue grow.
+        // A stuck ffmpeg would stall every frame, so we stop waiting after the first timeout until a frame is freed again.
+        if (m_free_video_frames.empty() && !m_drop_on_overflow && !m_video_timed_out)
+        {
+            ++m_stalls;
+            if (!m_free_video_cv.wait_for(lock, STALL_TIMEOUT, [this] { return !m_free_video_frames.empty() || m_stop_thread || m_pipe_failed; }))
+            {
+                g_view_logger->warn("[FFmpegEncoder] Timed out waiting for a free video frame, dropping frames until ffmpeg catches up");
+                m_video_timed_out = true;
+            }
+        }
+
+        // Dropped frames are replaced by blank ones, which don't need a frame from the pool, to keep the video in sync with the audio
+        if (m_free_video_frames.empty())
+        {
+            ++m_dropped_frames;
+            m_has_last_hash = false;
+            m_video_queue.push({m_blank_buffer, index});
+            m_video_queue_peak = std::max(m_video_queue_peak, m_video_queue.size());
+            lock.unlock();
+
+            m_video_cv.notify_one();
+            return true;
+        }
+
+        m_video_timed_out = false;
+        buf = m_free_video_frames.back();
+        m_free_video_frames.pop_back();
+    }
+
+    if (m_pixel_format == PIXEL_FORMAT_BGR24)
+    {
+        memcpy(buf, image, m_frame_size);
+    }
+    else
+    {
+        yuv_from_bgr24(image, buf, m_params.width, m_params.height, m_pixel_format == PIXEL_FORMAT_NV12);
+    }
 
     {
         std::lock_guard lock(m_video_queue_mutex);
-        m_video_queue.emplace(buf, true);
+        m_video_queue.push({buf, index});
+        m_video_queue_peak = std::max(m_video_queue_peak, m_video_queue.size());
     }
     m_video_cv.notify_one();
 
@@ -220,36 +659,45 @@ bool FFmpegEncoder::append_video(uint8_t* image)
 
 bool FFmpegEncoder::append_audio(uint8_t* audio, size_t length, uint8_t)
 {
-    auto buf = static_cast<uint8_t*>(malloc(length));
-    memcpy(buf, audio, length);
+    const auto resampled = m_resampler->process(audio, length);
+    return append_audio_impl(resampled.data(), resampled.size());
+}
 
-    return append_audio_impl(buf, length);
+void FFmpegEncoder::set_audio_rate(uint32_t arate)
+{
+    m_resampler->set_src_freq(arate);
 }
 
 void FFmpegEncoder::write_audio_thread()
 {
     g_view_logger->trace("[FFmpegEncoder] Audio thread ready");
 
+    if (!connect_pipe(m_audio_pipe, false))
+    {
+        m_pipe_failed = true;
+        m_free_audio_cv.notify_all();
+        return;
+    }
+
     while (!this->m_stop_thread)
     {
         std::unique_lock lock(m_audio_queue_mutex);
-        m_audio_cv.wait(lock, [this] { return !m_audio_queue.empty() || m_stop_thread; });
+        m_audio_cv.wait(lock, [this] { return m_audio_write_pos != m_audio_read_pos || m_stop_thread; });
 
-        if (this->m_audio_queue.empty())
+        if (m_audio_write_pos == m_audio_read_pos)
             continue;
 
-        auto tuple = this->m_audio_queue.front();
-        this->m_audio_queue.pop();
+        // Only the part up to the end of the ring is written at once, the wrapped-around part follows in the next iteration
+        const size_t pos = m_audio_read_pos % m_audio_ring_size;
+        const size_t len = std::min(m_audio_write_pos - m_audio_read_pos, m_audio_ring_size - pos);
         lock.unlock();
 
-        const auto buf = std::get<0>(tuple);
-        const auto len = std::get<1>(tuple);
+        write_pipe_checked(m_audio_pipe, (char*)m_audio_ring.get() + pos, (unsigned)len, false);
 
-        write_pipe_checked(m_audio_pipe, (char*)buf, len, false);
-        if (buf != m_silence_buffer)
-        {
-            free(buf);
-        }
+        lock.lock();
+        m_audio_read_pos += len;
+        lock.unlock();
+        m_free_audio_cv.notify_one();
     }
 }
 
@@ -257,6 +705,28 @@ void FFmpegEncoder::write_video_thread()
 {
     g_view_logger->trace("[FFmpegEncoder] Video thread ready");
 
+    if (!connect_pipe(m_video_pipe, true))
+    {
+        m_pipe_failed = true;
+        m_free_video_cv.notify_all();
+        return;
+    }
+
+    std::vector<uint8_t> frame_header;
+    if (m_vfr)
+    {
+        // Without the header, ffmpeg can't make sense of anything that follows, so the capture can't continue
+        const auto fourcc = m_pixel_format == PIXEL_FORMAT_NV12 ? "NV12" : m_pixel_format == PIXEL_FORMAT_YUV420P ? "I420" : "BGR\x18";
+        const auto header = Mkv::make_header(m_params.width, m_params.height, fourcc);
+        if (!write_pipe_checked(m_video_pipe, (const char*)header.data(), (unsigned)header.size(), true))
+        {
+            g_view_logger->error("[FFmpegEncoder] Failed to write the Matroska header, error code {}", GetLastError());
+            m_pipe_failed = true;
+            m_free_video_cv.notify_all();
+            return;
+        }
+    }
+
     while (!this->m_stop_thread)
     {
         std::unique_lock lock(m_video_queue_mutex);
@@ -265,14 +735,42 @@ void FFmpegEncoder::write_video_thread()
         if (m_video_queue.empty())
             continue;
 
-        auto pair = this->m_video_queue.front();
+        const auto [buf, index] = this->m_video_queue.front();
         this->m_video_queue.pop();
         lock.unlock();
 
-        write_pipe_checked(m_video_pipe, (char*)pair.first, m_params.width * m_params.height * 3, true);
-        if (pair.second)
+        if (m_vfr)
+        {
+            Mkv::make_frame_header(frame_header, index * 1'000'000 / m_params.fps, m_frame_size);
+            write_pipe_checked(m_video_pipe, (const char*)frame_header.data(), (unsigned)frame_header.size(), true);
+        }
+
+        write_pipe_checked(m_video_pipe, (char*)buf, (unsigned)m_frame_size, true);
+        if (buf != m_blank_buffer)
         {
-            free(pair.first);
+            lock.lock();
+            m_free_video_frames.push_back(buf);
+            lock.unlock();
         }
+        m_free_video_cv.notify_all();
+    }
+}
+
+Encoder::Stats FFmpegEncoder::get_stats()
+{
+    Stats stats{};
+    {
+        std::lock_guard lock(m_video_queue_mutex);
+        stats.video_queue_depth = m_video_queue.size();
+        stats.video_queue_capacity = m_video_pool.size();
+        stats.video_queue_peak = m_video_queue_peak;
+        stats.dropped_frames = m_dropped_frames;
+        stats.stalls = m_stalls;
+        stats.duplicate_frames = m_duplicate_frames;
+    }
+    {
+        std::lock_guard lock(m_audio_queue_mutex);
+        stats.audio_queue_depth = m_audio_write_pos - m_audio_read_pos;
     }
+    return stats;
 }
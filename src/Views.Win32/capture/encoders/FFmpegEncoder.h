@@ -7,6 +7,7 @@
 #pragma once
 
 #include "Encoder.h"
+#include <capture/Resampler.h>
 
 
 class FFmpegEncoder : public Encoder {
@@ -15,9 +16,24 @@ public:
     bool stop() override;
     bool append_video(uint8_t* image) override;
     bool append_audio(uint8_t* audio, size_t length, uint8_t bitrate) override;
+    void set_audio_rate(uint32_t arate) override;
+    Stats get_stats() override;
 
 private:
-    bool append_audio_impl(uint8_t* audio, size_t length);
+    // The memory budget of the video frame pool, which bounds how far encoding can fall behind emulation
+    static constexpr size_t VIDEO_POOL_BYTES = 256 * 1024 * 1024;
+    static constexpr size_t MIN_VIDEO_POOL_FRAMES = 4;
+    static constexpr size_t MAX_VIDEO_POOL_FRAMES = 64;
+
+    // How long emulation is stalled waiting for a free video frame or audio space before the data is dropped, which keeps a stuck ffmpeg process from hanging emulation.
+    // After a timeout, data is dropped without waiting until ffmpeg frees up space again.
+    static constexpr auto STALL_TIMEOUT = std::chrono::seconds(5);
+
+    // The length of the audio ring buffer in seconds of audio
+    static constexpr size_t AUDIO_RING_SECONDS = 4;
+
+    bool append_audio_impl(const uint8_t* audio, size_t length);
+    bool queue_frame(uint8_t* image, size_t index);
     void write_video_thread();
     void write_audio_thread();
 
@@ -30,18 +46,56 @@ private:
 
     uint8_t* m_silence_buffer{};
     uint8_t* m_blank_buffer{};
-    size_t m_dropped_frames = 0;
+    size_t m_frame_size = 0;
+    cfg_pixel_format m_pixel_format = PIXEL_FORMAT_BGR24;
+    bool m_drop_on_overflow = false;
 
     bool m_stop_thread = false;
+
+    // Set by the writer threads when a pipe couldn't be connected or the stream header couldn't be written, which makes the capture fail
+    std::atomic<bool> m_pipe_failed = false;
     bool m_last_write_was_video = false;
 
+    // Converts the audio to the rate ffmpeg was started with, which keeps the capture going when the game changes its audio rate
+    std::unique_ptr<Resampler> m_resampler;
+
+    // The audio waiting to be written is stored in a ring buffer. The positions only ever increase and are wrapped when accessing the buffer.
     std::thread m_audio_thread;
     std::mutex m_audio_queue_mutex{};
     std::condition_variable m_audio_cv{};
-    std::queue<std::tuple<uint8_t*, size_t>> m_audio_queue;
+    std::condition_variable m_free_audio_cv{};
+    std::unique_ptr<uint8_t[]> m_audio_ring;
+    size_t m_audio_ring_size = 0;
+    size_t m_audio_read_pos = 0;
+    size_t m_audio_write_pos = 0;
+    size_t m_audio_stalls = 0;
+    size_t m_dropped_audio_bytes = 0;
+    bool m_audio_timed_out = false;
 
     std::thread m_video_thread;
     std::mutex m_video_queue_mutex{};
     std::condition_variable m_video_cv{};
-    std::queue<std::pair<uint8_t*, bool>> m_video_queue;
+    // The queued frames and their indices, from which their timestamps are derived when capturing with a variable frame rate
+    std::queue<std::pair<uint8_t*, size_t>> m_video_queue;
+
+    // The video frames are recycled through the free list, so the queue never holds more frames than the pool has
+    std::vector<std::unique_ptr<uint8_t[]>> m_video_pool;
+    std::vector<uint8_t*> m_free_video_frames;
+    std::condition_variable m_free_video_cv{};
+    size_t m_video_queue_peak = 0;
+    size_t m_dropped_frames = 0;
+    size_t m_stalls = 0;
+    bool m_video_timed_out = false;
+
+    // Duplicate frame elimination. Frames identical to the previous one aren't sent, and the previous frame is shown until the next differing one.
+    bool m_vfr = false;
+    size_t m_video_frame_index = 0;
+    size_t m_duplicate_frames = 0;
+    uint64_t m_last_hash = 0;
+    bool m_has_last_hash = false;
+
+    // A copy of the frame repeated by the current run of duplicates, which is sent at the end of the capture if the run is still going
+    std::unique_ptr<uint8_t[]> m_tail_frame;
+    size_t m_tail_index = 0;
+    bool m_tail_pending = false;
 };
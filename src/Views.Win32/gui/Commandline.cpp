@@ -32,6 +32,45 @@ namespace Cli
     static size_t dacrate_change_count = 0;
     static bool first_emu_launched = true;
 
+    // Segmented capture coordinator (--segments): plays the movie without capturing, saves states at the segment boundaries and launches one worker per segment.
+    // The boundaries are only targets, since states are saved asynchronously. A worker is launched once the state ending its segment is saved, and ends at that state's actual sample.
+    static size_t commandline_segments;
+    static std::vector<int32_t> segment_boundaries;
+    static size_t next_segment_boundary;
+    static std::vector<HANDLE> segment_processes;
+
+    // Segmented capture worker (--segment-st, --segment-end): captures the part of the movie between its boundary state and the end sample
+    static std::filesystem::path commandline_segment_st;
+    static int32_t commandline_segment_end = -1;
+    static bool segment_finished;
+
+    /**
+     * \brief Parses the value of an integer option.
+     * \param str The option's value.
+     * \param min The smallest valid value.
+     * \return The value, or nothing if it isn't a number within the valid range.
+     */
+    static std::optional<int32_t> parse_int_option(const std::string& str, const int32_t min)
+    {
+        int32_t value;
+        const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (ec != std::errc() || end != str.data() + str.size() || value < min)
+        {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    static bool is_segment_coordinator()
+    {
+        return commandline_segments > 1;
+    }
+
+    static bool is_segment_worker()
+    {
+        return !commandline_segment_st.empty() || commandline_segment_end >= 0;
+    }
+
     static void start_rom()
     {
         if (commandline_rom.empty())
@@ -96,16 +135,287 @@ namespace Cli
 
     static void start_capture()
     {
-        if (commandline_avi.empty())
+        if (commandline_avi.empty() || is_segment_coordinator())
         {
             return;
         }
 
+        // Segment workers jump to their boundary first, so the capture only contains their part of the movie
+        if (!commandline_segment_st.empty())
+        {
+            g_view_logger->info(L"[CLI] Loading segment state {}...", commandline_segment_st.wstring());
+            core_st_do_file(commandline_segment_st, core_st_job_load, [](const core_result result, const auto&) {
+                if (result != Res_Ok)
+                {
+                    show_error_dialog_for_result(result);
+                    PostMessage(g_main_hwnd, WM_CLOSE, 0, 0);
+                    return;
+                }
+                EncodingManager::start_capture(commandline_avi.string().c_str(), static_cast<cfg_encoder_type>(g_config.encoder_type), false);
+            },
+                            true);
+            return;
+        }
+
         EncodingManager::start_capture(commandline_avi.string().c_str(), static_cast<cfg_encoder_type>(g_config.encoder_type), false);
     }
 
+    /**
+     * \brief Gets the path a capture started at the specified path ends up at, since the FFmpeg encoder always writes mp4 files.
+     */
+    static std::filesystem::path get_capture_path(std::filesystem::path path)
+    {
+        if (g_config.encoder_type == ENCODER_FFMPEG)
+        {
+            path.replace_extension(".mp4");
+        }
+        return path;
+    }
+
+    static std::filesystem::path get_segment_path(const size_t index, const wchar_t* extension)
+    {
+        auto path = commandline_avi;
+        path.replace_filename(std::format(L"{}.seg{}{}", commandline_avi.stem().wstring(), index, extension));
+        return path;
+    }
+
+    static std::filesystem::path get_segment_st_path(const size_t index)
+    {
+        return get_segment_path(index, L".st");
+    }
+
+    static std::filesystem::path get_segment_capture_path(const size_t index)
+    {
+        return get_capture_path(get_segment_path(index, commandline_avi.extension().c_str()));
+    }
+
+    /**
+     * \brief Launches the worker process which captures the specified segment.
+     * \param index The segment's index.
+     * \param end The sample at which the worker stops capturing.
+     */
+    static bool launch_segment_worker(const size_t index, const int32_t end)
+    {
+        wchar_t exe_path[MAX_PATH]{};
+        GetModuleFileName(nullptr, exe_path, std::size(exe_path));
+
+        std::wstring args = std::format(L"\"{}\" --rom \"{}\" --avi \"{}\"", exe_path, commandline_rom.wstring(), get_segment_path(index, commandline_avi.extension().c_str()).wstring());
+        if (!commandline_movie.empty())
+        {
+            args += std::format(L" --movie \"{}\"", commandline_movie.wstring());
+        }
+        if (!commandline_lua.empty())
+        {
+            args += std::format(L" --lua \"{}\"", commandline_lua.wstring());
+        }
+        if (index > 0)
+        {
+            args += std::format(L" --segment-st \"{}\"", get_segment_st_path(index).wstring());
+        }
+        // The movie's end also closes the worker, in case the last sample is never reported
+        args += std::format(L" --segment-end {} --close-on-movie-end", end);
+
+        g_view_logger->info(L"[CLI] Launching segment worker {}: {}", index, args);
+
+        // The workers run minimized and without taking focus, since they're only there to capture
+        STARTUPINFO si{};
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESHOWWINDOW;
+        si.wShowWindow = SW_SHOWMINNOACTIVE;
+        PROCESS_INFORMATION pi{};
+
+        if (!CreateProcess(exe_path, args.data(), nullptr, nullptr, FALSE, NULL, nullptr, nullptr, &si, &pi))
+        {
+            g_view_logger->error("[CLI] CreateProcess failed for segment worker {} ({})", index, GetLastError());
+            return false;
+        }
+
+        CloseHandle(pi.hThread);
+        segment_processes.push_back(pi.hProcess);
+        return true;
+    }
+
+    /**
+     * \brief Losslessly concatenates the segment captures into the final capture with ffmpeg's concat demuxer.
+     */
+    static bool stitch_segments()
+    {
+        std::string list;
+        for (size_t i = 0; i < commandline_segments; ++i)
+        {
+            // The concat demuxer's paths are single-quoted, so quotes inside them are closed, escaped and reopened
+            auto path = get_segment_capture_path(i).string();
+            for (size_t pos = path.find('\''); pos != std::string::npos; pos = path.find('\'', pos + 4))
+            {
+                path.replace(pos, 1, "'\\''");
+            }
+            list += std::format("file '{}'\n", path);
+        }
+
+        const auto list_path = std::filesystem::path(commandline_avi).replace_extension(L".segments.txt");
+        FILE* f = _wfopen(list_path.c_str(), L"wb");
+        if (!f)
+        {
+            g_view_logger->error("[CLI] Failed to write the segment list");
+            return false;
+        }
+        fwrite(list.data(), 1, list.size(), f);
+        fclose(f);
+
+        std::wstring args = std::format(L"\"{}\" -y -f concat -safe 0 -i \"{}\" -c copy \"{}\"", g_config.ffmpeg_path, list_path.wstring(), get_capture_path(commandline_avi).wstring());
+        g_view_logger->info(L"[CLI] Stitching segments: {}", args);
+
+        STARTUPINFO si{};
+        si.cb = sizeof(si);
+        PROCESS_INFORMATION pi{};
+        if (!CreateProcess(g_config.ffmpeg_path.c_str(), args.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi))
+        {
+            g_view_logger->error("[CLI] CreateProcess failed for ffmpeg ({})", GetLastError());
+            return false;
+        }
+
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        DWORD exit_code = 1;
+        GetExitCodeProcess(pi.hProcess, &exit_code);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+
+        if (exit_code != 0)
+        {
+            g_view_logger->error("[CLI] ffmpeg exited with code {} while stitching", exit_code);
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(list_path, ec);
+        for (size_t i = 0; i < commandline_segments; ++i)
+        {
+            std::filesystem::remove(get_segment_capture_path(i), ec);
+            std::filesystem::remove(get_segment_st_path(i), ec);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Waits for all segment workers to exit, stitches their captures and closes the coordinator.
+     */
+    static void finish_segments()
+    {
+        std::thread([] {
+            WaitForMultipleObjects((DWORD)segment_processes.size(), segment_processes.data(), TRUE, INFINITE);
+            for (const auto process : segment_processes)
+            {
+                CloseHandle(process);
+            }
+
+            for (size_t i = 0; i < commandline_segments; ++i)
+            {
+                if (!std::filesystem::exists(get_segment_capture_path(i)))
+                {
+                    DialogService::show_dialog(std::format(L"Segment {} wasn't captured.\nThe segments can't be stitched.", i).c_str(), L"CLI", fsvc_error);
+                    return;
+                }
+            }
+
+            if (!stitch_segments())
+            {
+                DialogService::show_dialog(L"Failed to stitch the segments with ffmpeg.\nThe segment captures were kept.", L"CLI", fsvc_error);
+                return;
+            }
+
+            g_view_logger->info(L"[CLI] Segmented capture finished at {}", get_capture_path(commandline_avi).wstring());
+            PostMessage(g_main_hwnd, WM_CLOSE, 0, 0);
+        }).detach();
+    }
+
+    static void on_segment_boundary_reached(const size_t index)
+    {
+        const auto st_path = get_segment_st_path(index);
+        g_view_logger->info(L"[CLI] Saving segment state {}...", st_path.wstring());
+
+        core_st_do_file(st_path, core_st_job_save, [=](const core_result result, const auto&) {
+            if (result != Res_Ok)
+            {
+                show_error_dialog_for_result(result);
+                return;
+            }
+
+            // The callback runs right after the state is saved, so the current sample is exactly where the next segment starts
+            std::pair<size_t, size_t> pair = {0, 0};
+            core_vcr_get_seek_completion(pair);
+            const auto sample = static_cast<int32_t>(pair.first);
+            g_view_logger->info("[CLI] Segment state {} saved at sample {} (target {})", index, sample, segment_boundaries[index - 1]);
+
+            if (!launch_segment_worker(index - 1, sample))
+            {
+                DialogService::show_dialog(std::format(L"Failed to launch the worker for segment {}.", index - 1).c_str(), L"CLI", fsvc_error);
+                return;
+            }
+
+            // The coordinator's job is done once the last worker is running
+            if (index == commandline_segments - 1)
+            {
+                if (!launch_segment_worker(index, static_cast<int32_t>(core_vcr_get_length_samples())))
+                {
+                    DialogService::show_dialog(std::format(L"Failed to launch the worker for segment {}.", index).c_str(), L"CLI", fsvc_error);
+                    return;
+                }
+                core_vr_pause_emu();
+                finish_segments();
+            }
+        },
+                        true);
+    }
+
+    static void on_current_sample_changed(const int32_t value)
+    {
+        if (!task_is_playback(core_vcr_get_task()))
+        {
+            return;
+        }
+
+        if (is_segment_worker() && !segment_finished && commandline_segment_end >= 0 && value >= commandline_segment_end)
+        {
+            g_view_logger->info("[CLI] Segment end {} reached", commandline_segment_end);
+            segment_finished = true;
+            EncodingManager::stop_capture([](auto result) {
+                if (!result)
+                    return;
+                PostMessage(g_main_hwnd, WM_CLOSE, 0, 0);
+            });
+            return;
+        }
+
+        if (!is_segment_coordinator())
+        {
+            return;
+        }
+
+        if (segment_boundaries.empty())
+        {
+            // The segments are of equal length in samples. The first one doesn't need a state, but its worker still waits for the state ending it.
+            const auto length = core_vcr_get_length_samples();
+            for (size_t i = 1; i < commandline_segments; ++i)
+            {
+                segment_boundaries.push_back((int32_t)(length * i / commandline_segments));
+            }
+        }
+
+        if (next_segment_boundary < segment_boundaries.size() && value >= segment_boundaries[next_segment_boundary])
+        {
+            ++next_segment_boundary;
+            on_segment_boundary_reached(next_segment_boundary);
+        }
+    }
+
     static void on_movie_playback_stop()
     {
+        // The coordinator closes itself once the segments are stitched
+        if (is_segment_coordinator())
+        {
+            return;
+        }
+
         if (commandline_close_on_movie_end)
         {
             EncodingManager::stop_capture([](auto result) {
@@ -183,6 +493,7 @@ namespace Cli
         Messenger::subscribe(Messenger::Message::AppReady, on_app_ready);
         Messenger::subscribe(Messenger::Message::TaskChanged, on_task_changed);
         Messenger::subscribe(Messenger::Message::DacrateChanged, on_dacrate_changed);
+        Messenger::subscribe<Messenger::Message::CurrentSampleChanged>(on_current_sample_changed);
 
         argh::parser cmdl(__argc, __argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
 
@@ -192,6 +503,7 @@ namespace Cli
         commandline_movie = cmdl({"--movie", "-m64"}, "").str();
         commandline_avi = cmdl({"--avi", "-avi"}, "").str();
         commandline_close_on_movie_end = cmdl["--close-on-movie-end"];
+        commandline_segment_st = cmdl({"--segment-st"}, "").str();
         bool compare_control = cmdl["--cmp-ctl"] || cmdl["--compare-control"];
         bool compare_actual = cmdl["--cmp-act"] || cmdl["--compare-actual"];
         std::string compare_interval_str = cmdl({"--cmp-int", "--compare-interval"}, "100").str();
@@ -217,6 +529,43 @@ namespace Cli
             commandline_st.clear();
         }
 
+        if (const auto segments = parse_int_option(cmdl({"--segments"}, "0").str(), 0))
+        {
+            commandline_segments = *segments;
+        }
+        else
+        {
+            DialogService::show_dialog(L"The --segments option must be a non-negative number.\nThe capture won't be segmented.", L"CLI", fsvc_warning);
+        }
+
+        if (const auto segment_end = parse_int_option(cmdl({"--segment-end"}, "-1").str(), -1))
+        {
+            commandline_segment_end = *segment_end;
+        }
+        else
+        {
+            DialogService::show_dialog(L"The --segment-end option must be a non-negative sample.\nThe segment will be captured until the movie ends.", L"CLI", fsvc_warning);
+        }
+
+        if (is_segment_coordinator())
+        {
+            const bool has_movie = !commandline_movie.empty() || commandline_rom.extension() == ".m64";
+            if (commandline_avi.empty() || !has_movie)
+            {
+                DialogService::show_dialog(L"The --segments option requires a movie and the -avi option.\nThe capture won't be segmented.", L"CLI", fsvc_warning);
+                commandline_segments = 0;
+            }
+            else if (g_config.ffmpeg_path.empty() || !std::filesystem::exists(g_config.ffmpeg_path))
+            {
+                DialogService::show_dialog(L"Stitching the segments requires ffmpeg, which wasn't found at the configured path.\nThe capture won't be segmented.", L"CLI", fsvc_warning);
+                commandline_segments = 0;
+            }
+            else
+            {
+                commandline_segments = std::min(commandline_segments, (size_t)MAXIMUM_WAIT_OBJECTS);
+            }
+        }
+
         if (commandline_close_on_movie_end && g_config.core.is_movie_loop_enabled)
         {
             DialogService::show_dialog(L"Movie loop is not allowed when closing on movie end is enabled.\nThe movie loop option will be disabled.", L"CLI",
@@ -262,10 +611,51 @@ namespace Cli
         g_view_logger->trace("[CLI] commandline_movie: {}", commandline_movie.string());
         g_view_logger->trace("[CLI] commandline_avi: {}", commandline_avi.string());
         g_view_logger->trace("[CLI] commandline_close_on_movie_end: {}", commandline_close_on_movie_end);
+        g_view_logger->trace("[CLI] commandline_segments: {}", commandline_segments);
+        g_view_logger->trace("[CLI] commandline_segment_st: {}", commandline_segment_st.string());
+        g_view_logger->trace("[CLI] commandline_segment_end: {}", commandline_segment_end);
+    }
+
+    bool run_tools()
+    {
+        argh::parser cmdl(__argc, __argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+
+        const std::filesystem::path capture_path = cmdl({"--decode-trace"}, "").str();
+        if (capture_path.empty())
+        {
+            return false;
+        }
+
+        std::filesystem::path out_path = cmdl({"--decode-out"}, "").str();
+        if (out_path.empty())
+        {
+            out_path = capture_path;
+            out_path.replace_extension(".log");
+        }
+
+        const auto format = cmdl["--decode-binary"] ? core_tl_format_binary : core_tl_format_text;
+
+        // 0 lets the decoder pick the amount of threads
+        const auto threads = parse_int_option(cmdl({"--decode-threads"}, "0").str(), 0);
+        if (!threads.has_value())
+        {
+            DialogService::show_dialog(L"The --decode-threads option must be a non-negative number.", L"CLI", fsvc_error);
+            return true;
+        }
+
+        g_view_logger->info(L"[CLI] Decoding trace capture {} to {}...", capture_path.wstring(), out_path.wstring());
+        const auto result = core_tl_decode(capture_path, out_path, format, *threads);
+        show_error_dialog_for_result(result);
+        return true;
     }
 
     bool wants_fast_forward()
     {
         return !commandline_avi.empty();
     }
+
+    bool wants_config_save()
+    {
+        return !is_segment_worker();
+    }
 } // namespace Cli
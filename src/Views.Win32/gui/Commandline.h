@@ -13,8 +13,19 @@ namespace Cli
      */
     void init();
 
+    /**
+     * \brief Runs the commandline tools which don't need the main window, such as the trace capture decoder.
+     * \return Whether a tool was run, in which case the application should exit.
+     */
+    bool run_tools();
+
     /**
      * Gets whether the CLI wants fast-forward to always be enabled.
      */
     bool wants_fast_forward();
+
+    /**
+     * Gets whether the config should be saved when the application exits. Segment worker processes don't save it, since they run alongside the main instance.
+     */
+    bool wants_config_save();
 } // namespace Cli
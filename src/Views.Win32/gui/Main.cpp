@@ -12,6 +12,7 @@
 #include <Plugin.h>
 #include <strsafe.h>
 #include <capture/EncodingManager.h>
+#include <capture/YUVConverter.h>
 #include <gui/Commandline.h>
 #include <gui/Loggers.h>
 #include <gui/Main.h>
@@ -33,6 +34,7 @@
 #include <gui/wrapper/PersistentPathDialog.h>
 #include <lua/LuaConsole.h>
 #include <lua/LuaCallbacks.h>
+#include <lua/LuaRegistry.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
 // Throwaway actions which can be spammed get keys as to not clog up the async executor queue
@@ -347,6 +349,34 @@ bool show_error_dialog_for_result(const core_result result, void* hwnd)
         module = L"Core";
         error = L"Failed to open streams to core files.\r\nVerify that Mupen is allowed disk access.";
         break;
+#pragma endregion
+#pragma region Tracelog
+    case TL_BadFile:
+        module = L"Trace Logger";
+        error = L"The trace capture is inaccessible or does not exist.";
+        break;
+    case TL_InvalidFormat:
+        module = L"Trace Logger";
+        error = L"The trace capture or the requested output format is invalid.";
+        break;
+    case TL_FileWriteError:
+        module = L"Trace Logger";
+        error = L"The decoded trace log couldn't be written to disk.";
+        break;
+#pragma endregion
+#pragma region Input Search
+    case BF_AlreadyRunning:
+        module = L"Input Search";
+        error = L"Another input search is already running.";
+        break;
+    case BF_InvalidParameters:
+        module = L"Input Search";
+        error = L"The input search parameters are invalid.";
+        break;
+    case BF_MovieActive:
+        module = L"Input Search";
+        error = L"Input searches can't be performed while a movie is active.";
+        break;
 #pragma endregion
     default:
         module = L"Unknown";
@@ -599,26 +629,6 @@ void update_titlebar()
     SetWindowText(g_main_hwnd, text.c_str());
 }
 
-/**
- * \brief Computes the average rate of entries in the time queue per second (e.g.: FPS from frame deltas)
- * \param times A circular buffer of deltas
- * \return The average rate per second from the delta in the queue
- */
-static double get_rate_per_second_from_deltas(const std::span<core_timer_delta>& times)
-{
-    size_t count = 0;
-    double sum = 0.0;
-    for (const auto& time : times)
-    {
-        if (time.count() > 0.0)
-        {
-            sum += time.count() / 1000000.0;
-            count++;
-        }
-    }
-    return count > 0 ? 1000.0 / (sum / count) : 0.0;
-}
-
 #pragma region Change notifications
 
 void on_script_started(std::any data)
@@ -875,6 +885,58 @@ t_window_info get_window_info()
 
 #pragma endregion
 
+/**
+ * \brief Builds the trace logger parameters from the config.
+ * \param format The log format.
+ */
+static core_tl_params get_tracelog_params(core_tl_format format)
+{
+    core_tl_params params{};
+    params.format = format;
+    params.compress = g_config.tracelog_compress;
+    params.overflow = g_config.tracelog_drop_on_overflow ? core_tl_overflow_drop : core_tl_overflow_block;
+
+    const auto range = split_wstring(g_config.tracelog_pc_range, L"-");
+    if (range.size() == 2)
+    {
+        params.pc_start = std::wcstoul(range[0].c_str(), nullptr, 16);
+        params.pc_end = std::wcstoul(range[1].c_str(), nullptr, 16);
+    }
+    else if (!g_config.tracelog_pc_range.empty())
+    {
+        g_view_logger->warn(L"[View] Ignoring malformed trace log address range {}", g_config.tracelog_pc_range);
+    }
+
+    const std::pair<const wchar_t*, core_tl_class> class_names[] = {
+    {L"alu", core_tl_class_alu},
+    {L"branch", core_tl_class_branch},
+    {L"load", core_tl_class_load},
+    {L"store", core_tl_class_store},
+    {L"cop0", core_tl_class_cop0},
+    {L"fpu", core_tl_class_fpu},
+    };
+
+    if (!g_config.tracelog_classes.empty())
+    {
+        params.classes = 0;
+        for (auto name : split_wstring(g_config.tracelog_classes, L","))
+        {
+            std::erase(name, L' ');
+            const auto it = std::ranges::find_if(class_names, [&](const auto& pair) {
+                return iequals(pair.first, name);
+            });
+            if (it == std::end(class_names))
+            {
+                g_view_logger->warn(L"[View] Ignoring unknown trace log instruction class {}", name);
+                continue;
+            }
+            params.classes |= it->second;
+        }
+    }
+
+    return params;
+}
+
 bool confirm_user_exit()
 {
     if (g_config.silent_mode)
@@ -1230,7 +1292,10 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
         configdialog_init();
         return TRUE;
     case WM_DESTROY:
-        save_config();
+        if (Cli::wants_config_save())
+        {
+            save_config();
+        }
         timeKillEvent(g_ui_timer);
         AsyncExecutor::stop();
         Gdiplus::GdiplusShutdown(gdi_plus_token);
@@ -1292,7 +1357,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
             EnableMenuItem(g_main_menu, IDM_STOP_MOVIE, vcr_active ? MF_ENABLED : MF_GRAYED);
             EnableMenuItem(g_main_menu, IDM_CREATE_MOVIE_BACKUP, vcr_active ? MF_ENABLED : MF_GRAYED);
             EnableMenuItem(g_main_menu, IDM_TRACELOG, core_executing ? MF_ENABLED : MF_GRAYED);
-            EnableMenuItem(g_main_menu, IDM_COREDBG, (core_executing && g_config.core.core_type == 2) ? MF_ENABLED : MF_GRAYED);
+            EnableMenuItem(g_main_menu, IDM_COREDBG, (core_executing && g_config.core.core_type != 1) ? MF_ENABLED : MF_GRAYED);
             EnableMenuItem(g_main_menu, IDM_SEEKER, (core_executing && vcr_active) ? MF_ENABLED : MF_GRAYED);
             EnableMenuItem(g_main_menu, IDM_PIANO_ROLL, core_executing ? MF_ENABLED : MF_GRAYED);
             EnableMenuItem(g_main_menu, IDM_CHEATS, core_executing ? MF_ENABLED : MF_GRAYED);
@@ -1424,11 +1489,57 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                 }
             case IDM_BENCHMARK_MESSENGER:
                 {
-                    ScopeTimer timer("Messenger", g_view_logger.get());
-                    for (int i = 0; i < 10'000'000; ++i)
+                    // Broadcasts a per-VI message to as many subscribers as the hot messages usually have, once boxed into an std::any and once typed
+                    constexpr int32_t broadcast_count = 10'000'000;
+
+                    std::wstring results;
+                    for (const size_t subscriber_count : {0, 1, 4, 16})
                     {
-                        Messenger::broadcast(Messenger::Message::None, 5);
+                        for (const auto typed : {false, true})
+                        {
+                            std::vector<std::function<void()>> unsubscribe_funcs;
+                            for (size_t i = 0; i < subscriber_count; ++i)
+                            {
+                                if (typed)
+                                {
+                                    unsubscribe_funcs.push_back(Messenger::subscribe<Messenger::Message::None>([](const int32_t&) {}));
+                                }
+                                else
+                                {
+                                    unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::None, [](std::any data) {
+                                        (void)std::any_cast<int32_t>(data);
+                                    }));
+                                }
+                            }
+
+                            const auto name = typed ? "typed" : "std::any";
+                            int elapsed;
+                            {
+                                ScopeTimer timer(std::format("{} {} broadcasts to {} subscribers", broadcast_count, name, subscriber_count), g_view_logger.get());
+                                for (int32_t i = 0; i < broadcast_count; ++i)
+                                {
+                                    if (typed)
+                                    {
+                                        Messenger::broadcast<Messenger::Message::None>(i);
+                                    }
+                                    else
+                                    {
+                                        Messenger::broadcast(Messenger::Message::None, i);
+                                    }
+                                }
+                                elapsed = timer.momentary_ms();
+                            }
+
+                            for (const auto& unsubscribe_func : unsubscribe_funcs)
+                            {
+                                unsubscribe_func();
+                            }
+
+                            results += std::format(L"{} subscribers, {}: {}ms ({:.1f}ns per broadcast)\n", subscriber_count, string_to_wstring(name), elapsed, elapsed * 1'000'000.0 / broadcast_count);
+                        }
                     }
+
+                    DialogService::show_dialog(results.c_str(), L"Benchmark Messenger", fsvc_information);
                 }
                 break;
             case IDM_BENCHMARK_LUA_CALLBACK:
@@ -1442,6 +1553,108 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                     DialogService::show_dialog(std::format(L"100,000,000 atreset callback invocations took {}ms", timer.momentary_ms()).c_str(), L"Benchmark Lua Callback", fsvc_information);
                 }
                 break;
+            case IDM_BENCHMARK_LUA_MEMORY:
+                {
+                    // Each scan sums up 10,000 consecutive words 100 times
+                    const std::pair<const char*, const char*> scans[] = {
+                    {"readdword", "local s = 0 for _ = 1, 100 do for i = 0, 9999 do s = s + memory.readdword(0x80000000 + i * 4) end end"},
+                    {"readarray", "local s, t = 0, {} for _ = 1, 100 do memory.readarray(0x80000000, 10000, 4, 4, t) for i = 1, 10000 do s = s + t[i] end end"},
+                    {"readstruct", "local s, t = 0, {} for _ = 1, 100 do memory.readstruct(0x80000000, '10000I', t) for i = 1, 10000 do s = s + t[i] end end"},
+                    {"view", "local s, v = 0, memory.view(0x80000000, 40000) for _ = 1, 100 do for i = 0, 9999 do s = s + v:get(i * 4, 'I') end end"},
+                    };
+
+                    lua_State* L = luaL_newstate();
+                    LuaRegistry::register_functions(L);
+
+                    std::wstring results;
+                    for (const auto& [name, code] : scans)
+                    {
+                        ScopeTimer timer(std::format("100x 10,000 field scan ({})", name), g_view_logger.get());
+                        luaL_dostring(L, code);
+                        results += std::format(L"{}: {}ms\n", string_to_wstring(name), timer.momentary_ms());
+                    }
+
+                    lua_close(L);
+                    DialogService::show_dialog(results.c_str(), L"Benchmark Lua Memory", fsvc_information);
+                }
+                break;
+            case IDM_BENCHMARK_LUA_DISPATCH:
+                {
+                    // A minute of emulation at 60 VI/s and 1 kHz input polling, dispatched to 10 scripts with 10 atvi and 10 atinput callbacks each
+                    constexpr size_t script_count = 10;
+                    constexpr size_t callback_count = 10;
+                    constexpr size_t duration_ms = 60'000;
+
+                    std::vector<t_lua_environment*> environments;
+                    for (size_t i = 0; i < script_count; ++i)
+                    {
+                        auto lua = new t_lua_environment();
+                        lua->L = luaL_newstate();
+                        for (auto key : {LuaCallbacks::REG_ATVI, LuaCallbacks::REG_ATINPUT})
+                        {
+                            for (size_t j = 0; j < callback_count; ++j)
+                            {
+                                luaL_loadstring(lua->L, "local x = 0 x = x + 1");
+                                lua->callbacks[key].push_back(luaL_ref(lua->L, LUA_REGISTRYINDEX));
+                            }
+                        }
+                        environments.push_back(lua);
+                    }
+
+                    ScopeTimer timer("Lua callback dispatch", g_view_logger.get());
+                    for (size_t ms = 0; ms < duration_ms; ++ms)
+                    {
+                        for (const auto lua : environments)
+                        {
+                            LuaCallbacks::invoke_callbacks_with_key(*lua, pcall_no_params, LuaCallbacks::REG_ATINPUT);
+                        }
+                        if (ms * 60 / 1000 != (ms + 1) * 60 / 1000)
+                        {
+                            for (const auto lua : environments)
+                            {
+                                LuaCallbacks::invoke_callbacks_with_key(*lua, pcall_no_params, LuaCallbacks::REG_ATVI);
+                            }
+                        }
+                    }
+                    const auto elapsed = timer.momentary_ms();
+
+                    for (const auto lua : environments)
+                    {
+                        lua_close(lua->L);
+                        delete lua;
+                    }
+
+                    DialogService::show_dialog(std::format(L"A minute of VIs and input polls was dispatched to {} scripts with {} callbacks each in {}ms", script_count, callback_count * 2, elapsed).c_str(), L"Benchmark Lua Callback Dispatch", fsvc_information);
+                }
+                break;
+            case IDM_BENCHMARK_YUV_CONVERSION:
+                {
+                    // 10 seconds of 1080p60 video made of noise, which is converted to each YUV format
+                    constexpr int32_t width = 1920;
+                    constexpr int32_t height = 1080;
+                    constexpr size_t frame_count = 600;
+
+                    std::vector<uint8_t> src(width * height * 3);
+                    std::vector<uint8_t> dst(yuv_get_frame_size(width, height));
+                    std::mt19937 rng(0);
+                    std::ranges::generate(src, [&] { return (uint8_t)rng(); });
+
+                    std::wstring results;
+                    for (const auto nv12 : {false, true})
+                    {
+                        const auto name = nv12 ? "NV12" : "YUV420P";
+                        ScopeTimer timer(std::format("{} 1080p BGR24 to {} conversions", frame_count, name), g_view_logger.get());
+                        for (size_t i = 0; i < frame_count; ++i)
+                        {
+                            yuv_from_bgr24(src.data(), dst.data(), width, height, nv12);
+                        }
+                        const auto elapsed = timer.momentary_ms();
+                        results += std::format(L"{}: {}ms ({:.0f} fps)\n", string_to_wstring(name), elapsed, frame_count * 1000.0 / std::max(elapsed, 1));
+                    }
+
+                    DialogService::show_dialog(results.c_str(), L"Benchmark YUV Conversion", fsvc_information);
+                }
+                break;
             case IDM_TRACELOG:
                 {
                     if (core_vr_is_tracelog_active())
@@ -1458,10 +1671,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                         break;
                     }
 
-                    auto result = MessageBox(g_main_hwnd, L"Should the trace log be generated in a binary format?", L"Trace Logger",
-                                             MB_YESNO | MB_ICONQUESTION | MB_DEFBUTTON1);
+                    auto format = core_tl_format_raw;
+                    if (!g_config.tracelog_raw)
+                    {
+                        auto result = MessageBox(g_main_hwnd, L"Should the trace log be generated in a binary format?", L"Trace Logger",
+                                                 MB_YESNO | MB_ICONQUESTION | MB_DEFBUTTON1);
+                        format = result == IDYES ? core_tl_format_binary : core_tl_format_text;
+                    }
 
-                    core_tl_start(path, result == IDYES, false);
+                    core_tl_start(path, get_tracelog_params(format));
                     ModifyMenu(g_main_menu, IDM_TRACELOG, MF_BYCOMMAND | MF_STRING, IDM_TRACELOG, L"Stop &Trace Logger");
                 }
                 break;
@@ -2141,13 +2359,29 @@ static void CALLBACK invalidate_callback(UINT, UINT, DWORD_PTR, DWORD_PTR, DWORD
 
         if (EncodingManager::is_capturing())
         {
+            // Encoders which queue frames also show how far encoding has fallen behind
+            const auto stats = EncodingManager::get_stats();
+            auto capture_text = std::format(L"{}", EncodingManager::get_video_frame());
+            if (stats.video_queue_capacity > 0)
+            {
+                capture_text += std::format(L" [{}/{}]", stats.video_queue_depth, stats.video_queue_capacity);
+            }
+            if (stats.dropped_frames > 0)
+            {
+                capture_text += std::format(L" {} dropped", stats.dropped_frames);
+            }
+            if (stats.duplicate_frames > 0)
+            {
+                capture_text += std::format(L" {} dup", stats.duplicate_frames);
+            }
+
             if (core_vcr_get_task() == task_idle)
             {
-                Statusbar::post(std::format(L"{}", EncodingManager::get_video_frame()), Statusbar::Section::VCR);
+                Statusbar::post(capture_text, Statusbar::Section::VCR);
             }
             else
             {
-                Statusbar::post(std::format(L"{}({})", get_status_text(), EncodingManager::get_video_frame()), Statusbar::Section::VCR);
+                Statusbar::post(std::format(L"{}({})", get_status_text(), capture_text), Statusbar::Section::VCR);
             }
         }
         else
@@ -2161,13 +2395,8 @@ static void CALLBACK invalidate_callback(UINT, UINT, DWORD_PTR, DWORD_PTR, DWORD
     // We throttle FPS and VI/s visual updates to 1 per second, so no unstable values are displayed
     if (time - last_statusbar_update > std::chrono::seconds(1))
     {
-        g_core.g_frame_deltas_mutex.lock();
-        auto fps = get_rate_per_second_from_deltas(g_core.g_frame_deltas);
-        g_core.g_frame_deltas_mutex.unlock();
-
-        g_core.g_vi_deltas_mutex.lock();
-        auto vis = get_rate_per_second_from_deltas(g_core.g_vi_deltas);
-        g_core.g_vi_deltas_mutex.unlock();
+        const auto fps = core_vr_get_frame_stats().rate;
+        const auto vis = core_vr_get_vi_stats().rate;
 
         Statusbar::post(std::format(L"FPS: {:.1f}", fps), Statusbar::Section::FPS);
         Statusbar::post(std::format(L"VI/s: {:.1f}", vis), Statusbar::Section::VIs);
@@ -2221,6 +2450,7 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     dispatcher_event = CreateEvent(NULL, FALSE, FALSE, NULL);
     dispatcher_done_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    LuaCallbacks::init();
 
     g_core.cfg = &g_config.core;
     g_core.callbacks = {};
@@ -2251,16 +2481,16 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         LuaCallbacks::call_seek_completed();
     };
     g_core.callbacks.core_executing_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::CoreExecutingChanged, value);
+        Messenger::broadcast<Messenger::Message::CoreExecutingChanged>(value);
     };
     g_core.callbacks.emu_paused_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::EmuPausedChanged, value);
+        Messenger::broadcast<Messenger::Message::EmuPausedChanged>(value);
     };
     g_core.callbacks.emu_launched_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::EmuLaunchedChanged, value);
+        Messenger::broadcast<Messenger::Message::EmuLaunchedChanged>(value);
     };
     g_core.callbacks.emu_starting_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::EmuStartingChanged, value);
+        Messenger::broadcast<Messenger::Message::EmuStartingChanged>(value);
     };
     g_core.callbacks.emu_stopping = []() {
         Messenger::broadcast(Messenger::Message::EmuStopping, nullptr);
@@ -2269,35 +2499,35 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         Messenger::broadcast(Messenger::Message::ResetCompleted, nullptr);
     };
     g_core.callbacks.speed_modifier_changed = [](int32_t value) {
-        Messenger::broadcast(Messenger::Message::SpeedModifierChanged, value);
+        Messenger::broadcast<Messenger::Message::SpeedModifierChanged>(value);
     };
     g_core.callbacks.warp_modify_status_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::WarpModifyStatusChanged, value);
+        Messenger::broadcast<Messenger::Message::WarpModifyStatusChanged>(value);
     };
     g_core.callbacks.current_sample_changed = [](int32_t value) {
         Compare::compare(value);
-        Messenger::broadcast(Messenger::Message::CurrentSampleChanged, value);
+        Messenger::broadcast<Messenger::Message::CurrentSampleChanged>(value);
     };
     g_core.callbacks.task_changed = [](core_vcr_task value) {
-        Messenger::broadcast(Messenger::Message::TaskChanged, value);
+        Messenger::broadcast<Messenger::Message::TaskChanged>(value);
     };
     g_core.callbacks.rerecords_changed = [](uint64_t value) {
-        Messenger::broadcast(Messenger::Message::RerecordsChanged, value);
+        Messenger::broadcast<Messenger::Message::RerecordsChanged>(value);
     };
     g_core.callbacks.unfreeze_completed = []() {
         Messenger::broadcast(Messenger::Message::UnfreezeCompleted, nullptr);
     };
     g_core.callbacks.seek_savestate_changed = [](size_t value) {
-        Messenger::broadcast(Messenger::Message::SeekSavestateChanged, value);
+        Messenger::broadcast<Messenger::Message::SeekSavestateChanged>(value);
     };
     g_core.callbacks.readonly_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::ReadonlyChanged, value);
+        Messenger::broadcast<Messenger::Message::ReadonlyChanged>(value);
     };
     g_core.callbacks.dacrate_changed = [](core_system_type value) {
-        Messenger::broadcast(Messenger::Message::DacrateChanged, value);
+        Messenger::broadcast<Messenger::Message::DacrateChanged>(value);
     };
     g_core.callbacks.debugger_resumed_changed = [](bool value) {
-        Messenger::broadcast(Messenger::Message::DebuggerResumedChanged, value);
+        Messenger::broadcast<Messenger::Message::DebuggerResumedChanged>(value);
     };
     g_core.callbacks.debugger_cpu_state_changed = [](core_dbg_cpu_state* value) {
         Messenger::broadcast(Messenger::Message::DebuggerCpuStateChanged, value);
@@ -2396,6 +2626,12 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     init_config();
     load_config();
+
+    if (Cli::run_tools())
+    {
+        return 0;
+    }
+
     lua_init();
 
     if (g_config.keep_default_working_directory)
@@ -2511,7 +2747,8 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     while (!exit)
     {
-        DWORD result = MsgWaitForMultipleObjects(1, &dispatcher_event, FALSE, INFINITE, QS_ALLINPUT);
+        const HANDLE handles[] = {dispatcher_event, LuaCallbacks::get_event_handle()};
+        DWORD result = MsgWaitForMultipleObjects((DWORD)std::size(handles), handles, FALSE, INFINITE, QS_ALLINPUT);
 
         if (result == WAIT_OBJECT_0)
         {
@@ -2519,12 +2756,19 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
             SetEvent(dispatcher_done_event);
         }
         else if (result == WAIT_OBJECT_0 + 1)
+        {
+            LuaCallbacks::process_events();
+        }
+        else if (result == WAIT_OBJECT_0 + std::size(handles))
         {
             while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
             {
                 TranslateMessage(&msg);
                 DispatchMessage(&msg);
 
+                // Lua callbacks are usually awaited by the emu thread, so they shouldn't wait until the whole message queue is drained
+                LuaCallbacks::process_events();
+
                 if (msg.message == WM_QUIT)
                 {
                     exit = true;
@@ -2539,6 +2783,7 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     CloseHandle(dispatcher_event);
     CloseHandle(dispatcher_done_event);
+    CloseHandle(LuaCallbacks::get_event_handle());
 
     return (int)msg.wParam;
 }
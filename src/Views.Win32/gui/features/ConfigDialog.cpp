@@ -1238,6 +1238,41 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     },
     t_options_item{
     .group_id = capture_group.id,
+    .name = L"Overflow Dropping",
+    .tooltip = L"Whether the FFmpeg encoder drops video frames when encoding can't keep up with emulation. Dropped frames are replaced with blank ones.\nWhen disabled, emulation is slowed down instead and no frames are lost.",
+    .data = &g_config.capture_drop_on_overflow,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return EncodingManager::is_capturing();
+    },
+    },
+    t_options_item{
+    .group_id = capture_group.id,
+    .name = L"Pixel Format",
+    .tooltip = L"The pixel format of the video frames sent to FFmpeg.\nBGR24 - Frames are sent as captured\nYUV420P, NV12 - Frames are converted before being sent, which halves their size\nThe format replaces the \"-pixel_format bgr24\" option of the FFmpeg options.",
+    .data = &g_config.capture_pixel_format,
+    .type = t_options_item::Type::Enum,
+    .possible_values = {
+    std::make_pair(L"BGR24", (int32_t)PIXEL_FORMAT_BGR24),
+    std::make_pair(L"YUV420P", (int32_t)PIXEL_FORMAT_YUV420P),
+    std::make_pair(L"NV12", (int32_t)PIXEL_FORMAT_NV12),
+    },
+    .is_readonly = [] {
+        return EncodingManager::is_capturing();
+    },
+    },
+    t_options_item{
+    .group_id = capture_group.id,
+    .name = L"Variable Frame Rate",
+    .tooltip = L"Whether the FFmpeg encoder skips frames which are identical to the previous one, such as lag frames and static screens. The previous frame is shown for longer instead.\nThis reduces the encoding work for long captures, but produces a variable frame rate video.\nRequires FFmpeg 5.1 or newer and the default rawvideo input in the FFmpeg options.",
+    .data = &g_config.capture_vfr,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return EncodingManager::is_capturing();
+    },
+    },
+    t_options_item{
+    .group_id = capture_group.id,
     .name = L"FFmpeg Path",
     .tooltip = L"The path to the FFmpeg executable to use for capturing.",
     .data_str = &g_config.ffmpeg_path,
@@ -1337,9 +1372,19 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     },
     t_options_item{
     .group_id = core_group.id,
+    .name = L"Idle Loop Detection",
+    .tooltip = L"Fast-forwards through side-effect-free polling loops when using the Interpreter core.\nImproves performance, but changes emulation timing and will desync movies recorded without it.\nCan be overridden per ROM in the core.idle_loop_detection_roms config section.",
+    .data = &g_config.core.idle_loop_detection,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return core_vr_get_launched();
+    },
+    },
+    t_options_item{
+    .group_id = core_group.id,
     .name = L"ROM Cache Size",
-    .tooltip = L"Size of the ROM cache.\nImproves ROM loading performance at the cost of data staleness and high memory usage.\n0 - Disabled\nn - Maximum of n ROMs kept in cache",
-    .data = &g_config.core.rom_cache_size,
+    .tooltip = L"Size of the ROM cache in megabytes.\nKeeps recently loaded ROMs in memory, which makes resets and switching between them faster at the cost of memory usage.\n0 - Disabled\nn - Least recently used ROMs are evicted once the cache exceeds n megabytes",
+    .data = &g_config.core.rom_cache_budget,
     .type = t_options_item::Type::Number,
     },
 
@@ -1389,6 +1434,13 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
         return !g_lua_environments.empty();
     },
     },
+    t_options_item{
+    .group_id = lua_group.id,
+    .name = L"Synchronous Callbacks",
+    .tooltip = L"Whether the emulator waits for Lua callbacks such as atvi to finish before continuing.\nWhen disabled, callbacks run on the UI thread while emulation continues, and only input polls wait for scripts which use atinput or joypad.set.\nDisabling this can improve performance, but scripts may see emulator state from a later frame than the one which fired the callback.",
+    .data = &g_config.lua_synchronous_callbacks,
+    .type = t_options_item::Type::Bool,
+    },
 
     t_options_item{
     .group_id = debug_group.id,
@@ -1418,6 +1470,56 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     .data = &g_config.core.is_compiled_jump_enabled,
     .type = t_options_item::Type::Bool,
     },
+    t_options_item{
+    .group_id = debug_group.id,
+    .name = L"Raw Trace Capture",
+    .tooltip = L"Whether the trace logger writes raw captures instead of trace logs, which is considerably faster.\nCaptures are decoded into text or binary trace logs with the --decode-trace commandline option.",
+    .data = &g_config.tracelog_raw,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return core_vr_is_tracelog_active();
+    },
+    },
+    t_options_item{
+    .group_id = debug_group.id,
+    .name = L"Compress Trace Logs",
+    .tooltip = L"Whether trace logs are gzip-compressed while they are written.\nRaw captures are never compressed.",
+    .data = &g_config.tracelog_compress,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return core_vr_is_tracelog_active();
+    },
+    },
+    t_options_item{
+    .group_id = debug_group.id,
+    .name = L"Trace Log Overflow Dropping",
+    .tooltip = L"Whether the trace logger drops instructions when writing can't keep up with emulation.\nWhen disabled, emulation is slowed down instead and no instructions are lost.",
+    .data = &g_config.tracelog_drop_on_overflow,
+    .type = t_options_item::Type::Bool,
+    .is_readonly = [] {
+        return core_vr_is_tracelog_active();
+    },
+    },
+    t_options_item{
+    .group_id = debug_group.id,
+    .name = L"Trace Log Address Range",
+    .tooltip = L"The inclusive hexadecimal address range of traced instructions, e.g. 80246000-80250000.\nLeave empty to trace all addresses.",
+    .data_str = &g_config.tracelog_pc_range,
+    .type = t_options_item::Type::String,
+    .is_readonly = [] {
+        return core_vr_is_tracelog_active();
+    },
+    },
+    t_options_item{
+    .group_id = debug_group.id,
+    .name = L"Trace Log Instruction Classes",
+    .tooltip = L"The comma-separated classes of traced instructions.\nalu, branch, load, store, cop0, fpu\nLeave empty to trace all instructions.",
+    .data_str = &g_config.tracelog_classes,
+    .type = t_options_item::Type::String,
+    .is_readonly = [] {
+        return core_vr_is_tracelog_active();
+    },
+    },
     };
 
     for (const auto hotkey : g_config_hotkeys)
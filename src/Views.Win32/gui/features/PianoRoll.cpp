@@ -716,10 +716,9 @@ namespace PianoRoll
         });
     }
 
-    void on_current_sample_changed(std::any data)
+    void on_current_sample_changed(int32_t value)
     {
         g_piano_roll_dispatcher->invoke([=] {
-            auto value = std::any_cast<int32_t>(data);
             static auto previous_value = value;
 
             if (core_vcr_get_warp_modify_status() || core_vcr_is_seeking())
@@ -1510,7 +1509,7 @@ namespace PianoRoll
 
             std::vector<std::function<void()>> unsubscribe_funcs;
             unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::TaskChanged, on_task_changed));
-            unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::CurrentSampleChanged, on_current_sample_changed));
+            unsubscribe_funcs.push_back(Messenger::subscribe<Messenger::Message::CurrentSampleChanged>(on_current_sample_changed));
             unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::UnfreezeCompleted, on_unfreeze_completed));
             unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::WarpModifyStatusChanged, on_warp_modify_status_changed));
             unsubscribe_funcs.push_back(Messenger::subscribe(Messenger::Message::SeekCompleted, on_seek_completed));
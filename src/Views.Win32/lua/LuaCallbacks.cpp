@@ -7,15 +7,47 @@
 #include "stdafx.h"
 #include <lua/LuaCallbacks.h>
 #include <lua/LuaConsole.h>
+#include <Config.h>
 #include <gui/Main.h>
 
-// OPTIMIZATION: If no lua scripts are running, skip the deeper lua path
-// This is an unsynchronized access to the map from the emu thread!
-#define RET_IF_EMPTY                    \
-    {                                   \
-        if (g_lua_environments.empty()) \
-            return;                     \
-    }
+// The amount of events the event channel can hold. Producers wait for the UI thread when it's full.
+constexpr size_t EVENT_CAPACITY = 256;
+
+/**
+ * \brief An emulator notification which is delivered to the Lua instances on the UI thread.
+ */
+typedef struct {
+    LuaCallbacks::callback_key key;
+
+    // The controller index and polled input for REG_ATINPUT
+    int index;
+    core_buttons input;
+
+    // The status for REG_ATWARPMODIFYSTATUSCHANGED
+    int32_t status;
+} t_lua_event;
+
+typedef struct {
+    std::atomic<size_t> sequence;
+    t_lua_event event;
+} t_lua_event_cell;
+
+// A bounded lock-free multi-producer single-consumer queue, where each cell's sequence tells producers and the consumer whether it's free or filled
+static t_lua_event_cell event_cells[EVENT_CAPACITY];
+static std::atomic<size_t> enqueue_pos;
+static size_t dequeue_pos;
+
+// The amount of events which have been fully processed. Producers which need a result wait on this.
+static std::atomic<size_t> processed_count;
+
+// The input reply for the last processed REG_ATINPUT event. Only one input poll is in flight at a time, since only the emu thread polls input.
+static core_buttons input_reply;
+
+static HANDLE event_handle;
+static std::atomic<bool> wake_pending;
+
+// Bitmask of callback keys with at least one registered callback in any instance
+static std::atomic<uint32_t> registered_keys;
 
 typedef struct {
     HWND wnd;
@@ -27,6 +59,7 @@ typedef struct {
 t_window_procedure_params window_proc_params{};
 
 int current_input_n = 0;
+int32_t current_warp_modify_status = 0;
 
 int AtInput(lua_State* L)
 {
@@ -44,6 +77,181 @@ int AtWindowMessage(lua_State* L)
     return lua_pcall(L, 4, 0, 0);
 }
 
+int AtWarpModifyStatusChanged(lua_State* L)
+{
+    lua_pushinteger(L, current_warp_modify_status);
+    return lua_pcall(L, 1, 0, 0);
+}
+
+static bool is_registered(LuaCallbacks::callback_key key)
+{
+    return registered_keys.load(std::memory_order_relaxed) & (1 << key);
+}
+
+/**
+ * \brief Invokes the callbacks for an event. Must be called from the UI thread.
+ */
+static void dispatch_event(const t_lua_event& event)
+{
+    switch (event.key)
+    {
+    case LuaCallbacks::REG_ATINPUT:
+        last_controller_data[event.index] = event.input;
+        current_input_n = event.index;
+        LuaCallbacks::invoke_callbacks_with_key_on_all_instances(AtInput, LuaCallbacks::REG_ATINPUT);
+        g_input_count++;
+
+        input_reply = last_controller_data[event.index];
+        if (overwrite_controller_data[event.index])
+        {
+            input_reply = new_controller_data[event.index];
+            last_controller_data[event.index] = input_reply;
+            overwrite_controller_data[event.index] = false;
+        }
+        break;
+    case LuaCallbacks::REG_ATWARPMODIFYSTATUSCHANGED:
+        current_warp_modify_status = event.status;
+        LuaCallbacks::invoke_callbacks_with_key_on_all_instances(AtWarpModifyStatusChanged, LuaCallbacks::REG_ATWARPMODIFYSTATUSCHANGED);
+        break;
+    default:
+        LuaCallbacks::invoke_callbacks_with_key_on_all_instances(pcall_no_params, event.key);
+        break;
+    }
+}
+
+/**
+ * \brief Puts an event into the event channel and wakes the UI thread.
+ * \return The event's position in the channel, which can be waited on with wait_for_event.
+ */
+static size_t post_event(const t_lua_event& event)
+{
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    t_lua_event_cell* cell;
+    while (true)
+    {
+        cell = &event_cells[pos % EVENT_CAPACITY];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The channel is full, so we have to wait for the UI thread to catch up
+            SetEvent(event_handle);
+            std::this_thread::yield();
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->event = event;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    if (!wake_pending.exchange(true, std::memory_order_acq_rel))
+    {
+        SetEvent(event_handle);
+    }
+
+    return pos;
+}
+
+/**
+ * \brief Waits until the UI thread has processed the event at the specified position.
+ */
+static void wait_for_event(size_t pos)
+{
+    size_t processed = processed_count.load(std::memory_order_acquire);
+    while (processed <= pos)
+    {
+        processed_count.wait(processed, std::memory_order_acquire);
+        processed = processed_count.load(std::memory_order_acquire);
+    }
+}
+
+/**
+ * \brief Notifies all Lua instances of an event. Runs the callbacks immediately on the UI thread, and goes through the event channel on other threads.
+ */
+static void notify(const t_lua_event& event)
+{
+    if (is_on_gui_thread())
+    {
+        dispatch_event(event);
+        return;
+    }
+
+    const auto pos = post_event(event);
+    if (g_config.lua_synchronous_callbacks)
+    {
+        wait_for_event(pos);
+    }
+}
+
+void LuaCallbacks::init()
+{
+    for (size_t i = 0; i < EVENT_CAPACITY; ++i)
+    {
+        event_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    event_handle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+}
+
+HANDLE LuaCallbacks::get_event_handle()
+{
+    return event_handle;
+}
+
+void LuaCallbacks::process_events()
+{
+    assert(is_on_gui_thread());
+
+    wake_pending.exchange(false, std::memory_order_acq_rel);
+
+    while (true)
+    {
+        auto& cell = event_cells[dequeue_pos % EVENT_CAPACITY];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+        {
+            break;
+        }
+
+        const t_lua_event event = cell.event;
+        cell.sequence.store(dequeue_pos + EVENT_CAPACITY, std::memory_order_release);
+        ++dequeue_pos;
+
+        dispatch_event(event);
+
+        processed_count.store(dequeue_pos, std::memory_order_release);
+        processed_count.notify_all();
+    }
+}
+
+void LuaCallbacks::update_registered_keys()
+{
+    assert(is_on_gui_thread());
+
+    uint32_t keys = 0;
+    for (const auto& lua : g_lua_environments)
+    {
+        for (callback_key key = REG_LUACLASS + 1; key < CALLBACK_KEY_COUNT; ++key)
+        {
+            if (!lua->callbacks[key].empty())
+            {
+                keys |= 1 << key;
+            }
+        }
+    }
+    registered_keys.store(keys, std::memory_order_relaxed);
+}
+
 core_buttons LuaCallbacks::get_last_controller_data(int index)
 {
     return last_controller_data[index];
@@ -51,7 +259,11 @@ core_buttons LuaCallbacks::get_last_controller_data(int index)
 
 void LuaCallbacks::call_window_message(void* wnd, unsigned int msg, unsigned int w, long l)
 {
-    RET_IF_EMPTY;
+    if (!is_registered(REG_WINDOWMESSAGE))
+    {
+        return;
+    }
+
     // Invoking dispatcher here isn't allowed, as it would lead to infinite recursion
     window_proc_params = {
     .wnd = (HWND)wnd,
@@ -63,118 +275,142 @@ void LuaCallbacks::call_window_message(void* wnd, unsigned int msg, unsigned int
 
 void LuaCallbacks::call_vi()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATVI);
-    });
+    if (!is_registered(REG_ATVI))
+    {
+        return;
+    }
+    notify({.key = REG_ATVI});
 }
 
 void LuaCallbacks::call_input(core_buttons* input, int index)
 {
     // NOTE: Special callback, we store the input data for all scripts to access via joypad.get(n)
     // If they request a change via joypad.set(n, input), we change the input
-    last_controller_data[index] = *input;
-
-    RET_IF_EMPTY;
+    if (g_lua_environments.empty())
+    {
+        last_controller_data[index] = *input;
+        return;
+    }
 
-    g_main_window_dispatcher->invoke([=] {
-        current_input_n = index;
-        invoke_callbacks_with_key_on_all_instances(AtInput, REG_ATINPUT);
-        g_input_count++;
+    const bool override_pending = std::ranges::any_of(overwrite_controller_data, [](const auto& overwrite) {
+        return overwrite.load();
     });
+    const bool drained = processed_count.load(std::memory_order_acquire) == enqueue_pos.load(std::memory_order_acquire);
 
-    if (overwrite_controller_data[index])
+    // We only need a round trip if a script wants to see or change this poll's input, or if a pending event might still change it
+    if (!is_registered(REG_ATINPUT) && !override_pending && drained)
     {
-        *input = new_controller_data[index];
         last_controller_data[index] = *input;
-        overwrite_controller_data[index] = false;
+        g_input_count++;
+        return;
+    }
+
+    const t_lua_event event = {
+    .key = REG_ATINPUT,
+    .index = index,
+    .input = *input,
+    };
+
+    if (is_on_gui_thread())
+    {
+        dispatch_event(event);
     }
+    else
+    {
+        wait_for_event(post_event(event));
+    }
+
+    *input = input_reply;
 }
 
 void LuaCallbacks::call_interval()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATINTERVAL);
-    });
+    if (!is_registered(REG_ATINTERVAL))
+    {
+        return;
+    }
+    notify({.key = REG_ATINTERVAL});
 }
 
 void LuaCallbacks::call_play_movie()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATPLAYMOVIE);
-    });
+    if (!is_registered(REG_ATPLAYMOVIE))
+    {
+        return;
+    }
+    notify({.key = REG_ATPLAYMOVIE});
 }
 
 void LuaCallbacks::call_stop_movie()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATSTOPMOVIE);
-    });
+    if (!is_registered(REG_ATSTOPMOVIE))
+    {
+        return;
+    }
+    notify({.key = REG_ATSTOPMOVIE});
 }
 
 void LuaCallbacks::call_load_state()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATLOADSTATE);
-    });
+    if (!is_registered(REG_ATLOADSTATE))
+    {
+        return;
+    }
+    notify({.key = REG_ATLOADSTATE});
 }
 
 void LuaCallbacks::call_save_state()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATSAVESTATE);
-    });
+    if (!is_registered(REG_ATSAVESTATE))
+    {
+        return;
+    }
+    notify({.key = REG_ATSAVESTATE});
 }
 
 void LuaCallbacks::call_reset()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATRESET);
-    });
+    if (!is_registered(REG_ATRESET))
+    {
+        return;
+    }
+    notify({.key = REG_ATRESET});
 }
 
 void LuaCallbacks::call_seek_completed()
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([] {
-        invoke_callbacks_with_key_on_all_instances(pcall_no_params, REG_ATSEEKCOMPLETED);
-    });
+    if (!is_registered(REG_ATSEEKCOMPLETED))
+    {
+        return;
+    }
+    notify({.key = REG_ATSEEKCOMPLETED});
 }
 
 void LuaCallbacks::call_warp_modify_status_changed(const int32_t status)
 {
-    RET_IF_EMPTY;
-    g_main_window_dispatcher->invoke([=] {
-        invoke_callbacks_with_key_on_all_instances(
-        [=](lua_State* L) {
-            lua_pushinteger(L, status);
-            return lua_pcall(L, 1, 0, 0);
-        },
-        REG_ATWARPMODIFYSTATUSCHANGED);
-    });
+    if (!is_registered(REG_ATWARPMODIFYSTATUSCHANGED))
+    {
+        return;
+    }
+    notify({.key = REG_ATWARPMODIFYSTATUSCHANGED, .status = status});
 }
 
-bool LuaCallbacks::invoke_callbacks_with_key(const LuaEnvironment& lua, const std::function<int(lua_State*)>& function, callback_key key)
+bool LuaCallbacks::invoke_callbacks_with_key(const LuaEnvironment& lua, callback_invoker function, callback_key key)
 {
     assert(is_on_gui_thread());
 
-    lua_rawgeti(lua.L, LUA_REGISTRYINDEX, key);
-    if (lua_isnil(lua.L, -1))
+    // Callbacks can register or unregister callbacks while we're iterating, so we iterate a snapshot.
+    // Callbacks which were unregistered by an earlier one are skipped, as their reference is no longer valid.
+    const auto& refs = lua.callbacks[key];
+    const auto snapshot = refs;
+    for (const auto ref : snapshot)
     {
-        lua_pop(lua.L, 1);
-        return true;
-    }
-    int n = luaL_len(lua.L, -1);
-    for (LUA_INTEGER i = 0; i < n; i++)
-    {
-        lua_pushinteger(lua.L, 1 + i);
-        lua_gettable(lua.L, -2);
+        if (std::ranges::find(refs, ref) == refs.end())
+        {
+            continue;
+        }
+
+        lua_rawgeti(lua.L, LUA_REGISTRYINDEX, ref);
         if (function(lua.L))
         {
             const char* str = lua_tostring(lua.L, -1);
@@ -183,11 +419,10 @@ bool LuaCallbacks::invoke_callbacks_with_key(const LuaEnvironment& lua, const st
             return false;
         }
     }
-    lua_pop(lua.L, 1);
     return true;
 }
 
-void LuaCallbacks::invoke_callbacks_with_key_on_all_instances(const std::function<int(lua_State*)>& function, callback_key key)
+void LuaCallbacks::invoke_callbacks_with_key_on_all_instances(callback_invoker function, callback_key key)
 {
     // OPTIMIZATION: Store destruction-queued scripts in queue and destroy them after iteration to avoid having to clone the queue
     // OPTIMIZATION: Make the destruction queue static to avoid allocating it every entry
@@ -197,6 +432,10 @@ void LuaCallbacks::invoke_callbacks_with_key_on_all_instances(const std::functio
 
     for (const auto& lua : g_lua_environments)
     {
+        if (lua->callbacks[key].empty())
+        {
+            continue;
+        }
         if (!LuaCallbacks::invoke_callbacks_with_key(*lua, function, key))
         {
             destruction_queue.push(lua);
@@ -210,52 +449,29 @@ void LuaCallbacks::invoke_callbacks_with_key_on_all_instances(const std::functio
     }
 }
 
-static int register_function(lua_State* L, LuaCallbacks::callback_key key)
+static void register_function(lua_State* L, LuaCallbacks::callback_key key)
 {
-    lua_rawgeti(L, LUA_REGISTRYINDEX, key);
-    if (lua_isnil(L, -1))
-    {
-        lua_pop(L, 1);
-        lua_newtable(L);
-        lua_rawseti(L, LUA_REGISTRYINDEX, key);
-        lua_rawgeti(L, LUA_REGISTRYINDEX, key);
-    }
-    int i = luaL_len(L, -1) + 1;
-    lua_pushinteger(L, i);
-    lua_pushvalue(L, -3); //
-    lua_settable(L, -3);
-    lua_pop(L, 1);
-    return i;
+    luaL_checktype(L, -1, LUA_TFUNCTION);
+    get_lua_class(L)->callbacks[key].push_back(luaL_ref(L, LUA_REGISTRYINDEX));
 }
 
 static void unregister_function(lua_State* L, LuaCallbacks::callback_key key)
 {
-    lua_rawgeti(L, LUA_REGISTRYINDEX, key);
-    if (lua_isnil(L, -1))
+    auto& refs = get_lua_class(L)->callbacks[key];
+    for (size_t i = 0; i < refs.size(); i++)
     {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, refs[i]);
+        const bool equal = lua_rawequal(L, -1, -2);
         lua_pop(L, 1);
-        lua_newtable(L); // �Ƃ肠����
-    }
-    int n = luaL_len(L, -1);
-    for (LUA_INTEGER i = 0; i < n; i++)
-    {
-        lua_pushinteger(L, 1 + i);
-        lua_gettable(L, -2);
-        if (lua_rawequal(L, -1, -3))
+        if (equal)
         {
+            luaL_unref(L, LUA_REGISTRYINDEX, refs[i]);
+            refs.erase(refs.begin() + i);
             lua_pop(L, 1);
-            lua_getglobal(L, "table");
-            lua_getfield(L, -1, "remove");
-            lua_pushvalue(L, -3);
-            lua_pushinteger(L, 1 + i);
-            lua_call(L, 2, 0);
-            lua_pop(L, 2);
             return;
         }
-        lua_pop(L, 1);
     }
-    lua_pop(L, 1);
-    lua_pushfstring(L, "unregister_function(%s): not found function", key);
+    lua_pushfstring(L, "unregister_function(%d): not found function", key);
     lua_error(L);
 }
 
@@ -272,4 +488,6 @@ void LuaCallbacks::register_or_unregister_function(lua_State* l, const callback_
             lua_pop(l, 1);
         register_function(l, key);
     }
+
+    update_registered_keys();
 }
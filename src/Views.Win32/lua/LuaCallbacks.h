@@ -6,6 +6,8 @@
 
 #pragma once
 
+struct LuaEnvironment;
+
 /**
  * \brief A module responsible for implementing Lua callbacks.
  */
@@ -31,6 +33,34 @@ namespace LuaCallbacks
     constexpr callback_key REG_ATRESET = 16;
     constexpr callback_key REG_ATSEEKCOMPLETED = 17;
     constexpr callback_key REG_ATWARPMODIFYSTATUSCHANGED = 18;
+    constexpr callback_key CALLBACK_KEY_COUNT = 19;
+
+    /**
+     * \brief A function which invokes the callback on top of the stack, pushing its parameters first.
+     */
+    using callback_invoker = int (*)(lua_State*);
+
+    /**
+     * \brief Initializes the event channel through which other threads notify the Lua instances.
+     */
+    void init();
+
+    /**
+     * \brief Gets the event which is signaled when the event channel has pending events.
+     */
+    HANDLE get_event_handle();
+
+    /**
+     * \brief Invokes the callbacks for all pending events in the event channel.
+     * \remarks Must be called from the UI thread.
+     */
+    void process_events();
+
+    /**
+     * \brief Updates the set of callback keys which have callbacks registered in any Lua instance. Notifications for other keys are skipped without touching the event channel.
+     * \remarks Must be called from the UI thread after callbacks are registered or unregistered, or instances are created or destroyed.
+     */
+    void update_registered_keys();
 
     /**
      * \brief Gets the last controller data for a controller index
@@ -99,16 +129,17 @@ namespace LuaCallbacks
      * \param lua The Lua environment.
      * \param function The parameter preparation function associated with the callback.
      * \param key The callback key.
-     * \return Whether the invocation failed.
+     * \return Whether the invocation succeeded.
+     * \remarks Environments without callbacks for the key return immediately without touching the Lua state.
      */
-    bool invoke_callbacks_with_key(const LuaEnvironment& lua, const std::function<int(lua_State*)>& function, callback_key key);
+    bool invoke_callbacks_with_key(const LuaEnvironment& lua, callback_invoker function, callback_key key);
 
     /**
      * \brief Invokes the registered callbacks with the specified key on all Lua instances in the global map.
      * \param function The parameter preparation function associated with the callback.
      * \param key The callback key.
      */
-    void invoke_callbacks_with_key_on_all_instances(const std::function<int(lua_State*)>& function, callback_key key);
+    void invoke_callbacks_with_key_on_all_instances(callback_invoker function, callback_key key);
 
     /**
      * \brief Subscribes to or unsubscribes from the specified callback based on the input parameters.
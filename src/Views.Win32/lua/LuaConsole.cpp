@@ -24,8 +24,8 @@ const auto GDI_OVERLAY_CLASS = L"lua_gdi_overlay";
 
 core_buttons last_controller_data[4];
 core_buttons new_controller_data[4];
-bool overwrite_controller_data[4];
-size_t g_input_count = 0;
+std::atomic<bool> overwrite_controller_data[4];
+std::atomic<size_t> g_input_count = 0;
 
 std::atomic g_d2d_drawing_section = false;
 
@@ -513,8 +513,13 @@ void destroy_lua_environment(t_lua_environment* lua)
     DeleteObject(lua->font);
     lua_close(lua->L);
     lua->L = nullptr;
+    for (auto& refs : lua->callbacks)
+    {
+        refs.clear();
+    }
     set_button_state(lua->hwnd, false);
     destroy_renderer(lua);
+    LuaCallbacks::update_registered_keys();
 
     g_view_logger->info("Lua destroyed");
 }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "presenters/Presenter.h"
+#include "LuaCallbacks.h"
 
 constexpr uint32_t LUA_GDI_COLOR_MASK = RGB(255, 0, 255);
 static HBRUSH g_alpha_mask_brush = CreateSolidBrush(LUA_GDI_COLOR_MASK);
@@ -23,6 +24,9 @@ typedef struct LuaEnvironment {
     // The path to the current lua script
     std::filesystem::path path;
 
+    // The registry references of the registered callbacks for each callback key, in registration order
+    std::vector<int> callbacks[LuaCallbacks::CALLBACK_KEY_COUNT];
+
     // The current presenter, or null
     Presenter* presenter;
 
@@ -177,12 +181,12 @@ extern core_buttons new_controller_data[4];
 /**
  * \brief Whether the <c>new_controller_data</c> of a controller should be pushed the next frame
  */
-extern bool overwrite_controller_data[4];
+extern std::atomic<bool> overwrite_controller_data[4];
 
 /**
  * \brief Amount of call_input calls.
  */
-extern size_t g_input_count;
+extern std::atomic<size_t> g_input_count;
 
 /**
  * \brief Gets the Lua environment associated with a lua state.
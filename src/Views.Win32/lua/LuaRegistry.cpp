@@ -7,6 +7,7 @@
 #include "stdafx.h"
 #include "LuaRegistry.h"
 #include <lua/modules/AVI.h>
+#include <lua/modules/Bruteforce.h>
 #include <lua/modules/D2D.h>
 #include <lua/modules/Emu.h>
 #include <lua/modules/Global.h>
@@ -15,6 +16,7 @@
 #include <lua/modules/Joypad.h>
 #include <lua/modules/Memory.h>
 #include <lua/modules/Movie.h>
+#include <lua/modules/RamSearch.h>
 #include <lua/modules/Savestate.h>
 #include <lua/modules/WGUI.h>
 
@@ -107,6 +109,15 @@ const luaL_Reg MEMORY_FUNCS[] = {
 
 {"writesize", LuaCore::Memory::LuaWriteSize},
 
+// bulk functions
+{"readrange", LuaCore::Memory::LuaReadRange},
+{"writerange", LuaCore::Memory::LuaWriteRange},
+{"readarray", LuaCore::Memory::LuaReadArray},
+{"writearray", LuaCore::Memory::LuaWriteArray},
+{"readstruct", LuaCore::Memory::LuaReadStruct},
+{"writestruct", LuaCore::Memory::LuaWriteStruct},
+{"view", LuaCore::Memory::LuaView},
+
 {"recompilenow", LuaCore::Memory::Recompile},
 {"recompile", LuaCore::Memory::Recompile},
 {"recompilenext", LuaCore::Memory::Recompile},
@@ -203,6 +214,23 @@ const luaL_Reg MOVIE_FUNCS[] = {
 const luaL_Reg SAVESTATE_FUNCS[] = {
 {"savefile", LuaCore::Savestate::SaveFileSavestate},
 {"loadfile", LuaCore::Savestate::LoadFileSavestate},
+{"create", LuaCore::Savestate::CreateHandle},
+{NULL, NULL}};
+
+const luaL_Reg RAMSEARCH_FUNCS[] = {
+{"begin", LuaCore::RamSearch::Begin},
+{"filter", LuaCore::RamSearch::Filter},
+{"count", LuaCore::RamSearch::GetCount},
+{"candidates", LuaCore::RamSearch::GetCandidates},
+{"stop", LuaCore::RamSearch::End},
+{NULL, NULL}};
+
+const luaL_Reg BRUTEFORCE_FUNCS[] = {
+{"start", LuaCore::Bruteforce::Start},
+{"stop", LuaCore::Bruteforce::Stop},
+{"running", LuaCore::Bruteforce::IsRunning},
+{"evaluated", LuaCore::Bruteforce::GetEvaluated},
+{"results", LuaCore::Bruteforce::GetResults},
 {NULL, NULL}};
 
 const luaL_Reg IOHELPER_FUNCS[] = {
@@ -245,6 +273,8 @@ void LuaRegistry::register_functions(lua_State* L)
     register_as_package(L, "joypad", JOYPAD_FUNCS);
     register_as_package(L, "movie", MOVIE_FUNCS);
     register_as_package(L, "savestate", SAVESTATE_FUNCS);
+    register_as_package(L, "ramsearch", RAMSEARCH_FUNCS);
+    register_as_package(L, "bruteforce", BRUTEFORCE_FUNCS);
     register_as_package(L, "iohelper", IOHELPER_FUNCS);
     register_as_package(L, "avi", AVI_FUNCS);
 
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <gui/Main.h>
+#include <lua/modules/Savestate.h>
+
+namespace LuaCore::Bruteforce
+{
+    // The registry key under which the objective function of the last search started by a Lua instance is stored
+    constexpr auto OBJECTIVE_KEY = "bruteforce.objective";
+
+    static const char* const GOAL_NAMES[] = {"maximize", "minimize", "target", NULL};
+    static const char* const TYPE_NAMES[] = {"u8", "s8", "u16", "s16", "u32", "s32", "float", NULL};
+
+    // The button names, in the order of their bits in core_buttons
+    constexpr size_t BUTTON_COUNT = 14;
+    static const char* const BUTTON_NAMES[] = {"right", "left", "down", "up", "start", "Z", "B", "A", "Cright", "Cleft", "Cdown", "Cup", "R", "L", NULL};
+
+    static lua_Integer GetIntegerField(lua_State* L, int idx, const char* name, lua_Integer def)
+    {
+        lua_getfield(L, idx, name);
+        const auto value = luaL_opt(L, luaL_checkinteger, -1, def);
+        lua_pop(L, 1);
+        return value;
+    }
+
+    // Reads a {min, max} analog range from a field of the parameter table
+    static void GetRangeField(lua_State* L, const char* name, int8_t& min, int8_t& max)
+    {
+        min = max = 0;
+        if (lua_getfield(L, 1, name) == LUA_TTABLE)
+        {
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            min = (int8_t)std::clamp<lua_Integer>(luaL_checkinteger(L, -2), INT8_MIN, INT8_MAX);
+            max = (int8_t)std::clamp<lua_Integer>(luaL_checkinteger(L, -1), INT8_MIN, INT8_MAX);
+            lua_pop(L, 2);
+        }
+        lua_pop(L, 1);
+    }
+
+    // Converts an input table in the format of movie.begin_warp_modify at the top of the stack
+    static core_buttons ToInput(lua_State* L)
+    {
+        luaL_checktype(L, -1, LUA_TTABLE);
+
+        core_buttons input{};
+        for (size_t i = 0; i < BUTTON_COUNT; ++i)
+        {
+            lua_getfield(L, -1, BUTTON_NAMES[i]);
+            if (lua_toboolean(L, -1))
+            {
+                input.value |= 1 << i;
+            }
+            lua_pop(L, 1);
+        }
+        lua_getfield(L, -1, "X");
+        input.x = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        lua_getfield(L, -1, "Y");
+        input.y = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        return input;
+    }
+
+    // Pushes an input table in the format of movie.begin_warp_modify
+    static void PushInput(lua_State* L, core_buttons input)
+    {
+        lua_createtable(L, 0, BUTTON_COUNT + 2);
+        for (size_t i = 0; i < BUTTON_COUNT; ++i)
+        {
+            if (input.value & (1 << i))
+            {
+                lua_pushboolean(L, true);
+                lua_setfield(L, -2, BUTTON_NAMES[i]);
+            }
+        }
+        lua_pushinteger(L, input.x);
+        lua_setfield(L, -2, "X");
+        lua_pushinteger(L, input.y);
+        lua_setfield(L, -2, "Y");
+    }
+
+    /**
+     * \brief Calls the objective function of a Lua instance on the UI thread and waits for its value.
+     */
+    static double CallObjective(lua_State* L)
+    {
+        std::promise<double> promise;
+        g_main_window_dispatcher->invoke([&] {
+            // The instance could have been stopped since the search was started
+            const bool alive = std::ranges::any_of(g_lua_environments, [=](const auto lua) {
+                return lua->L == L;
+            });
+            if (!alive)
+            {
+                core_bf_stop();
+                promise.set_value(NAN);
+                return;
+            }
+
+            lua_getfield(L, LUA_REGISTRYINDEX, OBJECTIVE_KEY);
+            if (lua_pcall(L, 0, 1, 0))
+            {
+                const auto lua = get_lua_class(L);
+                print_con(lua->hwnd, string_to_wstring(lua_tostring(L, -1)) + L"\r\n");
+                lua_pop(L, 1);
+                core_bf_stop();
+                promise.set_value(NAN);
+                return;
+            }
+
+            const double value = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : NAN;
+            lua_pop(L, 1);
+            promise.set_value(value);
+        });
+        return promise.get_future().get();
+    }
+
+    // start(params): starts an input search from a savestate handle, returning the result code
+    // params: {state, frames, controller, buttons, x, y, initial, iterations, keep, seed, objective, goal, target}
+    // The objective is either a list of {address, type[, weight]} RDRAM terms or a function, which is called on the UI thread after each candidate
+    static int Start(lua_State* L)
+    {
+        luaL_checktype(L, 1, LUA_TTABLE);
+
+        core_bf_params params{};
+
+        lua_getfield(L, 1, "state");
+        const auto handle = (Savestate::t_savestate_handle*)luaL_testudata(L, -1, Savestate::HANDLE_METATABLE);
+        luaL_argcheck(L, handle, 1, "state must be a savestate handle");
+        bool pending;
+        {
+            std::lock_guard lock(handle->data->mutex);
+            pending = handle->data->pending != 0;
+            params.state = handle->data->buffer;
+        }
+        lua_pop(L, 1);
+        luaL_argcheck(L, !pending, 1, "the savestate handle has a pending save");
+
+        const auto frames = GetIntegerField(L, 1, "frames", 0);
+        const auto iterations = GetIntegerField(L, 1, "iterations", 1000);
+        const auto keep = GetIntegerField(L, 1, "keep", 16);
+        luaL_argcheck(L, frames > 0 && iterations > 0 && keep > 0, 1, "frames, iterations and keep must be positive");
+
+        params.frames = frames;
+        params.iterations = iterations;
+        params.keep = keep;
+        params.controller = GetIntegerField(L, 1, "controller", 1) - 1;
+        params.seed = GetIntegerField(L, 1, "seed", 0);
+        GetRangeField(L, "x", params.x_min, params.x_max);
+        GetRangeField(L, "y", params.y_min, params.y_max);
+
+        if (lua_getfield(L, 1, "buttons") == LUA_TTABLE)
+        {
+            for (lua_Integer i = 1; lua_rawgeti(L, -1, i) != LUA_TNIL; ++i)
+            {
+                params.button_mask |= 1 << luaL_checkoption(L, -1, NULL, BUTTON_NAMES);
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+
+        if (lua_getfield(L, 1, "initial") == LUA_TTABLE)
+        {
+            for (lua_Integer i = 1; lua_rawgeti(L, -1, i) != LUA_TNIL; ++i)
+            {
+                params.initial.push_back(ToInput(L));
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, 1, "goal");
+        params.goal = (core_bf_goal)luaL_checkoption(L, -1, "maximize", GOAL_NAMES);
+        lua_pop(L, 1);
+        lua_getfield(L, 1, "target");
+        params.target = luaL_optnumber(L, -1, 0);
+        lua_pop(L, 1);
+
+        const int objective_type = lua_getfield(L, 1, "objective");
+        if (objective_type == LUA_TFUNCTION)
+        {
+            lua_setfield(L, LUA_REGISTRYINDEX, OBJECTIVE_KEY);
+            params.objective = [L] {
+                return CallObjective(L);
+            };
+        }
+        else
+        {
+            luaL_argcheck(L, objective_type == LUA_TTABLE, 1, "objective must be a function or a list of terms");
+            for (lua_Integer i = 1; lua_rawgeti(L, -1, i) != LUA_TNIL; ++i)
+            {
+                luaL_checktype(L, -1, LUA_TTABLE);
+                lua_rawgeti(L, -1, 1);
+                lua_rawgeti(L, -2, 2);
+                lua_rawgeti(L, -3, 3);
+                params.terms.push_back({
+                .address = (uint32_t)luaL_checkinteger(L, -3),
+                .type = (core_rs_type)luaL_checkoption(L, -2, NULL, TYPE_NAMES),
+                .weight = luaL_optnumber(L, -1, 1.0),
+                });
+                lua_pop(L, 4);
+            }
+            lua_pop(L, 2);
+        }
+
+        lua_pushinteger(L, core_bf_start(params));
+        return 1;
+    }
+
+    static int Stop(lua_State* L)
+    {
+        core_bf_stop();
+        return 0;
+    }
+
+    static int IsRunning(lua_State* L)
+    {
+        lua_pushboolean(L, core_bf_is_running());
+        return 1;
+    }
+
+    static int GetEvaluated(lua_State* L)
+    {
+        lua_pushinteger(L, core_bf_get_evaluated());
+        return 1;
+    }
+
+    // results(): gets the best candidates as {value, inputs} tables, best first. The inputs can be passed to movie.begin_warp_modify.
+    static int GetResults(lua_State* L)
+    {
+        std::vector<core_bf_result> results;
+        core_bf_get_results(results);
+
+        lua_createtable(L, (int)results.size(), 0);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            lua_createtable(L, 0, 2);
+            lua_pushnumber(L, results[i].value);
+            lua_setfield(L, -2, "value");
+
+            lua_createtable(L, (int)results[i].inputs.size(), 0);
+            for (size_t j = 0; j < results[i].inputs.size(); ++j)
+            {
+                PushInput(L, results[i].inputs[j]);
+                lua_rawseti(L, -2, j + 1);
+            }
+            lua_setfield(L, -2, "inputs");
+
+            lua_rawseti(L, -2, i + 1);
+        }
+        return 1;
+    }
+} // namespace LuaCore::Bruteforce
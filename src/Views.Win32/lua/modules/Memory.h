@@ -224,6 +224,584 @@ namespace LuaCore::Memory
         return 0;
     }
 
+    // Bulk functions
+
+    constexpr uint32_t RDRAM_SIZE = CORE_ADDR_MASK + 1;
+    constexpr auto VIEW_METATABLE = "memory.view";
+
+    /**
+     * \brief Checks that the range [addr, addr + size) lies within RDRAM and returns its masked start address.
+     */
+    static uint32_t CheckRange(lua_State* L, lua_Integer addr, lua_Integer size)
+    {
+        const uint32_t start = (uint32_t)addr & CORE_ADDR_MASK;
+        luaL_argcheck(L, size >= 0 && start + (uint64_t)size <= RDRAM_SIZE, 2, "range exceeds RDRAM");
+        return start;
+    }
+
+    /**
+     * \brief Copies a range of RDRAM into a buffer in the N64's byte order.
+     * \remarks RDRAM is stored as host-endian words, so aligned words are byteswapped as a whole instead of swizzling every byte.
+     */
+    static void ReadBytes(uint32_t addr, uint8_t* dst, size_t size)
+    {
+        const auto rdram = (uint8_t*)g_core.rdram;
+        size_t i = 0;
+        for (; i < size && (addr + i) % 4 != 0; ++i)
+        {
+            dst[i] = rdram[(addr + i) ^ 3];
+        }
+        for (; i + 4 <= size; i += 4)
+        {
+            const uint32_t word = _byteswap_ulong(*(uint32_t*)(rdram + addr + i));
+            memcpy(dst + i, &word, sizeof(word));
+        }
+        for (; i < size; ++i)
+        {
+            dst[i] = rdram[(addr + i) ^ 3];
+        }
+    }
+
+    /**
+     * \brief Copies a buffer in the N64's byte order into a range of RDRAM.
+     */
+    static void WriteBytes(uint32_t addr, const uint8_t* src, size_t size)
+    {
+        const auto rdram = (uint8_t*)g_core.rdram;
+        size_t i = 0;
+        for (; i < size && (addr + i) % 4 != 0; ++i)
+        {
+            rdram[(addr + i) ^ 3] = src[i];
+        }
+        for (; i + 4 <= size; i += 4)
+        {
+            uint32_t word;
+            memcpy(&word, src + i, sizeof(word));
+            *(uint32_t*)(rdram + addr + i) = _byteswap_ulong(word);
+        }
+        for (; i < size; ++i)
+        {
+            rdram[(addr + i) ^ 3] = src[i];
+        }
+    }
+
+    /**
+     * \brief Loads a big-endian value of up to 8 bytes from RDRAM, taking the word-sized path when the address is suitably aligned.
+     */
+    static uint64_t LoadRaw(uint32_t addr, size_t size)
+    {
+        const auto rdram = (uint8_t*)g_core.rdram;
+        if (size == 1)
+        {
+            return core_rdram_load<uint8_t>(rdram, addr);
+        }
+        if (size == 2 && addr % 2 == 0)
+        {
+            return core_rdram_load<uint16_t>(rdram, addr);
+        }
+        if (size == 4 && addr % 4 == 0)
+        {
+            return core_rdram_load<uint32_t>(rdram, addr);
+        }
+        if (size == 8 && addr % 4 == 0)
+        {
+            return (uint64_t)core_rdram_load<uint32_t>(rdram, addr) << 32 | core_rdram_load<uint32_t>(rdram, addr + 4);
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            value = value << 8 | core_rdram_load<uint8_t>(rdram, addr + i);
+        }
+        return value;
+    }
+
+    /**
+     * \brief Stores a big-endian value of up to 8 bytes into RDRAM.
+     */
+    static void StoreRaw(uint32_t addr, size_t size, uint64_t value)
+    {
+        const auto rdram = (uint8_t*)g_core.rdram;
+        if (size == 2 && addr % 2 == 0)
+        {
+            core_rdram_store<uint16_t>(rdram, addr, (uint16_t)value);
+            return;
+        }
+        if (size == 4 && addr % 4 == 0)
+        {
+            core_rdram_store<uint32_t>(rdram, addr, (uint32_t)value);
+            return;
+        }
+        if (size == 8 && addr % 4 == 0)
+        {
+            core_rdram_store<uint32_t>(rdram, addr, (uint32_t)(value >> 32));
+            core_rdram_store<uint32_t>(rdram, addr + 4, (uint32_t)value);
+            return;
+        }
+        for (size_t i = 0; i < size; ++i)
+        {
+            core_rdram_store<uint8_t>(rdram, addr + i, (uint8_t)(value >> (8 * (size - 1 - i))));
+        }
+    }
+
+    /**
+     * \brief Gets the size of a field type code, or 0 if the code is invalid.
+     * \remarks The codes are b/B (8-bit), h/H (16-bit), i/I (32-bit), q/Q (64-bit), f (float) and d (double), where lowercase integer codes are signed.
+     */
+    static size_t GetFieldSize(char code)
+    {
+        switch (code)
+        {
+        case 'b':
+        case 'B':
+            return 1;
+        case 'h':
+        case 'H':
+            return 2;
+        case 'i':
+        case 'I':
+        case 'f':
+            return 4;
+        case 'q':
+        case 'Q':
+        case 'd':
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * \brief Gets the field type code at the specified stack index, which is either a code or a size as accepted by readsize.
+     */
+    static char CheckFieldType(lua_State* L, int i)
+    {
+        if (lua_type(L, i) == LUA_TNUMBER)
+        {
+            switch (luaL_checkinteger(L, i))
+            {
+            case 1:
+                return 'B';
+            case 2:
+                return 'H';
+            case 4:
+                return 'I';
+            case 8:
+                return 'Q';
+            case -1:
+                return 'b';
+            case -2:
+                return 'h';
+            case -4:
+                return 'i';
+            case -8:
+                return 'q';
+            default:
+                luaL_argerror(L, i, "size must be 1, 2, 4, 8, -1, -2, -4, -8");
+            }
+        }
+
+        const char* code = luaL_checkstring(L, i);
+        luaL_argcheck(L, code[0] != '\0' && code[1] == '\0' && GetFieldSize(code[0]) != 0, i, "invalid field type");
+        return code[0];
+    }
+
+    /**
+     * \brief Reads a field from RDRAM and pushes it. 64-bit integers are pushed as native Lua integers.
+     */
+    static void PushField(lua_State* L, uint32_t addr, char code)
+    {
+        const uint64_t raw = LoadRaw(addr, GetFieldSize(code));
+        switch (code)
+        {
+        case 'b':
+            lua_pushinteger(L, (int8_t)raw);
+            break;
+        case 'h':
+            lua_pushinteger(L, (int16_t)raw);
+            break;
+        case 'i':
+            lua_pushinteger(L, (int32_t)raw);
+            break;
+        case 'f':
+            {
+                const uint32_t bits = (uint32_t)raw;
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                lua_pushnumber(L, value);
+                break;
+            }
+        case 'd':
+            {
+                double value;
+                memcpy(&value, &raw, sizeof(value));
+                lua_pushnumber(L, value);
+                break;
+            }
+        default:
+            lua_pushinteger(L, (lua_Integer)raw);
+            break;
+        }
+    }
+
+    /**
+     * \brief Writes the value at the specified stack index to a field in RDRAM.
+     */
+    static void StoreField(lua_State* L, uint32_t addr, char code, int i)
+    {
+        uint64_t raw;
+        if (code == 'f')
+        {
+            const float value = (float)luaL_checknumber(L, i);
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            raw = bits;
+        }
+        else if (code == 'd')
+        {
+            const double value = luaL_checknumber(L, i);
+            memcpy(&raw, &value, sizeof(raw));
+        }
+        else
+        {
+            raw = (uint64_t)luaL_checkinteger(L, i);
+        }
+        StoreRaw(addr, GetFieldSize(code), raw);
+    }
+
+    /**
+     * \brief Parses a struct format string, calling a function for each field with its offset and type code.
+     * \remarks Each code may be prefixed by a repeat count, and x skips a byte of padding, e.g. "2H4xI" is two halfwords, four bytes of padding and a word.
+     * \return The size of the struct.
+     */
+    template <typename Fn>
+    static size_t ParseStruct(lua_State* L, int i, const char* format, Fn fn)
+    {
+        size_t offset = 0;
+        for (const char* p = format; *p != '\0';)
+        {
+            size_t count = 1;
+            if (isdigit((unsigned char)*p))
+            {
+                count = 0;
+                while (isdigit((unsigned char)*p))
+                {
+                    count = count * 10 + (*p++ - '0');
+                    luaL_argcheck(L, count <= RDRAM_SIZE, i, "repeat count too large");
+                }
+            }
+
+            const char code = *p++;
+            if (code == 'x')
+            {
+                offset += count;
+                continue;
+            }
+
+            const size_t size = GetFieldSize(code);
+            if (size == 0)
+            {
+                luaL_argerror(L, i, lua_pushfstring(L, "invalid field type '%c'", code));
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                fn(offset, code);
+                offset += size;
+            }
+        }
+        return offset;
+    }
+
+    /**
+     * \brief Reads a struct at the specified address into the table on top of the stack, returning the number of fields.
+     */
+    static lua_Integer ReadStructInto(lua_State* L, uint32_t addr, const char* format, int format_index)
+    {
+        lua_Integer n = 0;
+        ParseStruct(L, format_index, format, [&](size_t offset, char code) {
+            PushField(L, addr + offset, code);
+            lua_rawseti(L, -2, ++n);
+        });
+        return n;
+    }
+
+    /**
+     * \brief Pushes the table at the specified stack index if it's a table, or a new table otherwise.
+     */
+    static void PushOutTable(lua_State* L, int i, int narr)
+    {
+        if (lua_istable(L, i))
+        {
+            lua_pushvalue(L, i);
+            return;
+        }
+        lua_createtable(L, narr, 0);
+    }
+
+    /**
+     * \brief Trims the array part of a reused table to n elements.
+     */
+    static void TrimOutTable(lua_State* L, lua_Integer n)
+    {
+        for (lua_Integer i = n + 1; lua_rawgeti(L, -1, i) != LUA_TNIL; ++i)
+        {
+            lua_pop(L, 1);
+            lua_pushnil(L);
+            lua_rawseti(L, -2, i);
+        }
+        lua_pop(L, 1);
+    }
+
+    // readrange(addr, size[, astable]): reads a range of bytes as a string, or as an array of integers if astable is true
+    static int LuaReadRange(lua_State* L)
+    {
+        const lua_Integer size = luaL_checkinteger(L, 2);
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+
+        if (!lua_toboolean(L, 3))
+        {
+            luaL_Buffer buffer;
+            const auto data = (uint8_t*)luaL_buffinitsize(L, &buffer, size);
+            ReadBytes(addr, data, size);
+            luaL_pushresultsize(&buffer, size);
+            return 1;
+        }
+
+        lua_createtable(L, (int)size, 0);
+        for (lua_Integer i = 0; i < size; ++i)
+        {
+            lua_pushinteger(L, core_rdram_load<uint8_t>((uint8_t*)g_core.rdram, addr + i));
+            lua_rawseti(L, -2, i + 1);
+        }
+        return 1;
+    }
+
+    // writerange(addr, data): writes a string or an array of byte values
+    static int LuaWriteRange(lua_State* L)
+    {
+        if (lua_istable(L, 2))
+        {
+            const lua_Integer size = luaL_len(L, 2);
+            const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+            for (lua_Integer i = 0; i < size; ++i)
+            {
+                lua_rawgeti(L, 2, i + 1);
+                core_rdram_store<uint8_t>((uint8_t*)g_core.rdram, addr + i, (uint8_t)luaL_checkinteger(L, -1));
+                lua_pop(L, 1);
+            }
+            return 0;
+        }
+
+        size_t size;
+        const char* data = luaL_checklstring(L, 2, &size);
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+        WriteBytes(addr, (const uint8_t*)data, size);
+        return 0;
+    }
+
+    // readarray(addr, count, type[, stride[, out]]): reads count values of a type, which is a field type code or a readsize size, into a new or reused table
+    static int LuaReadArray(lua_State* L)
+    {
+        const lua_Integer count = luaL_checkinteger(L, 2);
+        const char code = CheckFieldType(L, 3);
+        const lua_Integer stride = luaL_optinteger(L, 4, (lua_Integer)GetFieldSize(code));
+        luaL_argcheck(L, count >= 0 && count <= RDRAM_SIZE, 2, "count out of range");
+        luaL_argcheck(L, stride >= 0, 4, "stride must not be negative");
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), count == 0 ? 0 : (count - 1) * stride + GetFieldSize(code));
+
+        PushOutTable(L, 5, (int)count);
+        for (lua_Integer i = 0; i < count; ++i)
+        {
+            PushField(L, addr + (uint32_t)(i * stride), code);
+            lua_rawseti(L, -2, i + 1);
+        }
+        TrimOutTable(L, count);
+        return 1;
+    }
+
+    // writearray(addr, type, values[, stride]): writes an array of values of a type
+    static int LuaWriteArray(lua_State* L)
+    {
+        const char code = CheckFieldType(L, 2);
+        luaL_checktype(L, 3, LUA_TTABLE);
+        const lua_Integer count = luaL_len(L, 3);
+        const lua_Integer stride = luaL_optinteger(L, 4, (lua_Integer)GetFieldSize(code));
+        luaL_argcheck(L, stride >= 0, 4, "stride must not be negative");
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), count == 0 ? 0 : (count - 1) * stride + GetFieldSize(code));
+
+        for (lua_Integer i = 0; i < count; ++i)
+        {
+            lua_rawgeti(L, 3, i + 1);
+            StoreField(L, addr + (uint32_t)(i * stride), code, -1);
+            lua_pop(L, 1);
+        }
+        return 0;
+    }
+
+    // readstruct(addr, format[, out]): reads the fields described by a format string into a new or reused table
+    static int LuaReadStruct(lua_State* L)
+    {
+        const char* format = luaL_checkstring(L, 2);
+        const size_t size = ParseStruct(L, 2, format, [](size_t, char) {});
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+
+        PushOutTable(L, 3, 0);
+        TrimOutTable(L, ReadStructInto(L, addr, format, 2));
+        return 1;
+    }
+
+    // writestruct(addr, format, values): writes the fields described by a format string from an array
+    static int LuaWriteStruct(lua_State* L)
+    {
+        const char* format = luaL_checkstring(L, 2);
+        luaL_checktype(L, 3, LUA_TTABLE);
+        const size_t size = ParseStruct(L, 2, format, [](size_t, char) {});
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+
+        lua_Integer n = 0;
+        ParseStruct(L, 2, format, [&](size_t offset, char code) {
+            lua_rawgeti(L, 3, ++n);
+            StoreField(L, addr + offset, code, -1);
+            lua_pop(L, 1);
+        });
+        return 0;
+    }
+
+    // View functions
+    // A view is a window over a range of RDRAM which reads and writes the live memory on access, so nothing is copied into Lua
+
+    struct t_view {
+        uint32_t addr;
+        uint32_t size;
+    };
+
+    static t_view* CheckView(lua_State* L)
+    {
+        return (t_view*)luaL_checkudata(L, 1, VIEW_METATABLE);
+    }
+
+    /**
+     * \brief Checks that a field of the specified size at the offset at the stack index lies within a view, and returns its address.
+     */
+    static uint32_t CheckViewOffset(lua_State* L, const t_view* view, int i, size_t size)
+    {
+        const lua_Integer offset = luaL_checkinteger(L, i);
+        luaL_argcheck(L, offset >= 0 && (uint64_t)offset + size <= view->size, i, "offset out of view bounds");
+        return view->addr + (uint32_t)offset;
+    }
+
+    // view:get(offset, type)
+    static int LuaViewGet(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        const char code = CheckFieldType(L, 3);
+        PushField(L, CheckViewOffset(L, view, 2, GetFieldSize(code)), code);
+        return 1;
+    }
+
+    // view:set(offset, type, value)
+    static int LuaViewSet(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        const char code = CheckFieldType(L, 3);
+        StoreField(L, CheckViewOffset(L, view, 2, GetFieldSize(code)), code, 4);
+        return 0;
+    }
+
+    // view:struct(offset, format[, out])
+    static int LuaViewStruct(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        const char* format = luaL_checkstring(L, 3);
+        const size_t size = ParseStruct(L, 3, format, [](size_t, char) {});
+        const uint32_t addr = CheckViewOffset(L, view, 2, size);
+
+        PushOutTable(L, 4, 0);
+        TrimOutTable(L, ReadStructInto(L, addr, format, 3));
+        return 1;
+    }
+
+    // view:bytes([offset[, size]])
+    static int LuaViewBytes(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        const lua_Integer offset = luaL_optinteger(L, 2, 0);
+        const lua_Integer size = luaL_optinteger(L, 3, (lua_Integer)view->size - offset);
+        luaL_argcheck(L, offset >= 0 && size >= 0 && offset + size <= view->size, 2, "range out of view bounds");
+
+        luaL_Buffer buffer;
+        const auto data = (uint8_t*)luaL_buffinitsize(L, &buffer, size);
+        ReadBytes(view->addr + (uint32_t)offset, data, size);
+        luaL_pushresultsize(&buffer, size);
+        return 1;
+    }
+
+    // view:address()
+    static int LuaViewAddress(lua_State* L)
+    {
+        lua_pushinteger(L, CheckView(L)->addr);
+        return 1;
+    }
+
+    // view[offset] reads an unsigned byte, any other key looks up a method
+    static int LuaViewIndex(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        if (lua_isinteger(L, 2))
+        {
+            PushField(L, CheckViewOffset(L, view, 2, 1), 'B');
+            return 1;
+        }
+        lua_pushvalue(L, 2);
+        lua_rawget(L, lua_upvalueindex(1));
+        return 1;
+    }
+
+    // view[offset] = value writes a byte
+    static int LuaViewNewIndex(lua_State* L)
+    {
+        const auto view = CheckView(L);
+        StoreField(L, CheckViewOffset(L, view, 2, 1), 'B', 3);
+        return 0;
+    }
+
+    static int LuaViewLen(lua_State* L)
+    {
+        lua_pushinteger(L, CheckView(L)->size);
+        return 1;
+    }
+
+    static const luaL_Reg VIEW_FUNCS[] = {
+    {"get", LuaViewGet},
+    {"set", LuaViewSet},
+    {"struct", LuaViewStruct},
+    {"bytes", LuaViewBytes},
+    {"address", LuaViewAddress},
+    {NULL, NULL}};
+
+    // view(addr, size): creates a view over a range of RDRAM
+    static int LuaView(lua_State* L)
+    {
+        const lua_Integer size = luaL_checkinteger(L, 2);
+        const uint32_t addr = CheckRange(L, luaL_checkinteger(L, 1), size);
+
+        const auto view = (t_view*)lua_newuserdatauv(L, sizeof(t_view), 0);
+        view->addr = addr;
+        view->size = (uint32_t)size;
+
+        if (luaL_newmetatable(L, VIEW_METATABLE))
+        {
+            luaL_newlib(L, VIEW_FUNCS);
+            lua_pushcclosure(L, LuaViewIndex, 1);
+            lua_setfield(L, -2, "__index");
+            lua_pushcfunction(L, LuaViewNewIndex);
+            lua_setfield(L, -2, "__newindex");
+            lua_pushcfunction(L, LuaViewLen);
+            lua_setfield(L, -2, "__len");
+        }
+        lua_setmetatable(L, -2);
+        return 1;
+    }
+
     static int LuaIntToFloat(lua_State* L)
     {
         ULONG n = luaL_checknumber(L, 1);
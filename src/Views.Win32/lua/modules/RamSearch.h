@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+namespace LuaCore::RamSearch
+{
+    static const char* const TYPE_NAMES[] = {"u8", "s8", "u16", "s16", "u32", "s32", "float", NULL};
+    static const char* const CMP_NAMES[] = {"equal", "notequal", "greater", "less", "changed", "unchanged", "increased", "decreased", "changedby", NULL};
+
+    // begin(type): starts a new search over all values of a type
+    static int Begin(lua_State* L)
+    {
+        core_rs_begin((core_rs_type)luaL_checkoption(L, 1, NULL, TYPE_NAMES));
+        lua_pushinteger(L, core_rs_get_count());
+        return 1;
+    }
+
+    // filter(cmp[, value]): narrows down the candidates, returning how many are left
+    static int Filter(lua_State* L)
+    {
+        const auto cmp = (core_rs_cmp)luaL_checkoption(L, 1, NULL, CMP_NAMES);
+        lua_pushinteger(L, core_rs_filter(cmp, luaL_optnumber(L, 2, 0)));
+        return 1;
+    }
+
+    static int GetCount(lua_State* L)
+    {
+        lua_pushinteger(L, core_rs_get_count());
+        return 1;
+    }
+
+    // candidates([max]): gets the candidates' addresses, which can be passed to the memory functions
+    static int GetCandidates(lua_State* L)
+    {
+        const lua_Integer max = luaL_optinteger(L, 1, 1000);
+        luaL_argcheck(L, max >= 0, 1, "max must not be negative");
+
+        std::vector<uint32_t> addresses;
+        core_rs_get_candidates(addresses, max);
+
+        lua_createtable(L, (int)addresses.size(), 0);
+        for (size_t i = 0; i < addresses.size(); ++i)
+        {
+            lua_pushinteger(L, 0x80000000 | addresses[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+        return 1;
+    }
+
+    static int End(lua_State* L)
+    {
+        core_rs_end();
+        return 0;
+    }
+} // namespace LuaCore::RamSearch
@@ -6,8 +6,29 @@
 
 #pragma once
 
+#include <AsyncExecutor.h>
+#include <libdeflate.h>
+
 namespace LuaCore::Savestate
 {
+    constexpr auto HANDLE_METATABLE = "savestate.handle";
+
+    // The libdeflate level used for compressed in-memory savestates, which favours speed over size
+    constexpr int HANDLE_COMPRESSION_LEVEL = 1;
+
+    /**
+     * \brief The data behind an in-memory savestate handle. Shared with pending savestate operations, which complete on the emu thread.
+     */
+    struct t_savestate_data {
+        std::mutex mutex;
+        std::vector<uint8_t> buffer;
+        size_t pending;
+    };
+
+    struct t_savestate_handle {
+        std::shared_ptr<t_savestate_data> data;
+    };
+
     static int SaveFileSavestate(lua_State* L)
     {
         const std::string path = lua_tostring(L, 1);
@@ -33,4 +54,171 @@ namespace LuaCore::Savestate
 
         return 0;
     }
+
+    static t_savestate_handle* CheckHandle(lua_State* L)
+    {
+        return (t_savestate_handle*)luaL_checkudata(L, 1, HANDLE_METATABLE);
+    }
+
+    static int HandleGc(lua_State* L)
+    {
+        CheckHandle(L)->~t_savestate_handle();
+        return 0;
+    }
+
+    static void PushHandle(lua_State* L, std::shared_ptr<t_savestate_data> data);
+
+    // handle:save([compress]): saves the current state into the handle
+    static int HandleSave(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+        const bool compress = lua_toboolean(L, 2);
+
+        {
+            std::lock_guard lock(data->mutex);
+            data->pending++;
+        }
+
+        const auto callback = [=](const core_result result, const std::vector<uint8_t>& buffer) {
+            std::vector<uint8_t> out;
+            if (result == Res_Ok && compress)
+            {
+                const auto compressor = libdeflate_alloc_compressor(HANDLE_COMPRESSION_LEVEL);
+                out.resize(libdeflate_gzip_compress_bound(compressor, buffer.size()));
+                out.resize(libdeflate_gzip_compress(compressor, buffer.data(), buffer.size(), out.data(), out.size()));
+                libdeflate_free_compressor(compressor);
+            }
+            else if (result == Res_Ok)
+            {
+                out = buffer;
+            }
+
+            std::lock_guard lock(data->mutex);
+            if (!out.empty())
+            {
+                data->buffer = std::move(out);
+            }
+            data->pending--;
+        };
+
+        // The callback is also invoked if the save can't be enqueued, so pending is always decremented
+        core_vr_wait_increment();
+        AsyncExecutor::invoke_async([=] {
+            core_vr_wait_decrement();
+            core_st_do_memory({}, core_st_job_save, callback, true);
+        });
+
+        return 0;
+    }
+
+    // handle:load(): loads the state held by the handle
+    static int HandleLoad(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+
+        std::vector<uint8_t> buffer;
+        bool pending;
+        {
+            std::lock_guard lock(data->mutex);
+            pending = data->pending != 0;
+            buffer = data->buffer;
+        }
+        if (pending)
+        {
+            luaL_error(L, "The savestate handle has a pending save");
+        }
+        if (buffer.empty())
+        {
+            luaL_error(L, "The savestate handle is empty");
+        }
+
+        core_vr_wait_increment();
+        AsyncExecutor::invoke_async([buffer = std::move(buffer)] {
+            core_vr_wait_decrement();
+            core_st_do_memory(buffer, core_st_job_load, [](const core_result result, const auto&) {
+                if (result != Res_Ok)
+                {
+                    g_view_logger->error("[Lua] Failed to load savestate handle (error code {})", (int32_t)result);
+                }
+            },
+                              true);
+        });
+
+        return 0;
+    }
+
+    // handle:free(): releases the state held by the handle
+    static int HandleFree(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+
+        std::lock_guard lock(data->mutex);
+        data->buffer = {};
+        return 0;
+    }
+
+    // handle:clone(): creates a new handle holding a copy of the state
+    static int HandleClone(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+
+        auto clone = std::make_shared<t_savestate_data>();
+        {
+            std::lock_guard lock(data->mutex);
+            clone->buffer = data->buffer;
+        }
+        PushHandle(L, clone);
+        return 1;
+    }
+
+    // handle:size(): gets the size of the held state in bytes, or 0 if the handle is empty
+    static int HandleSize(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+
+        std::lock_guard lock(data->mutex);
+        lua_pushinteger(L, data->buffer.size());
+        return 1;
+    }
+
+    // handle:busy(): gets whether a save into the handle hasn't completed yet
+    static int HandleBusy(lua_State* L)
+    {
+        const auto data = CheckHandle(L)->data;
+
+        std::lock_guard lock(data->mutex);
+        lua_pushboolean(L, data->pending != 0);
+        return 1;
+    }
+
+    static const luaL_Reg HANDLE_FUNCS[] = {
+    {"save", HandleSave},
+    {"load", HandleLoad},
+    {"free", HandleFree},
+    {"clone", HandleClone},
+    {"size", HandleSize},
+    {"busy", HandleBusy},
+    {NULL, NULL}};
+
+    static void PushHandle(lua_State* L, std::shared_ptr<t_savestate_data> data)
+    {
+        const auto handle = (t_savestate_handle*)lua_newuserdatauv(L, sizeof(t_savestate_handle), 0);
+        new (handle) t_savestate_handle{std::move(data)};
+
+        if (luaL_newmetatable(L, HANDLE_METATABLE))
+        {
+            luaL_newlib(L, HANDLE_FUNCS);
+            lua_setfield(L, -2, "__index");
+            lua_pushcfunction(L, HandleGc);
+            lua_setfield(L, -2, "__gc");
+        }
+        lua_setmetatable(L, -2);
+    }
+
+    // create(): creates an empty in-memory savestate handle
+    static int CreateHandle(lua_State* L)
+    {
+        PushHandle(L, std::make_shared<t_savestate_data>());
+        return 1;
+    }
 } // namespace LuaCore::Savestate
@@ -513,6 +513,9 @@
 #define IDM_MULTI_FRAME_ADVANCE_DEC 40105
 #define IDM_MULTI_FRAME_ADVANCE_RESET 40106
 #define IDD_PLUGIN_CONFIG 40107
+#define IDM_BENCHMARK_LUA_MEMORY 40108
+#define IDM_BENCHMARK_LUA_DISPATCH 40109
+#define IDM_BENCHMARK_YUV_CONVERSION 40110
 #define IDC_STATIC -1
 
 // Next default values for new objects
@@ -40,6 +40,11 @@
 #include <stack>
 #include <deque>
 #include <numeric>
+#include <future>
+#include <random>
+#include <bit>
+#include <array>
+#include <charconv>
 
 extern "C" {
 #include <lua.h>